@@ -0,0 +1,130 @@
+#pragma once
+#include "GraphicsMath\cgm.h"
+#include <xmmintrin.h>
+#include <stdint.h>
+
+#define SHUFFLE_PARAM(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define _mm_replicate_x_ps(v) _mm_shuffle_ps((v), (v), SHUFFLE_PARAM(0, 0, 0, 0))
+#define _mm_replicate_y_ps(v) _mm_shuffle_ps((v), (v), SHUFFLE_PARAM(1, 1, 1, 1))
+#define _mm_replicate_z_ps(v) _mm_shuffle_ps((v), (v), SHUFFLE_PARAM(2, 2, 2, 2))
+#define _mm_replicate_w_ps(v) _mm_shuffle_ps((v), (v), SHUFFLE_PARAM(3, 3, 3, 3))
+#define _mm_add_mul_ps(a, b, c) _mm_add_ps(_mm_mul_ps((a), (b)), (c))
+
+#if defined(_MSC_VER)
+#define ALIGNED(x) __declspec(align(x))
+// other Alignment here..
+#endif
+
+// cubic degree bezier curve
+class Bezier
+{
+public:
+	union
+	{
+		struct
+		{
+			vec4f p0;
+			vec4f p1;
+			vec4f p2;
+			vec4f p3;
+		};
+		mat4f p;
+	};
+
+	Bezier() { }
+	~Bezier() { }
+
+	// Optimized SISD Cubic Bezier equation
+	// Equation based on this article:
+	// http://www.idav.ucdavis.edu/education/CAGDNotes/Matrix-Cubic-Bezier-Curve/Matrix-Cubic-Bezier-Curve.html
+	void Evaluate(const float time, vec4f* result)
+	{
+		static mat4f m = mat4f(
+			 1,  0,  0,  0,
+			-3,  3,  0,  0,
+			 3, -6,  3,  0, 
+			-1,  3, -3,  1);
+
+		vec4f t = vec4f(1.0f, time, time*time, time*time*time);
+
+		auto m0 = m.u;
+		auto m1 = m.v;
+		auto m2 = m.w;
+		auto m3 = m.t;
+
+		vec4f tM = vec4f(
+			t.data[0] * m0.data[0] + t.data[1] * m1.data[0] + t.data[2] * m2.data[0] + t.data[3] * m3.data[0],
+			t.data[0] * m0.data[1] + t.data[1] * m1.data[1] + t.data[2] * m2.data[1] + t.data[3] * m3.data[1],
+			t.data[0] * m0.data[2] + t.data[1] * m1.data[2] + t.data[2] * m2.data[2] + t.data[3] * m3.data[2],
+			t.data[0] * m0.data[3] + t.data[1] * m1.data[3] + t.data[2] * m2.data[3] + t.data[3] * m3.data[3]
+		);
+
+		(*result).data[0] = tM.data[0] * p0.data[0] + tM.data[1] * p1.data[0] + tM.data[2] * p2.data[0] + tM.data[3] * p3.data[0];
+		(*result).data[1] = tM.data[0] * p0.data[1] + tM.data[1] * p1.data[1] + tM.data[2] * p2.data[1] + tM.data[3] * p3.data[1];
+		(*result).data[2] = tM.data[0] * p0.data[2] + tM.data[1] * p1.data[2] + tM.data[2] * p2.data[2] + tM.data[3] * p3.data[2];
+		(*result).data[3] = tM.data[0] * p0.data[3] + tM.data[1] * p1.data[3] + tM.data[2] * p2.data[3] + tM.data[3] * p3.data[3];
+	}
+
+	// Optimized SIMD Cubic Bezier Equation
+	// Equation based on this article:
+	// http://www.idav.ucdavis.edu/education/CAGDNotes/Matrix-Cubic-Bezier-Curve/Matrix-Cubic-Bezier-Curve.html
+	void EvaluateSIMD(const float time, vec4f* result)
+	{
+		static mat4f m = mat4f(
+			 1,  0,  0,  0,
+			-3,  3,  0,  0,
+			 3, -6,  3,  0, 
+			-1,  3, -3,  1);
+
+		// (1, t, t^2, t^3)
+		__m128 t = _mm_set_ps(time*time*time, time*time, time, 1);
+
+		__m128 a = _mm_load_ps(m.u.data);
+
+		// Vector Matrix multiplication between t and M.
+		__m128 tM = _mm_mul_ps(_mm_replicate_x_ps(t), _mm_load_ps(m.u.data));
+		tM = _mm_add_mul_ps(_mm_replicate_y_ps(t), _mm_load_ps(m.v.data), tM);
+		tM = _mm_add_mul_ps(_mm_replicate_z_ps(t), _mm_load_ps(m.w.data), tM);
+		tM = _mm_add_mul_ps(_mm_replicate_w_ps(t), _mm_load_ps(m.t.data), tM);
+
+		// Vector Matrix multiplication between the result matrix of t*M and 
+		// the matrix P formed by the control points (p0 ... p3)
+		__m128 tMP = _mm_mul_ps(_mm_replicate_x_ps(tM), _mm_load_ps(p0.data));
+		tMP = _mm_add_mul_ps(_mm_replicate_y_ps(tM), _mm_load_ps(p1.data), tMP);
+		tMP = _mm_add_mul_ps(_mm_replicate_z_ps(tM), _mm_load_ps(p2.data), tMP);
+		tMP = _mm_add_mul_ps(_mm_replicate_w_ps(tM), _mm_load_ps(p3.data), tMP);
+
+		_mm_store_ps(result->data, tMP);
+	}
+
+	// Batched SIMD Cubic Bezier Equation
+	// Evaluates samples [begin, end) out of sampleCount uniformly spaced samples
+	// (t = i / (sampleCount - 1)) into results[0 .. end - begin).
+	// M * P is computed once, so every sample is a single Horner step.
+	void EvaluateRangeSIMD(uint32_t begin, uint32_t end, uint32_t sampleCount, vec4f* results) const
+	{
+		__m128 a = _mm_loadu_ps(p0.data);
+		__m128 b = _mm_loadu_ps(p1.data);
+		__m128 c = _mm_loadu_ps(p2.data);
+		__m128 d = _mm_loadu_ps(p3.data);
+		__m128 three = _mm_set1_ps(3.0f);
+
+		// Polynomial coefficients, rows of M * P.
+		__m128 c0 = a;
+		__m128 c1 = _mm_mul_ps(three, _mm_sub_ps(b, a));
+		__m128 c2 = _mm_mul_ps(three, _mm_add_ps(_mm_sub_ps(a, _mm_add_ps(b, b)), c));
+		__m128 c3 = _mm_add_mul_ps(three, _mm_sub_ps(b, c), _mm_sub_ps(d, a));
+
+		float step = (sampleCount > 1) ? 1.0f / (sampleCount - 1) : 0.0f;
+		for (uint32_t i = begin; i < end; i++)
+		{
+			__m128 t = _mm_set1_ps(i * step);
+
+			__m128 r = _mm_add_mul_ps(c3, t, c2);
+			r = _mm_add_mul_ps(r, t, c1);
+			r = _mm_add_mul_ps(r, t, c0);
+
+			_mm_storeu_ps(results[i - begin].data, r);
+		}
+	}
+};
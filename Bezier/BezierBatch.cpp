@@ -0,0 +1,55 @@
+#include "BezierBatch.h"
+#include <algorithm>
+
+using namespace Rig3D;
+
+// Large enough to amortize scheduling, small enough to balance uneven curves.
+static const uint32_t SAMPLES_PER_CHUNK = 4096;
+
+uint32_t ComputeSampleOffsets(const uint32_t* sampleCounts, uint32_t curveCount, uint32_t* offsets)
+{
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < curveCount; i++)
+	{
+		offsets[i] = total;
+		total += sampleCounts[i];
+	}
+
+	offsets[curveCount] = total;
+	return total;
+}
+
+void EvaluateCurvesParallel(ThreadPool* threadPool, const Bezier* curves, const uint32_t* offsets, uint32_t curveCount, vec4f* output)
+{
+	const uint32_t total = offsets[curveCount];
+
+	auto evaluateSamples = [&](uint32_t begin, uint32_t end)
+	{
+		// Last curve whose range starts at or before begin. Skips empty curves.
+		uint32_t curve = static_cast<uint32_t>(std::upper_bound(offsets, offsets + curveCount + 1, begin) - offsets) - 1;
+
+		while (begin < end)
+		{
+			uint32_t curveStart	= offsets[curve];
+			uint32_t curveEnd	= offsets[curve + 1];
+			uint32_t sliceEnd	= std::min(end, curveEnd);
+
+			if (sliceEnd > begin)
+			{
+				curves[curve].EvaluateRangeSIMD(begin - curveStart, sliceEnd - curveStart, curveEnd - curveStart, output + begin);
+				begin = sliceEnd;
+			}
+
+			curve++;
+		}
+	};
+
+	if (threadPool)
+	{
+		threadPool->ParallelFor(total, SAMPLES_PER_CHUNK, evaluateSamples);
+	}
+	else
+	{
+		evaluateSamples(0, total);
+	}
+}
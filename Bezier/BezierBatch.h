@@ -0,0 +1,19 @@
+// BezierBatch
+//
+// Bulk evaluation of many curves at once. Output ranges come from a prefix sum
+// over the per curve sample counts, so every thread writes a disjoint slice of
+// one contiguous array and nothing has to be locked or merged afterwards.
+
+#pragma once
+#include "Bezier.h"
+#include "Rig3D\Common\ThreadPool.h"
+
+// Writes the exclusive prefix sum of sampleCounts into offsets (curveCount + 1 entries)
+// and returns the total number of samples.
+uint32_t ComputeSampleOffsets(const uint32_t* sampleCounts, uint32_t curveCount, uint32_t* offsets);
+
+// Evaluates curve i at (offsets[i + 1] - offsets[i]) uniform samples into
+// output[offsets[i] .. offsets[i + 1]). Work is split by samples rather than by
+// curves, so a handful of very long curves still spreads over every worker.
+// threadPool may be nullptr to evaluate on the calling thread.
+void EvaluateCurvesParallel(Rig3D::ThreadPool* threadPool, const Bezier* curves, const uint32_t* offsets, uint32_t curveCount, vec4f* output);
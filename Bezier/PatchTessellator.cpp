@@ -0,0 +1,396 @@
+#include "PatchTessellator.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const uint32_t EDGE_CONTROL_POINTS[4][4] =
+{
+	{ 0,  1,  2,  3 },	// v = 0, along u
+	{ 3,  7, 11, 15 },	// u = 1, along v
+	{ 12, 13, 14, 15 },	// v = 1, along u
+	{ 0,  4,  8, 12 }	// u = 0, along v
+};
+
+static const float NORMAL_EPSILON = 1.0e-12f;
+
+#pragma region SIMD Helpers
+
+static inline void ComputeBasis(float t, float* basis, float* derivative)
+{
+	float s = 1.0f - t;
+
+	basis[0] = s * s * s;
+	basis[1] = 3.0f * t * s * s;
+	basis[2] = 3.0f * t * t * s;
+	basis[3] = t * t * t;
+
+	derivative[0] = -3.0f * s * s;
+	derivative[1] = 3.0f * s * s - 6.0f * t * s;
+	derivative[2] = 6.0f * t * s - 3.0f * t * t;
+	derivative[3] = 3.0f * t * t;
+}
+
+// weights.x * p[0] + weights.y * p[1] + weights.z * p[2] + weights.w * p[3]
+static inline __m128 Combine(const float* weights, const __m128* p)
+{
+	__m128 w = _mm_loadu_ps(weights);
+	__m128 r = _mm_mul_ps(_mm_replicate_x_ps(w), p[0]);
+	r = _mm_add_mul_ps(_mm_replicate_y_ps(w), p[1], r);
+	r = _mm_add_mul_ps(_mm_replicate_z_ps(w), p[2], r);
+	r = _mm_add_mul_ps(_mm_replicate_w_ps(w), p[3], r);
+	return r;
+}
+
+static inline __m128 Cross(__m128 a, __m128 b)
+{
+	__m128 aYZX = _mm_shuffle_ps(a, a, SHUFFLE_PARAM(1, 2, 0, 3));
+	__m128 bYZX = _mm_shuffle_ps(b, b, SHUFFLE_PARAM(1, 2, 0, 3));
+	__m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+	return _mm_shuffle_ps(c, c, SHUFFLE_PARAM(1, 2, 0, 3));
+}
+
+static inline __m128 Dot3(__m128 a, __m128 b)
+{
+	__m128 m = _mm_mul_ps(a, b);
+	__m128 d = _mm_add_ss(m, _mm_shuffle_ps(m, m, SHUFFLE_PARAM(1, 1, 1, 1)));
+	d = _mm_add_ss(d, _mm_shuffle_ps(m, m, SHUFFLE_PARAM(2, 2, 2, 2)));
+	return _mm_replicate_x_ps(d);
+}
+
+// Normal from the two surface tangents, with the DirectXTK fallback for the
+// degenerate poles of the teapot (several control points in the same place).
+static inline __m128 SurfaceNormal(__m128 dPdu, __m128 dPdv, __m128 position, bool isMirrored)
+{
+	__m128 normal	= Cross(dPdv, dPdu);
+	__m128 length2	= Dot3(normal, normal);
+
+	if (_mm_cvtss_f32(length2) > NORMAL_EPSILON)
+	{
+		normal = _mm_div_ps(normal, _mm_sqrt_ps(length2));
+		return (isMirrored) ? _mm_sub_ps(_mm_setzero_ps(), normal) : normal;
+	}
+
+	float y = _mm_cvtss_f32(_mm_replicate_y_ps(position));
+	return _mm_set_ps(0.0f, 0.0f, (y < 0.0f) ? -1.0f : 1.0f, 0.0f);
+}
+
+// Lexicographic order on the end points decides a canonical direction for an edge,
+// so both patches sharing it evaluate the exact same expressions.
+static bool IsEdgeReversed(const __m128* edge)
+{
+	for (int pair = 0; pair < 2; pair++)
+	{
+		float a[4], b[4];
+		_mm_storeu_ps(a, edge[pair]);
+		_mm_storeu_ps(b, edge[3 - pair]);
+
+		for (int c = 0; c < 3; c++)
+		{
+			if (a[c] != b[c])
+			{
+				return a[c] > b[c];
+			}
+		}
+	}
+
+	return false;
+}
+
+static inline void CanonicalEdge(const __m128* edge, __m128* canonical, bool* isReversed)
+{
+	*isReversed = IsEdgeReversed(edge);
+	for (int i = 0; i < 4; i++)
+	{
+		canonical[i] = edge[(*isReversed) ? 3 - i : i];
+	}
+}
+
+// Wang's formula on a cubic: segments needed to stay within tolerance.
+static uint32_t CurveLevel(const __m128* curve, float tolerance)
+{
+	__m128 two = _mm_set1_ps(2.0f);
+	__m128 d0 = _mm_add_ps(_mm_sub_ps(curve[0], _mm_mul_ps(curve[1], two)), curve[2]);
+	__m128 d1 = _mm_add_ps(_mm_sub_ps(curve[1], _mm_mul_ps(curve[2], two)), curve[3]);
+
+	float dd = std::sqrt(std::max(_mm_cvtss_f32(Dot3(d0, d0)), _mm_cvtss_f32(Dot3(d1, d1))));
+	float n = std::ceil(std::sqrt(0.75f * dd / tolerance));
+
+	return static_cast<uint32_t>(std::min(std::max(n, 1.0f), static_cast<float>(PatchTessellator::MAX_LEVEL)));
+}
+
+static inline void LoadControlPoints(const vec4f controlPoints[16], __m128* p)
+{
+	// Positions only: drop w so it never leaks into dot products.
+	const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+	for (int i = 0; i < 16; i++)
+	{
+		p[i] = _mm_and_ps(_mm_loadu_ps(controlPoints[i].data), xyzMask);
+	}
+}
+
+static inline void StoreVertex(PatchVertex& vertex, __m128 position, __m128 normal)
+{
+	float p[4], n[4];
+	_mm_storeu_ps(p, position);
+	_mm_storeu_ps(n, normal);
+
+	vertex.mPosition	= vec3f(p[0], p[1], p[2]);
+	vertex.mNormal		= vec3f(n[0], n[1], n[2]);
+}
+
+#pragma endregion
+
+PatchTessellator::PatchTessellator()
+{
+	memset(mTables, 0, sizeof(mTables));
+}
+
+PatchTessellator::~PatchTessellator()
+{
+	for (uint32_t i = 0; i <= MAX_LEVEL; i++)
+	{
+		delete mTables[i];
+		mTables[i] = nullptr;
+	}
+}
+
+const PatchTessellator::BasisTable& PatchTessellator::GetBasisTable(uint32_t level)
+{
+	if (mTables[level] == nullptr)
+	{
+		BasisTable* table = new BasisTable();
+		table->mBasis.resize((level + 1) * 4);
+		table->mDerivative.resize((level + 1) * 4);
+
+		for (uint32_t i = 0; i <= level; i++)
+		{
+			ComputeBasis(static_cast<float>(i) / level, &table->mBasis[i * 4], &table->mDerivative[i * 4]);
+		}
+
+		mTables[level] = table;
+	}
+
+	return *mTables[level];
+}
+
+void PatchTessellator::ComputeLevels(const vec4f controlPoints[16], float tolerance, PatchTessellationLevels* levels) const
+{
+	__m128 p[16];
+	LoadControlPoints(controlPoints, p);
+
+	tolerance = std::max(tolerance, 1.0e-6f);
+
+	uint32_t interior = 1;
+	for (int e = 0; e < 4; e++)
+	{
+		__m128 edge[4], canonical[4];
+		bool isReversed;
+		for (int i = 0; i < 4; i++)
+		{
+			edge[i] = p[EDGE_CONTROL_POINTS[e][i]];
+		}
+
+		// Canonical order keeps the level identical for the neighbouring patch.
+		CanonicalEdge(edge, canonical, &isReversed);
+		levels->mEdges[e] = CurveLevel(canonical, tolerance);
+		interior = std::max(interior, levels->mEdges[e]);
+	}
+
+	// Inner rows and columns.
+	for (int i = 1; i < 3; i++)
+	{
+		__m128 column[4] = { p[i], p[4 + i], p[8 + i], p[12 + i] };
+		interior = std::max(interior, CurveLevel(&p[i * 4], tolerance));
+		interior = std::max(interior, CurveLevel(column, tolerance));
+	}
+
+	levels->mInterior = interior;
+}
+
+void PatchTessellator::Tessellate(const vec4f controlPoints[16], uint32_t level, bool isMirrored, std::vector<PatchVertex>& vertices, std::vector<uint32_t>& indices)
+{
+	PatchTessellationLevels levels = { { level, level, level, level }, level };
+	Tessellate(controlPoints, levels, isMirrored, vertices, indices);
+}
+
+void PatchTessellator::Tessellate(const vec4f controlPoints[16], const PatchTessellationLevels& levels, bool isMirrored, std::vector<PatchVertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const uint32_t n		= std::min(std::max(levels.mInterior, 1u), MAX_LEVEL);
+	const uint32_t stride	= n + 1;
+	const BasisTable& table	= GetBasisTable(n);
+	const float scale		= 1.0f / n;
+
+	__m128 p[16];
+	LoadControlPoints(controlPoints, p);
+
+	uint32_t base = static_cast<uint32_t>(vertices.size());
+	vertices.resize(base + stride * stride);
+	PatchVertex* out = &vertices[base];
+
+	// Grid: vertex (i, j) sits at u = i / n, v = j / n.
+	for (uint32_t i = 0; i <= n; i++)
+	{
+		const float* bu		= &table.mBasis[i * 4];
+		const float* dbu	= &table.mDerivative[i * 4];
+
+		// Collapse every row of the net along u once, then sweep v.
+		__m128 rows[4], rowTangents[4];
+		for (int r = 0; r < 4; r++)
+		{
+			rows[r]			= Combine(bu, &p[r * 4]);
+			rowTangents[r]	= Combine(dbu, &p[r * 4]);
+		}
+
+		float u = (isMirrored) ? 1.0f - i * scale : i * scale;
+		for (uint32_t j = 0; j <= n; j++)
+		{
+			const float* bv		= &table.mBasis[j * 4];
+			const float* dbv	= &table.mDerivative[j * 4];
+
+			__m128 position	= Combine(bv, rows);
+			__m128 dPdv		= Combine(dbv, rows);
+			__m128 dPdu		= Combine(bv, rowTangents);
+
+			PatchVertex& vertex = out[i * stride + j];
+			StoreVertex(vertex, position, SurfaceNormal(dPdu, dPdv, position, isMirrored));
+			vertex.mUV = vec2f(u, j * scale);
+		}
+	}
+
+	// Snap boundary vertices to their edge level and evaluate them from the
+	// canonical edge curve. remap points every vertex at the one it collapsed onto;
+	// corners never collapse, so no target is itself remapped.
+	std::vector<uint32_t>& remap = mRemap;
+	remap.resize(stride * stride);
+	for (uint32_t v = 0; v < remap.size(); v++)
+	{
+		remap[v] = v;
+	}
+
+	for (int e = 0; e < 4; e++)
+	{
+		const uint32_t edgeLevel = std::min(std::max(levels.mEdges[e], 1u), n);
+		const BasisTable& edgeTable = GetBasisTable(edgeLevel);
+
+		__m128 edge[4], canonical[4];
+		bool isReversed;
+		for (int k = 0; k < 4; k++)
+		{
+			edge[k] = p[EDGE_CONTROL_POINTS[e][k]];
+		}
+
+		CanonicalEdge(edge, canonical, &isReversed);
+
+		auto edgeVertex = [e, n, stride](uint32_t k)
+		{
+			uint32_t i = (e == 0 || e == 2) ? k : ((e == 1) ? n : 0);
+			uint32_t j = (e == 1 || e == 3) ? k : ((e == 0) ? 0 : n);
+			return i * stride + j;
+		};
+
+		uint32_t first = 0;
+		uint32_t previous = UINT32_MAX;
+		for (uint32_t k = 0; k <= n; k++)
+		{
+			// Nearest edge sample, in integers so both neighbours agree.
+			uint32_t s = (k * edgeLevel * 2 + n) / (n * 2);
+			uint32_t sample = (isReversed) ? edgeLevel - s : s;
+			uint32_t vertex = edgeVertex(k);
+
+			if (s == previous && k < n)
+			{
+				remap[vertex] = edgeVertex(first);
+				continue;
+			}
+
+			if (s == previous)
+			{
+				// Corners are shared with the next edge, so the run collapses onto the
+				// corner instead. Remapped vertices then always point at evaluated ones.
+				for (uint32_t r = first; r < k; r++)
+				{
+					remap[edgeVertex(r)] = vertex;
+				}
+			}
+
+			previous	= s;
+			first		= k;
+
+			__m128 position = Combine(&edgeTable.mBasis[sample * 4], canonical);
+
+			if (edgeLevel == n)
+			{
+				// Grid parameter already matches, only the position is replaced.
+				float xyz[4];
+				_mm_storeu_ps(xyz, position);
+				out[vertex].mPosition = vec3f(xyz[0], xyz[1], xyz[2]);
+				continue;
+			}
+
+			// Re-evaluate the normal at the snapped parameter.
+			float t = static_cast<float>(s) / edgeLevel;
+			float uParameter = (e == 0 || e == 2) ? t : ((e == 1) ? 1.0f : 0.0f);
+			float vParameter = (e == 1 || e == 3) ? t : ((e == 0) ? 0.0f : 1.0f);
+
+			float bu[4], dbu[4], bv[4], dbv[4];
+			ComputeBasis(uParameter, bu, dbu);
+			ComputeBasis(vParameter, bv, dbv);
+
+			__m128 rows[4], rowTangents[4];
+			for (int r = 0; r < 4; r++)
+			{
+				rows[r]			= Combine(bu, &p[r * 4]);
+				rowTangents[r]	= Combine(dbu, &p[r * 4]);
+			}
+
+			__m128 dPdv = Combine(dbv, rows);
+			__m128 dPdu = Combine(bv, rowTangents);
+
+			StoreVertex(out[vertex], position, SurfaceNormal(dPdu, dPdv, position, isMirrored));
+			out[vertex].mUV = vec2f((isMirrored) ? 1.0f - uParameter : uParameter, vParameter);
+		}
+	}
+
+	// Two triangles per quad, dropping the ones collapsed by edge snapping.
+	indices.reserve(indices.size() + n * n * 6);
+	for (uint32_t i = 0; i < n; i++)
+	{
+		for (uint32_t j = 0; j < n; j++)
+		{
+			uint32_t quad[6] =
+			{
+				remap[i * stride + j],
+				remap[(i + 1) * stride + j],
+				remap[(i + 1) * stride + j + 1],
+				remap[i * stride + j],
+				remap[(i + 1) * stride + j + 1],
+				remap[i * stride + j + 1]
+			};
+
+			for (int t = 0; t < 6; t += 3)
+			{
+				uint32_t a = quad[t], b = quad[t + 1], c = quad[t + 2];
+				if (a == b || b == c || a == c)
+				{
+					continue;
+				}
+
+				// Mirrored patches flip the winding order.
+				indices.push_back(base + ((isMirrored) ? c : a));
+				indices.push_back(base + b);
+				indices.push_back(base + ((isMirrored) ? a : c));
+			}
+		}
+	}
+}
+
+void PatchTessellator::TessellateAdaptive(const vec4f* controlPoints, uint32_t patchCount, float tolerance, std::vector<PatchVertex>& vertices, std::vector<uint32_t>& indices)
+{
+	PatchTessellationLevels levels;
+	for (uint32_t i = 0; i < patchCount; i++)
+	{
+		ComputeLevels(&controlPoints[i * 16], tolerance, &levels);
+		Tessellate(&controlPoints[i * 16], levels, false, vertices, indices);
+	}
+}
@@ -0,0 +1,70 @@
+// PatchTessellator
+//
+// Headless tessellator for bicubic Bezier patches (4x4 control nets, row major,
+// u along a row and v across rows, the same layout as the DirectXTK teapot).
+// Positions and normals are evaluated with SSE over a (u, v) grid using basis
+// tables that are built once per tessellation level and shared by every patch.
+//
+// Adaptive tessellation picks one level per patch edge from the edge control
+// points alone, so two patches sharing an edge always agree on it. Boundary
+// vertices are evaluated from the edge curve in a canonical direction, which
+// makes shared edges bitwise identical and the mesh free of cracks.
+//
+// References:	http://www.idav.ucdavis.edu/education/CAGDNotes/Matrix-Cubic-Bezier-Curve/Matrix-Cubic-Bezier-Curve.html
+//				https://developer.nvidia.com/gpugems/GPUGems2/gpugems2_chapter07.html
+
+#pragma once
+#include "Bezier.h"
+#include <vector>
+#include <stdint.h>
+
+struct PatchVertex
+{
+	vec3f mPosition;
+	vec3f mNormal;
+	vec2f mUV;
+};
+
+// Edge order: 0 (v = 0), 1 (u = 1), 2 (v = 1), 3 (u = 0).
+struct PatchTessellationLevels
+{
+	uint32_t mEdges[4];
+	uint32_t mInterior;
+};
+
+class PatchTessellator
+{
+public:
+	static const uint32_t MAX_LEVEL = 64;
+
+	PatchTessellator();
+	~PatchTessellator();
+
+	// Picks per edge and interior levels so the surface stays within tolerance.
+	void ComputeLevels(const vec4f controlPoints[16], float tolerance, PatchTessellationLevels* levels) const;
+
+	// Uniform tessellation: level quads along u and v.
+	void Tessellate(const vec4f controlPoints[16], uint32_t level, bool isMirrored, std::vector<PatchVertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Crack free tessellation with per edge levels. Edge levels must not exceed the interior level.
+	void Tessellate(const vec4f controlPoints[16], const PatchTessellationLevels& levels, bool isMirrored, std::vector<PatchVertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Tessellates patchCount patches (16 control points each) with adaptive levels.
+	void TessellateAdaptive(const vec4f* controlPoints, uint32_t patchCount, float tolerance, std::vector<PatchVertex>& vertices, std::vector<uint32_t>& indices);
+
+private:
+	// Bernstein weights and their derivatives at t = i / level, 4 floats per sample.
+	struct BasisTable
+	{
+		std::vector<float> mBasis;
+		std::vector<float> mDerivative;
+	};
+
+	BasisTable*				mTables[MAX_LEVEL + 1];
+	std::vector<uint32_t>	mRemap;		// scratch: grid vertex -> vertex it collapsed onto
+
+	const BasisTable& GetBasisTable(uint32_t level);
+
+	PatchTessellator(PatchTessellator const&) = delete;
+	void operator=(PatchTessellator const&) = delete;
+};
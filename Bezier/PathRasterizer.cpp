@@ -0,0 +1,533 @@
+#include "PathRasterizer.h"
+#include "Memory\Memory\ScratchAllocator.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+using namespace Rig3D;
+
+static const float DEFAULT_TOLERANCE	= 0.25f;
+static const uint32_t MAX_SUBDIVISIONS	= 1024;
+
+// File scope so ResolveCoverageSIMD and the resolve loop don't check a guard per call.
+static const __m128 SIMD_SIGN_MASK		= _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+static const __m128 SIMD_HALF			= _mm_set1_ps(0.5f);
+static const __m128 SIMD_ONE			= _mm_set1_ps(1.0f);
+static const __m128 SIMD_TWO			= _mm_set1_ps(2.0f);
+static const __m128 SIMD_255			= _mm_set1_ps(255.0f);
+
+#pragma region BezierPath
+
+void BezierPath::MoveTo(float x, float y)
+{
+	mContours.push_back(static_cast<uint32_t>(mPoints.size()));
+	mPoints.push_back(vec2f(x, y));
+}
+
+void BezierPath::LineTo(float x, float y)
+{
+	if (mContours.empty())
+	{
+		return;
+	}
+
+	// Lines are stored as cubics with control points on the segment.
+	const vec2f& p0 = mPoints.back();
+	vec2f p3(x, y);
+	vec2f delta = (p3 - p0) / 3.0f;
+
+	mPoints.push_back(p0 + delta);
+	mPoints.push_back(p3 - delta);
+	mPoints.push_back(p3);
+}
+
+void BezierPath::CubicTo(float x1, float y1, float x2, float y2, float x3, float y3)
+{
+	if (mContours.empty())
+	{
+		return;
+	}
+
+	mPoints.push_back(vec2f(x1, y1));
+	mPoints.push_back(vec2f(x2, y2));
+	mPoints.push_back(vec2f(x3, y3));
+}
+
+void BezierPath::Close()
+{
+	if (mContours.empty())
+	{
+		return;
+	}
+
+	const vec2f& first	= mPoints[mContours.back()];
+	const vec2f& last	= mPoints.back();
+
+	if (first.x != last.x || first.y != last.y)
+	{
+		LineTo(first.x, first.y);
+	}
+}
+
+void BezierPath::Clear()
+{
+	mPoints.clear();
+	mContours.clear();
+}
+
+#pragma endregion
+
+#pragma region PathRasterizer
+
+PathRasterizer::PathRasterizer(ThreadPool* threadPool) : mThreadPool(threadPool), mTolerance(DEFAULT_TOLERANCE)
+{
+
+}
+
+PathRasterizer::~PathRasterizer()
+{
+	mThreadPool = nullptr;
+}
+
+void PathRasterizer::SetTolerance(float tolerance)
+{
+	mTolerance = std::max(tolerance, 0.001f);
+}
+
+void PathRasterizer::RasterizeCoverage(const BezierPath& path, FillRule rule, uint32_t width, uint32_t height, uint8_t* coverage, uint32_t stride)
+{
+	Target target = { rule, width, height, coverage, stride, nullptr };
+	Rasterize(path, target);
+}
+
+void PathRasterizer::RasterizeRGBA8(const BezierPath& path, FillRule rule, const uint8_t color[4], uint32_t width, uint32_t height, uint8_t* rgba, uint32_t stride)
+{
+	Target target = { rule, width, height, rgba, stride, color };
+	Rasterize(path, target);
+}
+
+void PathRasterizer::Rasterize(const BezierPath& path, const Target& target)
+{
+	if (target.mWidth == 0 || target.mHeight == 0)
+	{
+		return;
+	}
+
+	Flatten(path, static_cast<float>(target.mWidth));
+	BinEdges(target.mHeight);
+
+	uint32_t tileRowCount	= (target.mHeight + TILE_SIZE - 1) / TILE_SIZE;
+	uint32_t threadCount	= (mThreadPool) ? mThreadPool->GetWorkerCount() + 1 : 1;
+	uint32_t grainSize		= std::max(tileRowCount / (threadCount * 4), 1u);
+
+	auto rasterizeTileRows = [&](uint32_t begin, uint32_t end)
+	{
+		// One scratch buffer per chunk, taken from the thread's scratch arena. The row
+		// resolve clears what it touched, so the buffer can be reused by the next tile
+		// row without a memset.
+		cliqCity::memory::ScratchScope scratch;
+
+		size_t accumulationCount	= (target.mWidth + 2) * TILE_SIZE;
+		float* accumulation			= scratch.Allocate<float>(accumulationCount);
+		int32_t* spans				= scratch.Allocate<int32_t>(TILE_SIZE * 2);
+		uint8_t* coverage			= scratch.Allocate<uint8_t>(target.mWidth);
+
+		// Targets too wide for the arena fall back to the heap.
+		std::vector<uint8_t> fallback;
+		if (!accumulation || !spans || !coverage)
+		{
+			fallback.resize(accumulationCount * sizeof(float) + TILE_SIZE * 2 * sizeof(int32_t) + target.mWidth);
+			accumulation	= reinterpret_cast<float*>(&fallback[0]);
+			spans			= reinterpret_cast<int32_t*>(accumulation + accumulationCount);
+			coverage		= reinterpret_cast<uint8_t*>(spans + TILE_SIZE * 2);
+		}
+
+		memset(accumulation, 0, accumulationCount * sizeof(float));
+
+		for (uint32_t tileRow = begin; tileRow < end; tileRow++)
+		{
+			RasterizeTileRow(tileRow, target, accumulation, spans, coverage);
+		}
+	};
+
+	if (mThreadPool)
+	{
+		mThreadPool->ParallelFor(tileRowCount, grainSize, rasterizeTileRows);
+	}
+	else
+	{
+		rasterizeTileRows(0, tileRowCount);
+	}
+}
+
+void PathRasterizer::Flatten(const BezierPath& path, float width)
+{
+	mEdges.clear();
+
+	const std::vector<vec2f>& points = path.mPoints;
+	for (size_t c = 0; c < path.mContours.size(); c++)
+	{
+		uint32_t start	= path.mContours[c];
+		uint32_t end	= (c + 1 < path.mContours.size()) ? path.mContours[c + 1] : static_cast<uint32_t>(points.size());
+
+		uint32_t i = start;
+		for (; i + 3 < end; i += 3)
+		{
+			FlattenSegment(points[i], points[i + 1], points[i + 2], points[i + 3], width);
+		}
+
+		// Implicitly close the contour.
+		AddLine(points[i].x, points[i].y, points[start].x, points[start].y, width);
+	}
+}
+
+void PathRasterizer::FlattenSegment(const vec2f& p0, const vec2f& p1, const vec2f& p2, const vec2f& p3, float width)
+{
+	// Wang's formula: number of uniform steps that keeps the polyline within tolerance.
+	float dd = std::max((p0 - p1 * 2.0f + p2).magnitude(), (p1 - p2 * 2.0f + p3).magnitude());
+	uint32_t n = static_cast<uint32_t>(std::ceil(std::sqrt(0.75f * dd / mTolerance)));
+	n = std::min(std::max(n, 1u), MAX_SUBDIVISIONS);
+
+	if (n == 1)
+	{
+		AddLine(p0.x, p0.y, p3.x, p3.y, width);
+		return;
+	}
+
+	Bezier bezier;
+	bezier.p0 = vec4f(p0.x, p0.y, 0.0f, 0.0f);
+	bezier.p1 = vec4f(p1.x, p1.y, 0.0f, 0.0f);
+	bezier.p2 = vec4f(p2.x, p2.y, 0.0f, 0.0f);
+	bezier.p3 = vec4f(p3.x, p3.y, 0.0f, 0.0f);
+
+	vec4f point;
+	float x = p0.x;
+	float y = p0.y;
+	float step = 1.0f / n;
+	for (uint32_t i = 1; i < n; i++)
+	{
+		bezier.EvaluateSIMD(i * step, &point);
+		AddLine(x, y, point.x, point.y, width);
+		x = point.x;
+		y = point.y;
+	}
+
+	AddLine(x, y, p3.x, p3.y, width);
+}
+
+void PathRasterizer::AddLine(float x0, float y0, float x1, float y1, float width)
+{
+	if (y0 == y1)
+	{
+		return;
+	}
+
+	// Split at x = 0 and x = width. Pieces outside are clamped into vertical edges
+	// on the image border so their winding still reaches the pixels to the right.
+	float t[4] = { 0.0f, 1.0f, 1.0f, 1.0f };
+	uint32_t count = 1;
+
+	float dx = x1 - x0;
+	if ((x0 < 0.0f) != (x1 < 0.0f))
+	{
+		t[count++] = -x0 / dx;
+	}
+
+	if ((x0 < width) != (x1 < width))
+	{
+		t[count++] = (width - x0) / dx;
+	}
+
+	t[count++] = 1.0f;
+	std::sort(t, t + count);
+
+	float dy = y1 - y0;
+	for (uint32_t i = 0; i + 1 < count; i++)
+	{
+		float ax = (i == 0) ? x0 : x0 + dx * t[i];
+		float ay = (i == 0) ? y0 : y0 + dy * t[i];
+		float bx = (i + 2 == count) ? x1 : x0 + dx * t[i + 1];
+		float by = (i + 2 == count) ? y1 : y0 + dy * t[i + 1];
+
+		AddClippedLine(std::min(std::max(ax, 0.0f), width), ay, std::min(std::max(bx, 0.0f), width), by);
+	}
+}
+
+void PathRasterizer::AddClippedLine(float x0, float y0, float x1, float y1)
+{
+	if (y0 == y1)
+	{
+		return;
+	}
+
+	Edge edge;
+	if (y0 < y1)
+	{
+		edge = { x0, y0, x1, y1, 1.0f };
+	}
+	else
+	{
+		edge = { x1, y1, x0, y0, -1.0f };
+	}
+
+	mEdges.push_back(edge);
+}
+
+void PathRasterizer::BinEdges(uint32_t height)
+{
+	uint32_t tileRowCount = (height + TILE_SIZE - 1) / TILE_SIZE;
+	float tileScale = 1.0f / TILE_SIZE;
+
+	mTileRowOffsets.assign(tileRowCount + 1, 0);
+
+	// Two passes: count edges per tile row, then scatter into a flat array.
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (uint32_t e = 0; e < mEdges.size(); e++)
+		{
+			const Edge& edge = mEdges[e];
+			if (edge.y1 <= 0.0f || edge.y0 >= height)
+			{
+				continue;
+			}
+
+			int32_t first	= std::max(static_cast<int32_t>(std::floor(edge.y0 * tileScale)), 0);
+			int32_t last	= std::min(static_cast<int32_t>(std::ceil(edge.y1 * tileScale)) - 1, static_cast<int32_t>(tileRowCount) - 1);
+
+			for (int32_t row = first; row <= last; row++)
+			{
+				if (pass == 0)
+				{
+					mTileRowOffsets[row + 1]++;
+				}
+				else
+				{
+					mTileRowEdges[mTileRowOffsets[row]++] = e;
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			for (uint32_t row = 0; row < tileRowCount; row++)
+			{
+				mTileRowOffsets[row + 1] += mTileRowOffsets[row];
+			}
+
+			mTileRowEdges.resize(mTileRowOffsets[tileRowCount]);
+		}
+	}
+
+	// The scatter pass advanced every offset to the start of the next row.
+	for (uint32_t row = tileRowCount; row > 0; row--)
+	{
+		mTileRowOffsets[row] = mTileRowOffsets[row - 1];
+	}
+
+	mTileRowOffsets[0] = 0;
+}
+
+static inline float ResolveCoverage(float accumulated, FillRule rule)
+{
+	float area = std::fabs(accumulated);
+	if (rule == FILL_RULE_NONZERO)
+	{
+		return std::min(area, 1.0f);
+	}
+
+	float folded = area - 2.0f * std::floor(area * 0.5f);
+	return std::min(folded, 2.0f - folded);
+}
+
+static inline __m128 ResolveCoverageSIMD(__m128 accumulated, FillRule rule)
+{
+	__m128 area = _mm_andnot_ps(SIMD_SIGN_MASK, accumulated);
+	if (rule == FILL_RULE_NONZERO)
+	{
+		return _mm_min_ps(area, SIMD_ONE);
+	}
+
+	// area is non negative so truncation is floor.
+	__m128 pairs	= _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(area, SIMD_HALF)));
+	__m128 folded	= _mm_sub_ps(area, _mm_mul_ps(pairs, SIMD_TWO));
+	return _mm_min_ps(folded, _mm_sub_ps(SIMD_TWO, folded));
+}
+
+void PathRasterizer::RasterizeTileRow(uint32_t tileRow, const Target& target, float* accumulation, int32_t* spans, uint8_t* coverage) const
+{
+	const int32_t width		= static_cast<int32_t>(target.mWidth);
+	const int32_t stride	= width + 2;
+	const uint32_t top		= tileRow * TILE_SIZE;
+	const uint32_t rowCount	= std::min(TILE_SIZE, target.mHeight - top);
+	const float right		= static_cast<float>(width);
+
+	for (uint32_t y = 0; y < rowCount; y++)
+	{
+		spans[y * 2]		= INT_MAX;
+		spans[y * 2 + 1]	= -1;
+	}
+
+	// Accumulate signed area and cover of every edge crossing this tile row.
+	for (uint32_t i = mTileRowOffsets[tileRow]; i < mTileRowOffsets[tileRow + 1]; i++)
+	{
+		const Edge& edge = mEdges[mTileRowEdges[i]];
+
+		float dxdy	= (edge.x1 - edge.x0) / (edge.y1 - edge.y0);
+		float y0	= edge.y0 - top;
+		float y1	= std::min(edge.y1 - top, static_cast<float>(rowCount));
+		float x		= edge.x0;
+
+		if (y0 < 0.0f)
+		{
+			x = std::min(std::max(x - y0 * dxdy, 0.0f), right);
+			y0 = 0.0f;
+		}
+
+		if (y0 >= y1)
+		{
+			continue;
+		}
+
+		int32_t yEnd = static_cast<int32_t>(std::ceil(y1));
+		for (int32_t y = static_cast<int32_t>(y0); y < yEnd; y++)
+		{
+			float* row = accumulation + y * stride;
+
+			float dy	= std::min(static_cast<float>(y + 1), y1) - std::max(static_cast<float>(y), y0);
+			float xNext	= std::min(std::max(x + dxdy * dy, 0.0f), right);
+			float d		= dy * edge.direction;
+
+			float xa = std::min(x, xNext);
+			float xb = std::max(x, xNext);
+
+			float xaFloor	= std::floor(xa);
+			int32_t xai		= static_cast<int32_t>(xaFloor);
+			int32_t xbi		= static_cast<int32_t>(std::ceil(xb));
+
+			if (xbi <= xai + 1)
+			{
+				// Edge stays inside one pixel on this scanline.
+				float xmf = 0.5f * (x + xNext) - xaFloor;
+				row[xai]		+= d - d * xmf;
+				row[xai + 1]	+= d * xmf;
+				xbi = xai + 1;
+			}
+			else
+			{
+				float s		= 1.0f / (xb - xa);
+				float xaf	= xa - xaFloor;
+				float a0	= 0.5f * s * (1.0f - xaf) * (1.0f - xaf);
+				float xbf	= xb - xbi + 1.0f;
+				float am	= 0.5f * s * xbf * xbf;
+
+				row[xai] += d * a0;
+				if (xbi == xai + 2)
+				{
+					row[xai + 1] += d * (1.0f - a0 - am);
+				}
+				else
+				{
+					float a1 = s * (1.5f - xaf);
+					row[xai + 1] += d * (a1 - a0);
+					for (int32_t xi = xai + 2; xi < xbi - 1; xi++)
+					{
+						row[xi] += d * s;
+					}
+
+					float a2 = a1 + (xbi - xai - 3) * s;
+					row[xbi - 1] += d * (1.0f - a2 - am);
+				}
+
+				row[xbi] += d * am;
+			}
+
+			spans[y * 2]		= std::min(spans[y * 2], xai);
+			spans[y * 2 + 1]	= std::max(spans[y * 2 + 1], xbi);
+
+			x = xNext;
+		}
+	}
+
+	// Resolve each scanline. Only the touched span needs a prefix sum: closed
+	// contours bring the running sum back to zero after the last edge.
+	uint8_t coverageRow[4];
+
+	for (uint32_t y = 0; y < rowCount; y++)
+	{
+		uint8_t* pixels = target.mPixels + (top + y) * target.mStride;
+		uint8_t* output = (target.mColor) ? coverage : pixels;
+
+		int32_t spanStart	= spans[y * 2];
+		int32_t spanEnd		= spans[y * 2 + 1];
+		if (spanStart > spanEnd)
+		{
+			if (!target.mColor)
+			{
+				memset(pixels, 0, width);
+			}
+			continue;
+		}
+
+		float* row		= accumulation + y * stride;
+		int32_t start	= spanStart;
+		int32_t end		= std::min(width, spanEnd + 1);
+
+		if (!target.mColor)
+		{
+			memset(pixels, 0, start);
+			memset(pixels + end, 0, width - end);
+		}
+
+		__m128 carry = _mm_setzero_ps();
+		int32_t x = start;
+		for (; x + 4 <= end; x += 4)
+		{
+			__m128 v = _mm_loadu_ps(row + x);
+			v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+			v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+			v = _mm_add_ps(v, carry);
+			carry = _mm_replicate_w_ps(v);
+
+			// + 0.5 and truncate, as the scalar tail does; cvtps rounds halves to even.
+			__m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(ResolveCoverageSIMD(v, target.mRule), SIMD_255), SIMD_HALF));
+			c = _mm_packs_epi32(c, c);
+			c = _mm_packus_epi16(c, c);
+			*reinterpret_cast<int32_t*>(coverageRow) = _mm_cvtsi128_si32(c);
+			memcpy(output + x, coverageRow, 4);
+		}
+
+		float sum = _mm_cvtss_f32(carry);
+		for (; x < end; x++)
+		{
+			sum += row[x];
+			output[x] = static_cast<uint8_t>(ResolveCoverage(sum, target.mRule) * 255.0f + 0.5f);
+		}
+
+		// Leave the buffer zeroed for the next tile row.
+		memset(row + start, 0, (std::min(spanEnd, width + 1) - start + 1) * sizeof(float));
+
+		if (target.mColor)
+		{
+			const uint8_t* color = target.mColor;
+			for (x = start; x < end; x++)
+			{
+				uint32_t alpha = (output[x] * color[3] + 127) / 255;
+				if (alpha == 0)
+				{
+					continue;
+				}
+
+				uint8_t* pixel = pixels + x * 4;
+				uint32_t inverse = 255 - alpha;
+				pixel[0] = static_cast<uint8_t>((color[0] * alpha + pixel[0] * inverse + 127) / 255);
+				pixel[1] = static_cast<uint8_t>((color[1] * alpha + pixel[1] * inverse + 127) / 255);
+				pixel[2] = static_cast<uint8_t>((color[2] * alpha + pixel[2] * inverse + 127) / 255);
+				pixel[3] = static_cast<uint8_t>(alpha + (pixel[3] * inverse + 127) / 255);
+			}
+		}
+	}
+}
+
+#pragma endregion
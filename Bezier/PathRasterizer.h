@@ -0,0 +1,90 @@
+// PathRasterizer
+//
+// CPU filler for closed shapes made of cubic Bezier segments.
+// Segments are flattened with Bezier::EvaluateSIMD, the resulting edges are binned
+// into tile rows and every tile row accumulates signed area into a sparse scanline
+// buffer that is resolved to anti-aliased coverage with an SSE prefix sum.
+//
+// References:	https://medium.com/@raphlinus/inside-the-fastest-font-renderer-in-the-world-75ae5270c445
+//				http://www.antigrain.com/research/adaptive_bezier/
+
+#pragma once
+#include "Bezier.h"
+#include "Rig3D\Common\ThreadPool.h"
+#include <vector>
+#include <stdint.h>
+
+enum FillRule
+{
+	FILL_RULE_NONZERO,
+	FILL_RULE_EVEN_ODD
+};
+
+// A set of contours in pixel space. Each contour starts with MoveTo and is
+// closed implicitly when rasterized; segments before the first MoveTo are ignored.
+class BezierPath
+{
+public:
+	std::vector<vec2f>		mPoints;	// p0 followed by (c1, c2, p3) triplets for each contour
+	std::vector<uint32_t>	mContours;	// index into mPoints where each contour starts
+
+	BezierPath() { }
+	~BezierPath() { }
+
+	void MoveTo(float x, float y);
+	void LineTo(float x, float y);
+	void CubicTo(float x1, float y1, float x2, float y2, float x3, float y3);
+	void Close();
+	void Clear();
+};
+
+class PathRasterizer
+{
+public:
+	static const uint32_t TILE_SIZE = 16;
+
+	PathRasterizer(Rig3D::ThreadPool* threadPool);
+	~PathRasterizer();
+
+	// Maximum distance in pixels between a curve and its flattened polyline.
+	void SetTolerance(float tolerance);
+
+	// Writes 8 bit coverage (0 outside, 255 inside) for every pixel.
+	void RasterizeCoverage(const BezierPath& path, FillRule rule, uint32_t width, uint32_t height, uint8_t* coverage, uint32_t stride);
+
+	// Blends color (straight RGBA) over the image with source-over, weighted by coverage.
+	void RasterizeRGBA8(const BezierPath& path, FillRule rule, const uint8_t color[4], uint32_t width, uint32_t height, uint8_t* rgba, uint32_t stride);
+
+private:
+	struct Edge
+	{
+		float x0, y0;	// y0 < y1
+		float x1, y1;
+		float direction;
+	};
+
+	struct Target
+	{
+		FillRule		mRule;
+		uint32_t		mWidth;
+		uint32_t		mHeight;
+		uint8_t*		mPixels;
+		uint32_t		mStride;
+		const uint8_t*	mColor;		// nullptr for coverage output
+	};
+
+	Rig3D::ThreadPool*		mThreadPool;
+	float					mTolerance;
+
+	std::vector<Edge>		mEdges;
+	std::vector<uint32_t>	mTileRowOffsets;	// mTileRowEdges range for each tile row (tileRowCount + 1 entries)
+	std::vector<uint32_t>	mTileRowEdges;		// edge indices binned per tile row
+
+	void Rasterize(const BezierPath& path, const Target& target);
+	void Flatten(const BezierPath& path, float width);
+	void FlattenSegment(const vec2f& p0, const vec2f& p1, const vec2f& p2, const vec2f& p3, float width);
+	void AddLine(float x0, float y0, float x1, float y1, float width);
+	void AddClippedLine(float x0, float y0, float x1, float y1);
+	void BinEdges(uint32_t height);
+	void RasterizeTileRow(uint32_t tileRow, const Target& target, float* accumulation, int32_t* spans, uint8_t* coverage) const;
+};
@@ -5,112 +5,17 @@
 #include "Rig3D\Graphics\Interface\IMesh.h"
 #include "Rig3D\Graphics\DirectX11\DX11Mesh.h"
 #include "Rig3D\Common\Transform.h"
-#include "Memory\Memory\LinearAllocator.h"
+#include "Memory\Memory\PoolAllocator.h"
 #include "Rig3D\MeshLibrary.h"
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <fstream>
-#include <fvec.h>
+#include "Bezier.h"
 
 #define PI 3.1415926535f
 
-#define SHUFFLE_PARAM(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
-#define _mm_replicate_x_ps(v) _mm_shuffle_ps((v), (v), SHUFFLE_PARAM(0, 0, 0, 0))
-#define _mm_replicate_y_ps(v) _mm_shuffle_ps((v), (v), SHUFFLE_PARAM(1, 1, 1, 1))
-#define _mm_replicate_z_ps(v) _mm_shuffle_ps((v), (v), SHUFFLE_PARAM(2, 2, 2, 2))
-#define _mm_replicate_w_ps(v) _mm_shuffle_ps((v), (v), SHUFFLE_PARAM(3, 3, 3, 3))
-#define _mm_add_mul_ps(a, b, c) _mm_add_ps(_mm_mul_ps((a), (b)), (c))
-
-#if defined(_MSC_VER)
-#define ALIGNED(x) __declspec(align(x))
-// other Alignment here..
-#endif
-
 using namespace Rig3D;
 
-// cubic degree bezier curve
-class Bezier
-{
-public:
-	union
-	{
-		struct
-		{
-			vec4f p0;
-			vec4f p1;
-			vec4f p2;
-			vec4f p3;
-		};
-		mat4f p;
-	};
-
-	Bezier() { }
-	~Bezier() { }
-
-	// Optimized SISD Cubic Bezier equation
-	// Equation based on this article:
-	// http://www.idav.ucdavis.edu/education/CAGDNotes/Matrix-Cubic-Bezier-Curve/Matrix-Cubic-Bezier-Curve.html
-	void Evaluate(const float time, vec4f* result)
-	{
-		static mat4f m = mat4f(
-			 1,  0,  0,  0,
-			-3,  3,  0,  0,
-			 3, -6,  3,  0, 
-			-1,  3, -3,  1);
-
-		vec4f t = vec4f(1.0f, time, time*time, time*time*time);
-
-		auto m0 = m.u;
-		auto m1 = m.v;
-		auto m2 = m.w;
-		auto m3 = m.t;
-
-		vec4f tM = vec4f(
-			t.data[0] * m0.data[0] + t.data[1] * m1.data[0] + t.data[2] * m2.data[0] + t.data[3] * m3.data[0],
-			t.data[0] * m0.data[1] + t.data[1] * m1.data[1] + t.data[2] * m2.data[1] + t.data[3] * m3.data[1],
-			t.data[0] * m0.data[2] + t.data[1] * m1.data[2] + t.data[2] * m2.data[2] + t.data[3] * m3.data[2],
-			t.data[0] * m0.data[3] + t.data[1] * m1.data[3] + t.data[2] * m2.data[3] + t.data[3] * m3.data[3]
-		);
-
-		(*result).data[0] = tM.data[0] * p0.data[0] + tM.data[1] * p1.data[0] + tM.data[2] * p2.data[0] + tM.data[3] * p3.data[0];
-		(*result).data[1] = tM.data[0] * p0.data[1] + tM.data[1] * p1.data[1] + tM.data[2] * p2.data[1] + tM.data[3] * p3.data[1];
-		(*result).data[2] = tM.data[0] * p0.data[2] + tM.data[1] * p1.data[2] + tM.data[2] * p2.data[2] + tM.data[3] * p3.data[2];
-		(*result).data[3] = tM.data[0] * p0.data[3] + tM.data[1] * p1.data[3] + tM.data[2] * p2.data[3] + tM.data[3] * p3.data[3];
-	}
-
-	// Optimized SIMD Cubic Bezier Equation
-	// Equation based on this article:
-	// http://www.idav.ucdavis.edu/education/CAGDNotes/Matrix-Cubic-Bezier-Curve/Matrix-Cubic-Bezier-Curve.html
-	void EvaluateSIMD(const float time, vec4f* result)
-	{
-		static mat4f m = mat4f(
-			 1,  0,  0,  0,
-			-3,  3,  0,  0,
-			 3, -6,  3,  0, 
-			-1,  3, -3,  1);
-
-		// (1, t, t^2, t^3)
-		__m128 t = _mm_set_ps(time*time*time, time*time, time, 1);
-
-		__m128 a = _mm_load_ps(m.u.data);
-
-		// Vector Matrix multiplication between t and M.
-		__m128 tM = _mm_mul_ps(_mm_replicate_x_ps(t), _mm_load_ps(m.u.data));
-		tM = _mm_add_mul_ps(_mm_replicate_y_ps(t), _mm_load_ps(m.v.data), tM);
-		tM = _mm_add_mul_ps(_mm_replicate_z_ps(t), _mm_load_ps(m.w.data), tM);
-		tM = _mm_add_mul_ps(_mm_replicate_w_ps(t), _mm_load_ps(m.t.data), tM);
-
-		// Vector Matrix multiplication between the result matrix of t*M and 
-		// the matrix P formed by the control points (p0 ... p3)
-		__m128 tMP = _mm_mul_ps(_mm_replicate_x_ps(tM), _mm_load_ps(p0.data));
-		tMP = _mm_add_mul_ps(_mm_replicate_y_ps(tM), _mm_load_ps(p1.data), tMP);
-		tMP = _mm_add_mul_ps(_mm_replicate_z_ps(tM), _mm_load_ps(p2.data), tMP);
-		tMP = _mm_add_mul_ps(_mm_replicate_w_ps(tM), _mm_load_ps(p3.data), tMP);
-
-		_mm_store_ps(result->data, tMP);
-	}
-};
-
 static const int BEZIER_VERTEX_COUNT = 100;
 static const int BEZIER_INDEX_COUNT = (BEZIER_VERTEX_COUNT - 1) * 2;
 
@@ -124,7 +29,7 @@ class Rig3DSampleScene : public IScene, public virtual IRendererDelegate
 {
 public:
 
-	typedef cliqCity::memory::LinearAllocator LinearAllocator;
+	typedef cliqCity::memory::PoolAllocator PoolAllocator;
 
 	struct BezierVertex
 	{
@@ -139,17 +44,18 @@ public:
 	};
 	
 	Bezier 					mBezier;
-	BezierMatrixBuffer		mMatrixBuffer;
+	BezierMatrixBuffer*		mMatrixBuffer;			// per frame
+	mat4f					mProjection;
 
-	LinearAllocator			mAllocator;
-	MeshLibrary<LinearAllocator> mMeshLibrary;
+	PoolAllocator			mAllocator;
+	MeshLibrary<PoolAllocator> mMeshLibrary;
 	
 	IMesh*					mBezierMesh;
 	IMesh*					mCircleMesh;
 	IMesh*					mHandlesMesh;
 
-	BezierVertex			mBezierVertices[BEZIER_VERTEX_COUNT];
-	BezierVertex			mHandlesVertices[HANDLES_VERTEX_COUNT];
+	BezierVertex*			mBezierVertices;		// per frame
+	BezierVertex*			mHandlesVertices;		// per frame
 	
 	DX3D11Renderer*			mRenderer;
 	ID3D11Device*			mDevice;
@@ -160,7 +66,7 @@ public:
 	ID3D11VertexShader*		mVertexShader;
 	ID3D11PixelShader*		mPixelShader;
 
-	Rig3DSampleScene() : mAllocator(1024)
+	Rig3DSampleScene() : mAllocator(sizeof(DX11Mesh), alignof(DX11Mesh), 4, true)
 	{
 		mOptions.mWindowCaption = "SIMD Bezier";
 		mOptions.mWindowWidth = 800;
@@ -194,11 +100,20 @@ public:
 
 		VOnResize();
 
+		AllocateFrameData();
 		InitializeGeometry();
 		InitializeShaders();
 		InitializeCamera();
 	}
 
+	// Frame allocations are rewound by the engine, so nothing here is ever freed.
+	void AllocateFrameData()
+	{
+		mBezierVertices		= (BezierVertex*)mFrameAllocator->Allocate(sizeof(BezierVertex) * BEZIER_VERTEX_COUNT, alignof(BezierVertex), 0);
+		mHandlesVertices	= (BezierVertex*)mFrameAllocator->Allocate(sizeof(BezierVertex) * HANDLES_VERTEX_COUNT, alignof(BezierVertex), 0);
+		mMatrixBuffer		= (BezierMatrixBuffer*)mFrameAllocator->Allocate(sizeof(BezierMatrixBuffer), alignof(BezierMatrixBuffer), 0);
+	}
+
 	void InitializeGeometry()
 	{
 		// ---- Bezier
@@ -313,7 +228,7 @@ public:
 
 		// Constant buffers ----------------------------------------
 		D3D11_BUFFER_DESC cBufferTransformDesc;
-		cBufferTransformDesc.ByteWidth = sizeof(mMatrixBuffer);
+		cBufferTransformDesc.ByteWidth = sizeof(BezierMatrixBuffer);
 		cBufferTransformDesc.Usage = D3D11_USAGE_DEFAULT;
 		cBufferTransformDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		cBufferTransformDesc.CPUAccessFlags = 0;
@@ -325,7 +240,7 @@ public:
 
 	void InitializeCamera()
 	{
-		mMatrixBuffer.mProjection = mat4f::normalizedOrthographicLH(-5, 5, -5, 5, 0.1f, 100.0f).transpose();
+		mProjection = mat4f::normalizedOrthographicLH(-5, 5, -5, 5, 0.1f, 100.0f).transpose();
 	}
 
 	vec3f ScreenToWorldPosition(ScreenPoint p)
@@ -340,6 +255,8 @@ public:
 	vec4f mCircleScale;
 	void VUpdate(double milliseconds) override
 	{
+		AllocateFrameData();
+
 		auto input = &Input::SharedInstance();
 
 		vec4f point;
@@ -385,8 +302,8 @@ public:
 
 		for (size_t i = 0; i < 4; i++)
 		{
-			mHandlesVertices[i].mPosition.x = mBezier.p[i].x;
-			mHandlesVertices[i].mPosition.y = mBezier.p[i].y;
+			mHandlesVertices[i].mColor = { 0.5f, 0.5f, 0.5f };
+			mHandlesVertices[i].mPosition = { mBezier.p[i].x, mBezier.p[i].y, 1.0f };
 		}
 
 		float t;
@@ -397,10 +314,12 @@ public:
 			mBezier.EvaluateSIMD(t, &point);
 			mBezier.Evaluate(t, &point);
 
+			mBezierVertices[i].mColor = { 1.0f, 1.0f, 0.0f };
 			mBezierVertices[i].mPosition = { point.x, point.y, point.z };
 		}
 
-		mMatrixBuffer.mWorld = mat4f::translate(position).transpose();
+		mMatrixBuffer->mWorld = mat4f::translate(position).transpose();
+		mMatrixBuffer->mProjection = mProjection;
 	}
 
 	void VRender() override
@@ -427,7 +346,7 @@ public:
 			mConstantBuffer,
 			0,
 			NULL,
-			&mMatrixBuffer,
+			mMatrixBuffer,
 			0,
 			0); 
 
@@ -437,14 +356,14 @@ public:
 			&mConstantBuffer);
 
 		// Bezier
-		mDeviceContext->UpdateSubresource(static_cast<DX11Mesh*>(mBezierMesh)->mVertexBuffer, 0, NULL, &mBezierVertices, 0, 0);
+		mDeviceContext->UpdateSubresource(static_cast<DX11Mesh*>(mBezierMesh)->mVertexBuffer, 0, NULL, mBezierVertices, 0, 0);
 
 		mRenderer->VSetPrimitiveType(GPU_PRIMITIVE_TYPE_LINE);
 		mRenderer->VBindMesh(mBezierMesh);
 		mRenderer->VDrawIndexed(0, mBezierMesh->GetIndexCount());
 
 		// Handles
-		mDeviceContext->UpdateSubresource(static_cast<DX11Mesh*>(mHandlesMesh)->mVertexBuffer, 0, NULL, &mHandlesVertices, 0, 0);
+		mDeviceContext->UpdateSubresource(static_cast<DX11Mesh*>(mHandlesMesh)->mVertexBuffer, 0, NULL, mHandlesVertices, 0, 0);
 
 		mRenderer->VSetPrimitiveType(GPU_PRIMITIVE_TYPE_LINE);
 		mRenderer->VBindMesh(mHandlesMesh);
@@ -454,8 +373,8 @@ public:
 		mRenderer->VSetPrimitiveType(GPU_PRIMITIVE_TYPE_TRIANGLE);
 		for (size_t i = 0; i < 4; i++)
 		{
-			mMatrixBuffer.mWorld = (mat4f::scale(mCircleScale) * mat4f::translate(mBezier.p[i])).transpose();
-			mDeviceContext->UpdateSubresource(mConstantBuffer, 0, NULL, &mMatrixBuffer, 0, 0);
+			mMatrixBuffer->mWorld = (mat4f::scale(mCircleScale) * mat4f::translate(mBezier.p[i])).transpose();
+			mDeviceContext->UpdateSubresource(mConstantBuffer, 0, NULL, mMatrixBuffer, 0, 0);
 
 			mRenderer->VBindMesh(mCircleMesh);
 			mRenderer->VDrawIndexed(0, mCircleMesh->GetIndexCount());
@@ -472,7 +391,9 @@ public:
 
 	void VShutdown() override
 	{
-		mBezierMesh->~IMesh();
+		mMeshLibrary.DeleteMesh(&mBezierMesh);
+		mMeshLibrary.DeleteMesh(&mHandlesMesh);
+		mMeshLibrary.DeleteMesh(&mCircleMesh);
 		mAllocator.Free();
 	}
 };
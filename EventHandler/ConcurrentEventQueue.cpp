@@ -0,0 +1,150 @@
+#include "ConcurrentEventQueue.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+static const size_t HEADER_SIZE = 16;
+
+static size_t RoundUpToPowerOfTwo(size_t value)
+{
+	size_t result = HEADER_SIZE * 2;
+	while (result < value)
+	{
+		result <<= 1;
+	}
+
+	return result;
+}
+
+ConcurrentEventQueue::ConcurrentEventQueue(size_t capacity) : mHead(0), mTail(0)
+{
+	static_assert(sizeof(RecordHeader) == HEADER_SIZE, "Record header must keep payloads aligned");
+
+	mCapacity	= RoundUpToPowerOfTwo(capacity);
+	mRing		= (uint8_t*)calloc(mCapacity, 1);
+}
+
+ConcurrentEventQueue::ConcurrentEventQueue() : mRing(nullptr), mCapacity(0), mHead(0), mTail(0)
+{
+}
+
+ConcurrentEventQueue::~ConcurrentEventQueue()
+{
+	mRing = nullptr;
+}
+
+void* ConcurrentEventQueue::Reserve(size_t payloadSize)
+{
+	size_t recordSize	= (HEADER_SIZE + payloadSize + (RECORD_ALIGNMENT - 1)) & ~(RECORD_ALIGNMENT - 1);
+	size_t mask			= mCapacity - 1;
+
+	assert(recordSize <= mCapacity / 2);
+
+	uint64_t head		= mHead.load(std::memory_order_relaxed);
+	size_t fillerSize	= 0;
+	do
+	{
+		// A record never wraps: fill the rest of the ring and start over at 0.
+		size_t offset	= (size_t)(head & mask);
+		fillerSize		= (offset + recordSize > mCapacity) ? mCapacity - offset : 0;
+
+		if (head + fillerSize + recordSize - mTail.load(std::memory_order_acquire) > mCapacity)
+		{
+			return nullptr;
+		}
+	} while (!mHead.compare_exchange_weak(head, head + fillerSize + recordSize, std::memory_order_relaxed));
+
+	if (fillerSize > 0)
+	{
+		RecordHeader* filler = (RecordHeader*)(mRing + (head & mask));
+		filler->mIsFiller = 1;
+		filler->mSize.store((uint32_t)fillerSize, std::memory_order_release);
+		head += fillerSize;
+	}
+
+	RecordHeader* header	= (RecordHeader*)(mRing + (head & mask));
+	header->mIsFiller		= 0;
+	header->mReserved		= (uint32_t)recordSize;
+	return (uint8_t*)header + HEADER_SIZE;
+}
+
+void ConcurrentEventQueue::Commit(void* payload, IEvent* iEvent)
+{
+	RecordHeader* header	= (RecordHeader*)((uint8_t*)payload - HEADER_SIZE);
+	header->mEventOffset	= (uint32_t)((uint8_t*)iEvent - (uint8_t*)payload);
+	header->mSize.store(header->mReserved, std::memory_order_release);
+}
+
+uint32_t ConcurrentEventQueue::Drain(IEventHandler& handler)
+{
+	size_t mask		= mCapacity - 1;
+	uint64_t tail	= mTail.load(std::memory_order_relaxed);
+	uint64_t head	= mHead.load(std::memory_order_acquire);
+	uint32_t count	= 0;
+
+	while (tail != head)
+	{
+		RecordHeader* header	= (RecordHeader*)(mRing + (tail & mask));
+		uint32_t size			= header->mSize.load(std::memory_order_acquire);
+		if (size == 0)
+		{
+			break;
+		}
+
+		if (!header->mIsFiller)
+		{
+			IEvent* iEvent = (IEvent*)((uint8_t*)header + HEADER_SIZE + header->mEventOffset);
+			handler.NotifyObservers(*iEvent);
+			iEvent->~IEvent();
+			count++;
+		}
+
+		// The next lap reads a zero size as not yet committed, at whatever offset
+		// its records land, so the payload is cleared as well as the header.
+		memset((uint8_t*)header + HEADER_SIZE, 0, size - HEADER_SIZE);
+		header->mIsFiller		= 0;
+		header->mEventOffset	= 0;
+		header->mReserved		= 0;
+		header->mSize.store(0, std::memory_order_relaxed);
+
+		tail += size;
+		mTail.store(tail, std::memory_order_release);
+	}
+
+	return count;
+}
+
+size_t ConcurrentEventQueue::GetCapacity() const
+{
+	return mCapacity;
+}
+
+void ConcurrentEventQueue::Free()
+{
+	// Destroy whatever was committed but never drained.
+	size_t mask		= mCapacity - 1;
+	uint64_t head	= mHead.load(std::memory_order_acquire);
+	for (uint64_t tail = mTail.load(std::memory_order_relaxed); mRing != nullptr && tail != head; )
+	{
+		RecordHeader* header	= (RecordHeader*)(mRing + (tail & mask));
+		uint32_t size			= header->mSize.load(std::memory_order_acquire);
+		if (size == 0)
+		{
+			break;
+		}
+
+		if (!header->mIsFiller)
+		{
+			((IEvent*)((uint8_t*)header + HEADER_SIZE + header->mEventOffset))->~IEvent();
+		}
+
+		tail += size;
+	}
+
+	free(mRing);
+
+	mRing		= nullptr;
+	mCapacity	= 0;
+	mHead.store(0, std::memory_order_relaxed);
+	mTail.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "IEventHandler.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <new>
+
+#pragma warning (disable: 4251)
+#pragma warning (disable: 4324)	// Padded for alignas
+
+#ifdef _WINDLL
+#define IEVENT_API __declspec(dllexport)
+#else
+#define IEVENT_API __declspec(dllimport)
+#endif
+
+// Bounded, lock-free queue for posting events from any thread to the thread that
+// owns an IEventHandler. Events are copied inline into a byte ring: a producer
+// reserves its record with a single compare-and-swap on the head, constructs
+// the event in place and publishes the record by storing its size. Records are
+// padded to RECORD_ALIGNMENT; one that would straddle the end of the ring is
+// preceded by a filler record up to the end.
+//
+// One consumer drains the ring through IEventHandler::NotifyObservers, destroys
+// the events and zeroes their records before handing the space back. Drain stops
+// at a record still being written, so a producer descheduled between reserving
+// and committing holds back later events until it resumes.
+//
+// References:	http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+//				https://fgiesen.wordpress.com/2010/12/14/ring-buffers-and-queues/
+class IEVENT_API ConcurrentEventQueue
+{
+public:
+	static const size_t		CACHE_LINE_SIZE		= 64;
+	static const size_t		RECORD_ALIGNMENT	= 16;
+	static const size_t		DEFAULT_CAPACITY	= 64 * 1024;
+
+	// Rounded up to a power of two.
+	ConcurrentEventQueue(size_t capacity);
+	~ConcurrentEventQueue();
+
+	// Any thread. False when the ring is full; the event is not queued.
+	template<class TEvent>
+	bool Post(const TEvent& iEvent)
+	{
+		static_assert(alignof(TEvent) <= RECORD_ALIGNMENT, "Event alignment exceeds the ring's record alignment");
+
+		void* payload = Reserve(sizeof(TEvent));
+		if (payload == nullptr)
+		{
+			return false;
+		}
+
+		Commit(payload, new (payload) TEvent(iEvent));
+		return true;
+	}
+
+	// Consumer thread only. Notifies handler of the events committed in order
+	// before the call, stopping at the first record still being written.
+	uint32_t	Drain(IEventHandler& handler);
+
+	size_t		GetCapacity() const;
+	void		Free();
+
+private:
+	struct RecordHeader
+	{
+		std::atomic<uint32_t>	mSize;		// 0 until committed
+		uint32_t				mIsFiller;
+		uint32_t				mEventOffset;	// From the payload to the IEvent base
+		uint32_t				mReserved;
+	};
+
+	uint8_t*				mRing;
+	size_t					mCapacity;
+
+	// Producers write mHead, the consumer mTail. Their offsets are a cache line
+	// apart even when the queue itself is heap allocated without the alignment.
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t>	mHead;
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t>	mTail;
+
+	void*	Reserve(size_t payloadSize);
+	void	Commit(void* payload, IEvent* iEvent);
+
+	ConcurrentEventQueue();
+	ConcurrentEventQueue(ConcurrentEventQueue const&) = delete;
+	void operator=(ConcurrentEventQueue const&) = delete;
+};
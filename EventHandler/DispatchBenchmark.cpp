@@ -0,0 +1,158 @@
+// Dispatch throughput of ObserverTable against the map of sets it replaced.
+// Standalone like Source.cpp: build it with IEventHandler.cpp, EventQueue.cpp
+// and EventLog.cpp as a console program (Release) and compare the ns per event
+// of each handler.
+
+#include "IEventHandler.h"
+#include <unordered_map>
+#include <set>
+#include <vector>
+#include <chrono>
+#include <stdio.h>
+
+static const uint32_t EVENT_ID_COUNT		= 32;
+static const uint32_t OBSERVERS_PER_EVENT	= 4;
+static const uint32_t DISPATCH_COUNT		= 1 << 22;
+
+class BenchmarkEvent : public IEvent
+{
+public:
+	uint32_t ID;
+
+	BenchmarkEvent(uint32_t id) : ID(id) {};
+	~BenchmarkEvent() {};
+};
+
+class CountingObserver : public IObserver
+{
+public:
+	uint64_t mCount;
+
+	CountingObserver() : mCount(0) {};
+
+	void HandleEvent(const IEvent& iEvent) override
+	{
+		mCount += static_cast<const BenchmarkEvent&>(iEvent).ID;
+	}
+};
+
+// The previous IEventHandler storage and NotifyObservers loop.
+class LegacyEventHandler
+{
+public:
+	typedef std::set<IObserver*>						ObserverSet;
+	typedef std::unordered_map<uint32_t, ObserverSet>	ObserverMap;
+
+	void RegisterObserver(uint32_t eventID, IObserver* observer)
+	{
+		mObservers[eventID].insert(observer);
+	}
+
+	void NotifyObservers(const IEvent& iEvent)
+	{
+		ObserverMap::iterator mapEntry = mObservers.find(static_cast<const BenchmarkEvent&>(iEvent).ID);
+		if (mapEntry != mObservers.end())
+		{
+			for (ObserverSet::const_iterator iter = mapEntry->second.begin(); iter != mapEntry->second.end(); iter++)
+			{
+				(*iter)->HandleEvent(iEvent);
+			}
+		}
+	}
+
+private:
+	ObserverMap mObservers;
+};
+
+class FlatEventHandler : public IEventHandler
+{
+public:
+	void NotifyObservers(const IEvent& iEvent) override
+	{
+		Dispatch(static_cast<const BenchmarkEvent&>(iEvent).ID, iEvent);
+	}
+};
+
+template<class Handler>
+static double MeasureNanosecondsPerEvent(Handler& handler, const std::vector<uint32_t>& sequence)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t id : sequence)
+	{
+		handler.NotifyObservers(BenchmarkEvent(id));
+	}
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / sequence.size();
+}
+
+static void RunScenario(const char* name, const uint32_t* eventIDs)
+{
+	// Interleave observers with unrelated allocations so the set nodes scatter as they would in a running game.
+	std::vector<CountingObserver*> observers;
+	std::vector<void*> noise;
+	for (uint32_t i = 0; i < EVENT_ID_COUNT * OBSERVERS_PER_EVENT; i++)
+	{
+		observers.push_back(new CountingObserver());
+		noise.push_back(new char[48 + (i * 37) % 200]);
+	}
+
+	LegacyEventHandler legacy;
+	FlatEventHandler flat;
+	for (uint32_t i = 0; i < EVENT_ID_COUNT; i++)
+	{
+		for (uint32_t j = 0; j < OBSERVERS_PER_EVENT; j++)
+		{
+			legacy.RegisterObserver(eventIDs[i], observers[(j * EVENT_ID_COUNT + i) % observers.size()]);
+			flat.RegisterObserver(eventIDs[i], observers[(j * EVENT_ID_COUNT + i) % observers.size()]);
+		}
+	}
+
+	// Mostly registered IDs, some that nobody listens to.
+	std::vector<uint32_t> sequence(DISPATCH_COUNT);
+	uint32_t state = 12345;
+	for (uint32_t& id : sequence)
+	{
+		state	= state * 1664525u + 1013904223u;
+		id		= ((state >> 24) < 230) ? eventIDs[(state >> 8) % EVENT_ID_COUNT] : eventIDs[0] + 1 + ((state >> 8) & 7);
+	}
+
+	double legacyTime	= MeasureNanosecondsPerEvent(legacy, sequence);
+	double flatTime		= MeasureNanosecondsPerEvent(flat, sequence);
+
+	uint64_t checksum = 0;
+	for (CountingObserver* observer : observers)
+	{
+		checksum += observer->mCount;
+	}
+
+	printf("%-8s map of sets %6.1f ns/event   flat table %6.1f ns/event   %.2fx   (checksum %llu)\n",
+		name, legacyTime, flatTime, legacyTime / flatTime, (unsigned long long)checksum);
+
+	for (CountingObserver* observer : observers)
+	{
+		delete observer;
+	}
+
+	for (void* block : noise)
+	{
+		delete[] (char*)block;
+	}
+}
+
+int main()
+{
+	uint32_t denseIDs[EVENT_ID_COUNT];
+	uint32_t sparseIDs[EVENT_ID_COUNT];
+	for (uint32_t i = 0; i < EVENT_ID_COUNT; i++)
+	{
+		denseIDs[i]		= 0x0100 + i * 9;			// WM_ message range
+		sparseIDs[i]	= 0x8000 + i * 104729;		// hashed, user defined IDs
+	}
+
+	RunScenario("dense", denseIDs);
+	RunScenario("sparse", sparseIDs);
+
+	return 0;
+}
@@ -0,0 +1,386 @@
+#include "DispatchStats.h"
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+
+namespace
+{
+	struct StatsEntry
+	{
+		uint32_t	mEventID;
+		const void*	mObserver;
+		const char*	mType;
+		bool		mIsUsed;
+		uint64_t	mEventCount;
+		uint64_t	mCallCount;
+		uint64_t	mTotalNanoseconds;
+		uint64_t	mMaxNanoseconds;
+		uint64_t	mHistogram[DISPATCH_HISTOGRAM_BUCKET_COUNT];
+	};
+
+	struct TagEntry
+	{
+		const void*	mObserver;
+		const char*	mTag;
+	};
+
+	// Open addressed on (event ID, observer), emptied by Reset. Records that find
+	// the table full are only counted.
+	StatsEntry	gEntries[DispatchStats::MAX_ENTRY_COUNT];
+	uint64_t	gDroppedCallCount;
+	TagEntry	gTags[DispatchStats::MAX_TAG_COUNT];
+	uint32_t	gTagCount;
+
+	const char*	DELEGATE_NAME	= "delegate";
+
+	uint32_t HashKey(uint32_t eventID, const void* observer)
+	{
+		return (eventID * 2654435761u) ^ ((uint32_t)((uintptr_t)observer >> 4) * 2246822519u);
+	}
+
+	StatsEntry* FindEntry(uint32_t eventID, const void* observer, bool isClaimed)
+	{
+		uint32_t mask	= DispatchStats::MAX_ENTRY_COUNT - 1;
+		uint32_t index	= HashKey(eventID, observer) & mask;
+
+		for (uint32_t probe = 0; probe < DispatchStats::MAX_ENTRY_COUNT; probe++)
+		{
+			StatsEntry& entry = gEntries[(index + probe) & mask];
+
+			if (!entry.mIsUsed)
+			{
+				if (!isClaimed)
+				{
+					return nullptr;
+				}
+
+				entry.mIsUsed	= true;
+				entry.mEventID	= eventID;
+				entry.mObserver	= observer;
+				return &entry;
+			}
+
+			if (entry.mEventID == eventID && entry.mObserver == observer)
+			{
+				return &entry;
+			}
+		}
+
+		return nullptr;
+	}
+
+	uint32_t GetBucket(uint64_t nanoseconds)
+	{
+		uint32_t bucket = 0;
+		while (nanoseconds > 1 && bucket < DISPATCH_HISTOGRAM_BUCKET_COUNT - 1)
+		{
+			nanoseconds >>= 1;
+			bucket++;
+		}
+
+		return bucket;
+	}
+
+	const char* FindTag(const void* observer)
+	{
+		for (uint32_t i = 0; i < gTagCount; i++)
+		{
+			if (gTags[i].mObserver == observer)
+			{
+				return gTags[i].mTag;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void CopyEntry(const StatsEntry& entry, DispatchEntryStats* stats)
+	{
+		stats->mEventID				= entry.mEventID;
+		stats->mObserver			= entry.mObserver;
+		stats->mEventCount			= entry.mEventCount;
+		stats->mCallCount			= entry.mCallCount;
+		stats->mTotalNanoseconds	= entry.mTotalNanoseconds;
+		stats->mMaxNanoseconds		= entry.mMaxNanoseconds;
+		memcpy(stats->mHistogram, entry.mHistogram, sizeof(stats->mHistogram));
+
+		// Tags win over types, set before or after the first record.
+		const char* tag	= (entry.mObserver) ? FindTag(entry.mObserver) : nullptr;
+		stats->mName	= (tag) ? tag : (entry.mType) ? entry.mType : (entry.mObserver) ? DELEGATE_NAME : "";
+	}
+
+	// Where WriteJSON goes: a file, or a buffer that takes what fits while the
+	// length keeps counting.
+	struct JSONOutput
+	{
+		FILE*	mFile;
+		char*	mBuffer;
+		size_t	mSize;
+		size_t	mLength;
+
+		void Put(char c)
+		{
+			if (mFile != nullptr)
+			{
+				fputc(c, mFile);
+			}
+			else if (mLength + 1 < mSize)
+			{
+				mBuffer[mLength] = c;
+			}
+
+			mLength++;
+		}
+
+		void Write(const char* format, ...)
+		{
+			char text[256];
+
+			va_list args;
+			va_start(args, format);
+			int length = vsnprintf(text, sizeof(text), format, args);
+			va_end(args);
+
+			// Every format below fits; a longer one would be cut, not overrun.
+			length = (length < (int)sizeof(text)) ? length : (int)sizeof(text) - 1;
+			for (int i = 0; i < length; i++)
+			{
+				Put(text[i]);
+			}
+		}
+
+		void WriteString(const char* string)
+		{
+			Put('"');
+			for (const char* c = string; *c; c++)
+			{
+				if (*c == '"' || *c == '\\')
+				{
+					Put('\\');
+				}
+
+				Put(*c);
+			}
+			Put('"');
+		}
+
+		void WriteStats(const DispatchEntryStats& stats)
+		{
+			double averageNanoseconds = (stats.mCallCount) ? (double)stats.mTotalNanoseconds / stats.mCallCount : 0.0;
+
+			Write("\"calls\": %llu, \"totalNs\": %llu, \"averageNs\": %.1f, \"maxNs\": %llu, \"p99Ns\": %llu, \"histogram\": {",
+				(unsigned long long)stats.mCallCount, (unsigned long long)stats.mTotalNanoseconds, averageNanoseconds,
+				(unsigned long long)stats.mMaxNanoseconds, (unsigned long long)DispatchStats::GetPercentile(stats, 0.99));
+
+			// Nonempty buckets only, keyed by their lower bound in nanoseconds.
+			bool isFirst = true;
+			for (uint32_t b = 0; b < DISPATCH_HISTOGRAM_BUCKET_COUNT; b++)
+			{
+				if (stats.mHistogram[b] > 0)
+				{
+					Write("%s \"%llu\": %llu", (isFirst) ? "" : ",", (b == 0) ? 0ull : 1ull << b, (unsigned long long)stats.mHistogram[b]);
+					isFirst = false;
+				}
+			}
+
+			Write(" }");
+		}
+
+		// Reads the table in place: recording happens on this thread, so nothing moves meanwhile.
+		void WriteEntries()
+		{
+			Write("{\n\t\"droppedCalls\": %llu,\n\t\"events\": [", (unsigned long long)gDroppedCallCount);
+
+			bool isFirst = true;
+			for (uint32_t i = 0; i < DispatchStats::MAX_ENTRY_COUNT; i++)
+			{
+				if (!gEntries[i].mIsUsed || gEntries[i].mObserver != nullptr)
+				{
+					continue;
+				}
+
+				DispatchEntryStats totals;
+				CopyEntry(gEntries[i], &totals);
+
+				Write("%s\n\t\t{ \"eventID\": %u, \"events\": %llu, ", (isFirst) ? "" : ",", totals.mEventID, (unsigned long long)totals.mEventCount);
+				WriteStats(totals);
+				Write(", \"observers\": [");
+
+				bool isFirstObserver = true;
+				for (uint32_t j = 0; j < DispatchStats::MAX_ENTRY_COUNT; j++)
+				{
+					if (!gEntries[j].mIsUsed || gEntries[j].mObserver == nullptr || gEntries[j].mEventID != totals.mEventID)
+					{
+						continue;
+					}
+
+					DispatchEntryStats stats;
+					CopyEntry(gEntries[j], &stats);
+
+					Write("%s\n\t\t\t{ \"observer\": ", (isFirstObserver) ? "" : ",");
+					WriteString(stats.mName);
+					Write(", \"address\": \"%p\", ", stats.mObserver);
+					WriteStats(stats);
+					Write(" }");
+					isFirstObserver = false;
+				}
+
+				Write("%s] }", (isFirstObserver) ? "" : "\n\t\t");
+				isFirst = false;
+			}
+
+			Write("\n\t]\n}\n");
+		}
+	};
+}
+
+void DispatchStats::SetTag(const void* observer, const char* tag)
+{
+	for (uint32_t i = 0; i < gTagCount; i++)
+	{
+		if (gTags[i].mObserver == observer)
+		{
+			gTags[i].mTag = tag;
+			return;
+		}
+	}
+
+	if (gTagCount < MAX_TAG_COUNT)
+	{
+		gTags[gTagCount].mObserver	= observer;
+		gTags[gTagCount].mTag		= tag;
+		gTagCount++;
+	}
+}
+
+void DispatchStats::RecordDispatch(uint32_t eventID, uint32_t count)
+{
+	StatsEntry* entry = FindEntry(eventID, nullptr, true);
+	if (entry != nullptr)
+	{
+		entry->mEventCount += count;
+	}
+}
+
+void DispatchStats::RecordCall(uint32_t eventID, const void* observer, const char* type, uint64_t nanoseconds)
+{
+	StatsEntry* entries[2] = { FindEntry(eventID, nullptr, true), FindEntry(eventID, observer, true) };
+	if (entries[0] == nullptr || entries[1] == nullptr)
+	{
+		gDroppedCallCount++;
+		return;
+	}
+
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		StatsEntry* entry = entries[i];
+		entry->mCallCount++;
+		entry->mTotalNanoseconds	+= nanoseconds;
+		entry->mMaxNanoseconds		= (nanoseconds > entry->mMaxNanoseconds) ? nanoseconds : entry->mMaxNanoseconds;
+		entry->mHistogram[GetBucket(nanoseconds)]++;
+	}
+
+	entries[1]->mType = (type != nullptr) ? type : entries[1]->mType;
+}
+
+uint32_t DispatchStats::GetSnapshot(DispatchEntryStats* stats, uint32_t maxCount)
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < MAX_ENTRY_COUNT; i++)
+	{
+		if (gEntries[i].mIsUsed)
+		{
+			if (count < maxCount)
+			{
+				CopyEntry(gEntries[i], &stats[count]);
+			}
+
+			count++;
+		}
+	}
+
+	return count;
+}
+
+bool DispatchStats::GetEventStats(uint32_t eventID, DispatchEntryStats* stats)
+{
+	return GetObserverStats(eventID, nullptr, stats);
+}
+
+bool DispatchStats::GetObserverStats(uint32_t eventID, const void* observer, DispatchEntryStats* stats)
+{
+	const StatsEntry* entry = FindEntry(eventID, observer, false);
+	if (entry == nullptr)
+	{
+		return false;
+	}
+
+	CopyEntry(*entry, stats);
+	return true;
+}
+
+uint64_t DispatchStats::GetPercentile(const DispatchEntryStats& stats, double fraction)
+{
+	uint64_t rank		= (uint64_t)(fraction * stats.mCallCount + 0.5);
+	uint64_t callCount	= 0;
+
+	for (uint32_t b = 0; b < DISPATCH_HISTOGRAM_BUCKET_COUNT; b++)
+	{
+		callCount += stats.mHistogram[b];
+		if (callCount >= rank && callCount > 0)
+		{
+			// The longest call bounds the last bucket better than 2^(b+1).
+			uint64_t upper = 2ull << b;
+			return (upper < stats.mMaxNanoseconds) ? upper : stats.mMaxNanoseconds;
+		}
+	}
+
+	return 0;
+}
+
+uint64_t DispatchStats::GetDroppedCallCount()
+{
+	return gDroppedCallCount;
+}
+
+size_t DispatchStats::WriteJSON(char* buffer, size_t size)
+{
+	JSONOutput output = { nullptr, buffer, size, 0 };
+	output.WriteEntries();
+
+	if (size > 0)
+	{
+		buffer[(output.mLength < size) ? output.mLength : size - 1] = 0;
+	}
+
+	return output.mLength;
+}
+
+bool DispatchStats::WriteJSON(const char* filename)
+{
+	FILE* file = nullptr;
+#ifdef _MSC_VER
+	fopen_s(&file, filename, "w");
+#else
+	file = fopen(filename, "w");
+#endif
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	JSONOutput output = { file, nullptr, 0, 0 };
+	output.WriteEntries();
+
+	bool isWritten = ferror(file) == 0;
+	fclose(file);
+	return isWritten;
+}
+
+void DispatchStats::Reset()
+{
+	// Tags stay: they name observers, not measurements.
+	memset(gEntries, 0, sizeof(gEntries));
+	gDroppedCallCount = 0;
+}
@@ -0,0 +1,119 @@
+// DispatchStats
+//
+// Opt-in timing of event dispatch, for finding the observer behind a frame
+// hitch. Define EVENT_INSTRUMENTATION when building EventHandler (and any
+// project using EVENT_TAG_OBSERVER or the typed dispatchers) to turn it on;
+// without it the hooks below expand to nothing.
+//
+// Every handler call is timed. Entries are kept per event ID and observer pair
+// and, for the totals of an ID, per event ID alone (mObserver nullptr). Each
+// counts calls, total and longest call time, and a histogram of call times in
+// power of two buckets: bucket b counts calls of [2^b, 2^(b+1)) nanoseconds.
+// IObserver entries are named after the observer's type unless
+// EVENT_TAG_OBSERVER names them; typed delegates are "delegate" until tagged.
+//
+// Entries are keyed by observer address and are not thread safe: record and
+// read them on the thread that dispatches. Tags must outlive the stats (use
+// literals).
+//
+// References:	http://hdrhistogram.org/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+
+#pragma warning (disable: 4251)
+
+#ifdef _WINDLL
+#define IEVENT_API __declspec(dllexport)
+#else
+#define IEVENT_API __declspec(dllimport)
+#endif
+
+#define EVENT_DISPATCH_CONCAT(a, b)		a##b
+#define EVENT_DISPATCH_NAME(line)		EVENT_DISPATCH_CONCAT(dispatchTimingScope, line)
+
+#ifdef EVENT_INSTRUMENTATION
+#define EVENT_TAG_OBSERVER(observer, tag)				DispatchStats::SetTag(observer, tag)
+#define EVENT_TRACK_DISPATCH(eventID, count)			DispatchStats::RecordDispatch(eventID, count)
+#define EVENT_TIME_CALL(eventID, observer, type)		DispatchTimingScope EVENT_DISPATCH_NAME(__LINE__)(eventID, observer, type)
+#else
+#define EVENT_TAG_OBSERVER(observer, tag)				((void)0)
+#define EVENT_TRACK_DISPATCH(eventID, count)			((void)0)
+#define EVENT_TIME_CALL(eventID, observer, type)		((void)0)
+#endif
+
+static const uint32_t DISPATCH_HISTOGRAM_BUCKET_COUNT = 32;
+
+struct DispatchEntryStats
+{
+	uint32_t		mEventID;
+	const void*		mObserver;			// nullptr for the totals of mEventID
+	const char*		mName;
+	uint64_t		mEventCount;		// events dispatched, totals only
+	uint64_t		mCallCount;
+	uint64_t		mTotalNanoseconds;
+	uint64_t		mMaxNanoseconds;
+	uint64_t		mHistogram[DISPATCH_HISTOGRAM_BUCKET_COUNT];
+};
+
+class IEVENT_API DispatchStats
+{
+public:
+	static const uint32_t MAX_ENTRY_COUNT	= 512;
+	static const uint32_t MAX_TAG_COUNT		= 64;
+
+	static void		SetTag(const void* observer, const char* tag);
+
+	static void		RecordDispatch(uint32_t eventID, uint32_t count);
+
+	// type names the observer while it has no tag, may be nullptr.
+	static void		RecordCall(uint32_t eventID, const void* observer, const char* type, uint64_t nanoseconds);
+
+	// Copies up to maxCount entries and returns how many exist.
+	static uint32_t	GetSnapshot(DispatchEntryStats* stats, uint32_t maxCount);
+
+	// Calls not recorded because the table was full.
+	static uint64_t	GetDroppedCallCount();
+
+	// False when nothing was recorded for the event ID (or pair).
+	static bool		GetEventStats(uint32_t eventID, DispatchEntryStats* stats);
+	static bool		GetObserverStats(uint32_t eventID, const void* observer, DispatchEntryStats* stats);
+
+	// Upper bound of the bucket holding the given fraction of calls, e.g. 0.99.
+	static uint64_t	GetPercentile(const DispatchEntryStats& stats, double fraction);
+
+	// The dump's length; buffer gets as much as fits, always terminated. Pass
+	// nullptr and 0 to size a buffer.
+	static size_t	WriteJSON(char* buffer, size_t size);
+	static bool		WriteJSON(const char* filename);
+
+	static void		Reset();
+
+private:
+	DispatchStats() = delete;
+};
+
+// Times one handler call, from construction to the end of the scope.
+class DispatchTimingScope
+{
+public:
+	DispatchTimingScope(uint32_t eventID, const void* observer, const char* type) :
+		mStart(std::chrono::high_resolution_clock::now()), mObserver(observer), mType(type), mEventID(eventID) {};
+
+	~DispatchTimingScope()
+	{
+		std::chrono::high_resolution_clock::duration elapsed = std::chrono::high_resolution_clock::now() - mStart;
+		DispatchStats::RecordCall(mEventID, mObserver, mType, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point	mStart;
+	const void*										mObserver;
+	const char*										mType;
+	uint32_t										mEventID;
+
+	DispatchTimingScope(DispatchTimingScope const&) = delete;
+	void operator=(DispatchTimingScope const&) = delete;
+};
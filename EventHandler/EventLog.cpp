@@ -0,0 +1,302 @@
+#include "EventLog.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+static const uint32_t LOG_MAGIC		= 0x474C5645;	// "EVLG"
+static const uint32_t LOG_VERSION	= 1;
+
+struct LogHeader
+{
+	uint32_t	mMagic;
+	uint32_t	mVersion;
+	uint32_t	mFrameCount;	// 0 until the recorder is freed
+	uint32_t	mReserved;
+};
+
+struct RecordHeader
+{
+	uint32_t	mEventID;
+	uint32_t	mFrame;
+	double		mTime;
+	uint32_t	mSize;
+	uint32_t	mReserved;
+};
+
+static FILE* OpenFile(const char* filename, const char* mode)
+{
+	FILE* file = nullptr;
+#ifdef _MSC_VER
+	fopen_s(&file, filename, mode);
+#else
+	file = fopen(filename, mode);
+#endif
+	return file;
+}
+
+#pragma region EventRecorder
+
+EventRecorder::EventRecorder(const char* filename, EventWriter writer) : mWriter(writer), mFrame(0), mEventCount(0), mHasBegunFrame(false)
+{
+	static_assert(sizeof(LogHeader) == 16 && sizeof(RecordHeader) == 24, "Log layout changed");
+
+	mStartTime	= std::chrono::high_resolution_clock::now();
+	mFile		= OpenFile(filename, "wb");
+
+	if (mFile != nullptr)
+	{
+		LogHeader header = { LOG_MAGIC, LOG_VERSION, 0, 0 };
+		fwrite(&header, sizeof(header), 1, mFile);
+	}
+}
+
+EventRecorder::EventRecorder() : mFile(nullptr), mWriter(nullptr), mFrame(0), mEventCount(0), mHasBegunFrame(false)
+{
+}
+
+EventRecorder::~EventRecorder()
+{
+	mFile = nullptr;
+}
+
+bool EventRecorder::IsOpen() const
+{
+	return mFile != nullptr;
+}
+
+void EventRecorder::BeginFrame()
+{
+	// Events recorded before the first BeginFrame belong to frame 0 as well.
+	if (mHasBegunFrame)
+	{
+		mFrame++;
+	}
+
+	mHasBegunFrame = true;
+}
+
+void EventRecorder::Record(uint32_t eventID, const IEvent& iEvent)
+{
+	if (mFile == nullptr)
+	{
+		return;
+	}
+
+	uint8_t payload[MAX_PAYLOAD_SIZE];
+	uint32_t size = (mWriter != nullptr) ? mWriter(eventID, iEvent, payload, MAX_PAYLOAD_SIZE) : 0;
+	assert(size <= MAX_PAYLOAD_SIZE);
+
+	RecordHeader record;
+	record.mEventID		= eventID;
+	record.mFrame		= mFrame;
+	record.mTime		= std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mStartTime).count();
+	record.mSize		= size;
+	record.mReserved	= 0;
+
+	fwrite(&record, sizeof(record), 1, mFile);
+	fwrite(payload, 1, size, mFile);
+	mEventCount++;
+}
+
+uint32_t EventRecorder::GetEventCount() const
+{
+	return mEventCount;
+}
+
+uint32_t EventRecorder::GetFrame() const
+{
+	return mFrame;
+}
+
+void EventRecorder::Free()
+{
+	if (mFile != nullptr)
+	{
+		// Trailing frames without events still count.
+		LogHeader header = { LOG_MAGIC, LOG_VERSION, (mHasBegunFrame || mEventCount > 0) ? mFrame + 1 : 0, 0 };
+		fseek(mFile, 0, SEEK_SET);
+		fwrite(&header, sizeof(header), 1, mFile);
+		fclose(mFile);
+	}
+
+	mFile = nullptr;
+}
+
+#pragma endregion
+
+#pragma region EventPlayer
+
+EventPlayer::EventPlayer(const char* filename, EventReader reader) :
+	mLog(nullptr),
+	mSize(0),
+	mCursor(sizeof(LogHeader)),
+	mReader(reader),
+	mFrame(0),
+	mFrameCount(0),
+	mEventCount(0)
+{
+	FILE* file = OpenFile(filename, "rb");
+	if (file == nullptr)
+	{
+		return;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (size >= (long)sizeof(LogHeader))
+	{
+		mLog	= (uint8_t*)malloc(size);
+		mSize	= fread(mLog, 1, size, file);
+	}
+
+	fclose(file);
+
+	if (mLog == nullptr)
+	{
+		return;
+	}
+
+	LogHeader header;
+	memcpy(&header, mLog, sizeof(header));
+	if (header.mMagic != LOG_MAGIC || header.mVersion != LOG_VERSION)
+	{
+		Free();
+		return;
+	}
+
+	// Count what is there; a log cut short (crash while recording) ends at its last whole record.
+	size_t cursor = sizeof(LogHeader);
+	while (cursor + sizeof(RecordHeader) <= mSize)
+	{
+		RecordHeader record;
+		memcpy(&record, mLog + cursor, sizeof(record));
+		if (cursor + sizeof(RecordHeader) + record.mSize > mSize)
+		{
+			break;
+		}
+
+		cursor		+= sizeof(RecordHeader) + record.mSize;
+		mFrameCount	= record.mFrame + 1;
+		mEventCount++;
+	}
+
+	mSize		= cursor;
+	mFrameCount	= (header.mFrameCount > mFrameCount) ? header.mFrameCount : mFrameCount;
+}
+
+EventPlayer::EventPlayer() : mLog(nullptr), mSize(0), mCursor(0), mReader(nullptr), mFrame(0), mFrameCount(0), mEventCount(0)
+{
+}
+
+EventPlayer::~EventPlayer()
+{
+	mLog = nullptr;
+}
+
+bool EventPlayer::IsOpen() const
+{
+	return mLog != nullptr;
+}
+
+bool EventPlayer::PlayFrame(IEventHandler& handler)
+{
+	if (IsFinished())
+	{
+		return false;
+	}
+
+	while (mCursor < mSize)
+	{
+		RecordHeader record;
+		memcpy(&record, mLog + mCursor, sizeof(record));
+		if (record.mFrame > mFrame)
+		{
+			break;
+		}
+
+		PlayRecord(handler);
+	}
+
+	mFrame++;
+	return true;
+}
+
+uint32_t EventPlayer::PlayUntil(IEventHandler& handler, double milliseconds)
+{
+	uint32_t count = 0;
+	while (mCursor < mSize)
+	{
+		RecordHeader record;
+		memcpy(&record, mLog + mCursor, sizeof(record));
+		if (record.mTime > milliseconds)
+		{
+			break;
+		}
+
+		mFrame = record.mFrame;
+		PlayRecord(handler);
+		count++;
+	}
+
+	return count;
+}
+
+void EventPlayer::PlayRecord(IEventHandler& handler)
+{
+	RecordHeader record;
+	memcpy(&record, mLog + mCursor, sizeof(record));
+
+	const uint8_t* data = mLog + mCursor + sizeof(RecordHeader);
+	mCursor += sizeof(RecordHeader) + record.mSize;
+
+	if (mReader != nullptr)
+	{
+		mReader(handler, record.mEventID, data, record.mSize);
+	}
+	else
+	{
+		handler.NotifyObservers(RecordedEvent(record.mEventID, record.mFrame, record.mTime, data, record.mSize));
+	}
+}
+
+bool EventPlayer::IsFinished() const
+{
+	return mLog == nullptr || mFrame >= mFrameCount;
+}
+
+uint32_t EventPlayer::GetFrame() const
+{
+	return mFrame;
+}
+
+uint32_t EventPlayer::GetFrameCount() const
+{
+	return mFrameCount;
+}
+
+uint32_t EventPlayer::GetEventCount() const
+{
+	return mEventCount;
+}
+
+void EventPlayer::Rewind()
+{
+	mCursor	= sizeof(LogHeader);
+	mFrame	= 0;
+}
+
+void EventPlayer::Free()
+{
+	free(mLog);
+
+	mLog		= nullptr;
+	mSize		= 0;
+	mCursor		= 0;
+	mFrame		= 0;
+	mFrameCount	= 0;
+	mEventCount	= 0;
+}
+
+#pragma endregion
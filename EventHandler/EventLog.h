@@ -0,0 +1,126 @@
+#pragma once
+#include "IEventHandler.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <chrono>
+
+#pragma warning (disable: 4251)
+
+#ifdef _WINDLL
+#define IEVENT_API __declspec(dllexport)
+#else
+#define IEVENT_API __declspec(dllimport)
+#endif
+
+// Binary event logs for repeatable, input driven runs. An EventRecorder set on
+// an IEventHandler writes every dispatched event with the frame it was
+// dispatched in and a high resolution timestamp; an EventPlayer feeds the log
+// back through NotifyObservers frame by frame, or against a clock at recorded
+// or scaled speed. Neither needs a window, so logs recorded in the engine can
+// drive a headless benchmark.
+//
+// Events are opaque to the log: an EventWriter turns one into bytes and an
+// EventReader turns them back into an event for a handler. Without a reader the
+// player posts RecordedEvent, which carries the raw payload. Logs use the byte
+// order of the machine that wrote them.
+//
+// Layout:	header	{ magic, version, frame count, 0 }					16 bytes
+//			record	{ eventID, frame, time (ms, double), size, 0 }	24 bytes + size, repeated
+
+// Bytes written for iEvent, at most capacity.
+typedef uint32_t (*EventWriter)(uint32_t eventID, const IEvent& iEvent, uint8_t* buffer, uint32_t capacity);
+
+// Rebuilds the event and hands it to handler.NotifyObservers.
+typedef void (*EventReader)(IEventHandler& handler, uint32_t eventID, const uint8_t* data, uint32_t size);
+
+class IEVENT_API RecordedEvent : public IEvent
+{
+public:
+	uint32_t		mEventID;
+	uint32_t		mFrame;
+	double			mTime;
+	const uint8_t*	mData;
+	uint32_t		mSize;
+
+	RecordedEvent(uint32_t eventID, uint32_t frame, double time, const uint8_t* data, uint32_t size) :
+		mEventID(eventID), mFrame(frame), mTime(time), mData(data), mSize(size) {};
+	~RecordedEvent() {};
+};
+
+class IEVENT_API EventRecorder
+{
+public:
+	static const uint32_t MAX_PAYLOAD_SIZE = 256;
+
+	EventRecorder(const char* filename, EventWriter writer);
+	~EventRecorder();
+
+	bool		IsOpen() const;
+
+	// Events recorded after this belong to the next frame.
+	void		BeginFrame();
+	void		Record(uint32_t eventID, const IEvent& iEvent);
+
+	uint32_t	GetEventCount() const;
+	uint32_t	GetFrame() const;
+
+	// Writes the frame count and closes the log.
+	void		Free();
+
+private:
+	typedef std::chrono::high_resolution_clock::time_point ClockTime;
+
+	FILE*			mFile;
+	EventWriter		mWriter;
+	ClockTime		mStartTime;
+	uint32_t		mFrame;
+	uint32_t		mEventCount;
+	bool			mHasBegunFrame;
+
+	EventRecorder();
+	EventRecorder(EventRecorder const&) = delete;
+	void operator=(EventRecorder const&) = delete;
+};
+
+class IEVENT_API EventPlayer
+{
+public:
+	// The whole log is read up front so playback does no I/O. reader may be nullptr.
+	EventPlayer(const char* filename, EventReader reader);
+	~EventPlayer();
+
+	// False when the file is missing or not an event log.
+	bool		IsOpen() const;
+
+	// Feeds the events of the next recorded frame, which may be none. False once
+	// the log is exhausted.
+	bool		PlayFrame(IEventHandler& handler);
+
+	// Feeds every event stamped at or before milliseconds since recording began.
+	// Pass elapsed time times a speed factor for accelerated playback.
+	uint32_t	PlayUntil(IEventHandler& handler, double milliseconds);
+
+	bool		IsFinished() const;
+	uint32_t	GetFrame() const;
+	uint32_t	GetFrameCount() const;
+	uint32_t	GetEventCount() const;
+
+	void		Rewind();
+	void		Free();
+
+private:
+	uint8_t*		mLog;
+	size_t			mSize;
+	size_t			mCursor;
+	EventReader		mReader;
+	uint32_t		mFrame;
+	uint32_t		mFrameCount;
+	uint32_t		mEventCount;
+
+	void			PlayRecord(IEventHandler& handler);
+
+	EventPlayer();
+	EventPlayer(EventPlayer const&) = delete;
+	void operator=(EventPlayer const&) = delete;
+};
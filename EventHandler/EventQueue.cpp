@@ -0,0 +1,331 @@
+#include "EventQueue.h"
+#include "IEventHandler.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+static const uint32_t INITIAL_RECORD_CAPACITY	= 64;
+static const uint32_t INITIAL_BATCH_CAPACITY	= 16;
+static const uint32_t INVALID_BATCH				= 0xFFFFFFFF;
+
+// Block header rounded up so event storage starts at the alignment malloc gives the block.
+static const size_t BLOCK_HEADER_SIZE			= (sizeof(void*) * 3 + 15) & ~(size_t)15;
+
+static uint8_t* BlockData(void* block)
+{
+	return (uint8_t*)block + BLOCK_HEADER_SIZE;
+}
+
+static uintptr_t AlignUp(uintptr_t address, size_t alignment)
+{
+	return (address + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+}
+
+static void* HeapReallocate(void*, void* pointer, size_t, size_t newSize)
+{
+	return realloc(pointer, newSize);
+}
+
+static void HeapFree(void*, void* pointer, size_t)
+{
+	free(pointer);
+}
+
+#pragma region EventAllocator
+
+EventAllocator EventAllocator::Heap()
+{
+	EventAllocator allocator = { &HeapReallocate, &HeapFree, nullptr };
+	return allocator;
+}
+
+#pragma endregion
+
+#pragma region EventQueue
+
+EventQueue::EventQueue(const EventAllocator& allocator) :
+	mAllocator(allocator),
+	mFirstBlock(nullptr),
+	mCurrentBlock(nullptr),
+	mRecords(nullptr),
+	mGrouped(nullptr),
+	mRuns(nullptr),
+	mRecordCount(0),
+	mRecordCapacity(0),
+	mRunCount(0),
+	mBatches(nullptr),
+	mBatchSlots(nullptr),
+	mBatchCount(0),
+	mBatchCapacity(0)
+{
+}
+
+EventQueue::~EventQueue()
+{
+	Free();
+}
+
+void* EventQueue::Allocate(size_t size, size_t alignment)
+{
+	for (Block* block = mCurrentBlock; block != nullptr; block = block->mNext)
+	{
+		uintptr_t start	= (uintptr_t)BlockData(block);
+		uintptr_t at	= AlignUp(start + block->mUsed, alignment);
+		if (at + size <= start + block->mSize)
+		{
+			block->mUsed	= (at + size) - start;
+			mCurrentBlock	= block;
+			return (void*)at;
+		}
+
+		// Later blocks are empty until the current one is full, so only try the next.
+		if (block != mCurrentBlock)
+		{
+			break;
+		}
+	}
+
+	size_t dataSize	= (size + alignment > DEFAULT_BLOCK_SIZE) ? size + alignment : DEFAULT_BLOCK_SIZE;
+	Block* block	= (Block*)Reallocate(nullptr, 0, BLOCK_HEADER_SIZE + dataSize);
+	block->mSize	= dataSize;
+	block->mUsed	= 0;
+
+	if (mCurrentBlock == nullptr)
+	{
+		block->mNext	= nullptr;
+		mFirstBlock		= block;
+	}
+	else
+	{
+		block->mNext			= mCurrentBlock->mNext;
+		mCurrentBlock->mNext	= block;
+	}
+
+	mCurrentBlock	= block;
+
+	uintptr_t start	= (uintptr_t)BlockData(block);
+	uintptr_t at	= AlignUp(start, alignment);
+	block->mUsed	= (at + size) - start;
+	return (void*)at;
+}
+
+void EventQueue::Push(uint32_t eventID, IEvent* iEvent)
+{
+	if (mRecordCount == mRecordCapacity)
+	{
+		uint32_t capacity	= (mRecordCapacity > 0) ? mRecordCapacity * 2 : INITIAL_RECORD_CAPACITY;
+		mRecords			= (Record*)Reallocate(mRecords, sizeof(Record) * mRecordCapacity, sizeof(Record) * capacity);
+		mGrouped			= (const IEvent**)Reallocate(mGrouped, sizeof(const IEvent*) * mRecordCapacity, sizeof(const IEvent*) * capacity);
+		mRuns				= (Run*)Reallocate(mRuns, sizeof(Run) * mRecordCapacity, sizeof(Run) * capacity);
+		mRecordCapacity		= capacity;
+	}
+
+	uint32_t batch = FindOrAddBatch(eventID);
+	mBatches[batch].mCount++;
+	mBatches[batch].mLatest = mRecordCount;
+
+	mRecords[mRecordCount].mEvent	= iEvent;
+	mRecords[mRecordCount].mBatch	= batch;
+	mRecordCount++;
+}
+
+IEvent* EventQueue::GetLatest(uint32_t eventID) const
+{
+	uint32_t batch = FindBatch(eventID);
+	return (batch != INVALID_BATCH) ? mRecords[mBatches[batch].mLatest].mEvent : nullptr;
+}
+
+bool EventQueue::DiscardLatest(uint32_t eventID)
+{
+	uint32_t batch = FindBatch(eventID);
+	if (batch == INVALID_BATCH || mRecords[mBatches[batch].mLatest].mEvent == nullptr)
+	{
+		return false;
+	}
+
+	Record& record = mRecords[mBatches[batch].mLatest];
+	record.mEvent->~IEvent();
+	record.mEvent = nullptr;
+	mBatches[batch].mCount--;
+	return true;
+}
+
+void EventQueue::GroupRuns()
+{
+	uint32_t count	= 0;
+	mRunCount		= 0;
+
+	for (uint32_t i = 0; i < mRecordCount; i++)
+	{
+		if (mRecords[i].mEvent == nullptr)
+		{
+			continue;
+		}
+
+		uint32_t eventID = mBatches[mRecords[i].mBatch].mEventID;
+		if (mRunCount == 0 || mRuns[mRunCount - 1].mEventID != eventID)
+		{
+			mRuns[mRunCount].mEventID	= eventID;
+			mRuns[mRunCount].mCount		= 0;
+			mRuns[mRunCount].mFirst		= count;
+			mRunCount++;
+		}
+
+		mRuns[mRunCount - 1].mCount++;
+		mGrouped[count++] = mRecords[i].mEvent;
+	}
+}
+
+uint32_t EventQueue::GetBatchCount() const
+{
+	return mRunCount;
+}
+
+EventQueue::Batch EventQueue::GetBatch(uint32_t index) const
+{
+	assert(index < mRunCount);
+
+	Batch batch;
+	batch.mEventID	= mRuns[index].mEventID;
+	batch.mCount	= mRuns[index].mCount;
+	batch.mEvents	= mGrouped + mRuns[index].mFirst;
+	return batch;
+}
+
+uint32_t EventQueue::GetEventCount() const
+{
+	return mRecordCount;
+}
+
+bool EventQueue::IsEmpty() const
+{
+	return mRecordCount == 0;
+}
+
+void EventQueue::Reset()
+{
+	for (uint32_t i = 0; i < mRecordCount; i++)
+	{
+		if (mRecords[i].mEvent != nullptr)
+		{
+			mRecords[i].mEvent->~IEvent();
+		}
+	}
+
+	for (Block* block = mFirstBlock; block != nullptr; block = block->mNext)
+	{
+		block->mUsed = 0;
+	}
+
+	if (mBatchSlots != nullptr)
+	{
+		memset(mBatchSlots, 0, sizeof(uint32_t) * mBatchCapacity * 2);
+	}
+
+	mCurrentBlock	= mFirstBlock;
+	mRecordCount	= 0;
+	mRunCount		= 0;
+	mBatchCount		= 0;
+}
+
+void EventQueue::Free()
+{
+	Reset();
+
+	while (mFirstBlock != nullptr)
+	{
+		Block* next = mFirstBlock->mNext;
+		Release(mFirstBlock, BLOCK_HEADER_SIZE + mFirstBlock->mSize);
+		mFirstBlock = next;
+	}
+
+	Release(mRecords, sizeof(Record) * mRecordCapacity);
+	Release(mGrouped, sizeof(const IEvent*) * mRecordCapacity);
+	Release(mRuns, sizeof(Run) * mRecordCapacity);
+	Release(mBatches, sizeof(BatchEntry) * mBatchCapacity);
+	Release(mBatchSlots, sizeof(uint32_t) * mBatchCapacity * 2);
+
+	mCurrentBlock	= nullptr;
+	mRecords		= nullptr;
+	mGrouped		= nullptr;
+	mRuns			= nullptr;
+	mRecordCapacity	= 0;
+	mBatches		= nullptr;
+	mBatchSlots		= nullptr;
+	mBatchCapacity	= 0;
+}
+
+uint32_t EventQueue::FindBatch(uint32_t eventID) const
+{
+	// Slots hold batch index + 1, at most half of them in use.
+	uint32_t mask = mBatchCapacity * 2 - 1;
+	if (mBatchCapacity > 0)
+	{
+		for (uint32_t slot = (eventID * 2654435761u) & mask; mBatchSlots[slot] != 0; slot = (slot + 1) & mask)
+		{
+			if (mBatches[mBatchSlots[slot] - 1].mEventID == eventID)
+			{
+				return mBatchSlots[slot] - 1;
+			}
+		}
+	}
+
+	return INVALID_BATCH;
+}
+
+uint32_t EventQueue::FindOrAddBatch(uint32_t eventID)
+{
+	uint32_t batch = FindBatch(eventID);
+	if (batch != INVALID_BATCH)
+	{
+		return batch;
+	}
+
+	uint32_t mask = mBatchCapacity * 2 - 1;
+
+	if (mBatchCount == mBatchCapacity)
+	{
+		uint32_t capacity	= (mBatchCapacity > 0) ? mBatchCapacity * 2 : INITIAL_BATCH_CAPACITY;
+		mBatches			= (BatchEntry*)Reallocate(mBatches, sizeof(BatchEntry) * mBatchCapacity, sizeof(BatchEntry) * capacity);
+		mBatchSlots			= (uint32_t*)Reallocate(mBatchSlots, sizeof(uint32_t) * mBatchCapacity * 2, sizeof(uint32_t) * capacity * 2);
+		mBatchCapacity		= capacity;
+		mask				= mBatchCapacity * 2 - 1;
+
+		memset(mBatchSlots, 0, sizeof(uint32_t) * mBatchCapacity * 2);
+		for (uint32_t i = 0; i < mBatchCount; i++)
+		{
+			uint32_t slot = (mBatches[i].mEventID * 2654435761u) & mask;
+			while (mBatchSlots[slot] != 0)
+			{
+				slot = (slot + 1) & mask;
+			}
+
+			mBatchSlots[slot] = i + 1;
+		}
+	}
+
+	uint32_t slot = (eventID * 2654435761u) & mask;
+	while (mBatchSlots[slot] != 0)
+	{
+		slot = (slot + 1) & mask;
+	}
+
+	mBatches[mBatchCount].mEventID	= eventID;
+	mBatches[mBatchCount].mCount	= 0;
+	mBatches[mBatchCount].mLatest	= 0;
+	mBatchSlots[slot]				= mBatchCount + 1;
+
+	return mBatchCount++;
+}
+
+void* EventQueue::Reallocate(void* pointer, size_t oldSize, size_t newSize)
+{
+	return mAllocator.mReallocate(mAllocator.mContext, pointer, oldSize, newSize);
+}
+
+void EventQueue::Release(void* pointer, size_t size)
+{
+	mAllocator.mFree(mAllocator.mContext, pointer, size);
+}
+
+#pragma endregion
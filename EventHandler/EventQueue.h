@@ -0,0 +1,130 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#pragma warning (disable: 4251)
+
+#ifdef _WINDLL
+#define IEVENT_API __declspec(dllexport)
+#else
+#define IEVENT_API __declspec(dllimport)
+#endif
+
+class IEvent;
+
+// Where EventQueue and ObserverTable get their memory, e.g. an engine allocator
+// wrapped by the application. Reallocate works like realloc but is told the old
+// size (nullptr and 0 to allocate) and must align as malloc does. Free is told
+// the size as well and must accept nullptr. Heap() uses the CRT heap.
+struct IEVENT_API EventAllocator
+{
+	typedef void*	(*ReallocateFunction)(void* context, void* pointer, size_t oldSize, size_t newSize);
+	typedef void	(*FreeFunction)(void* context, void* pointer, size_t size);
+
+	ReallocateFunction	mReallocate;
+	FreeFunction		mFree;
+	void*				mContext;
+
+	static EventAllocator	Heap();
+};
+
+// Events posted during a frame, copied into blocks the queue owns until Reset.
+// GroupRuns lays them out as batches in posting order, each batch a run of
+// consecutive events with one ID. Events of different IDs are never reordered,
+// so paired messages (key down, key up, key down) arrive as they were posted.
+// Blocks and arrays are kept across Reset, so a queue that has seen a busy frame
+// no longer touches the heap.
+class IEVENT_API EventQueue
+{
+public:
+	static const size_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+
+	struct Batch
+	{
+		uint32_t			mEventID;
+		uint32_t			mCount;
+		const IEvent**		mEvents;
+	};
+
+	// The allocator must outlive the queue.
+	EventQueue(const EventAllocator& allocator = EventAllocator::Heap());
+	~EventQueue();
+
+	// Storage for one event, to be constructed in place and handed to Push.
+	void*			Allocate(size_t size, size_t alignment);
+	void			Push(uint32_t eventID, IEvent* iEvent);
+
+	// The most recently pushed event of eventID, nullptr if there is none.
+	IEvent*			GetLatest(uint32_t eventID) const;
+
+	// Destroys the most recently pushed event of eventID. A discarded event does
+	// not split the run around it.
+	bool			DiscardLatest(uint32_t eventID);
+
+	void			GroupRuns();
+	uint32_t		GetBatchCount() const;
+	Batch			GetBatch(uint32_t index) const;
+
+	// Includes discarded events until Reset.
+	uint32_t		GetEventCount() const;
+	bool			IsEmpty() const;
+
+	// Destroys the queued events and rewinds the blocks.
+	void			Reset();
+	void			Free();
+
+private:
+	struct Block
+	{
+		Block*		mNext;
+		size_t		mSize;
+		size_t		mUsed;
+	};
+
+	struct Record
+	{
+		IEvent*		mEvent;
+		uint32_t	mBatch;
+	};
+
+	// Per event ID, for coalescing.
+	struct BatchEntry
+	{
+		uint32_t	mEventID;
+		uint32_t	mCount;
+		uint32_t	mLatest;	// Record index
+	};
+
+	struct Run
+	{
+		uint32_t	mEventID;
+		uint32_t	mCount;
+		uint32_t	mFirst;		// Index into mGrouped
+	};
+
+	EventAllocator	mAllocator;
+
+	Block*			mFirstBlock;
+	Block*			mCurrentBlock;
+
+	Record*			mRecords;
+	const IEvent**	mGrouped;
+	Run*			mRuns;
+	uint32_t		mRecordCount;
+	uint32_t		mRecordCapacity;
+	uint32_t		mRunCount;
+
+	BatchEntry*		mBatches;
+	uint32_t*		mBatchSlots;
+	uint32_t		mBatchCount;
+	uint32_t		mBatchCapacity;
+
+	void*			Reallocate(void* pointer, size_t oldSize, size_t newSize);
+	void			Release(void* pointer, size_t size);
+
+	uint32_t		FindBatch(uint32_t eventID) const;
+	uint32_t		FindOrAddBatch(uint32_t eventID);
+
+	EventQueue(EventQueue const&) = delete;
+	void operator=(EventQueue const&) = delete;
+};
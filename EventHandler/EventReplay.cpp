@@ -0,0 +1,104 @@
+// Headless playback of an event log recorded with EventRecorder. Standalone like
+// DispatchBenchmark.cpp: build it with IEventHandler.cpp, EventQueue.cpp and
+// EventLog.cpp as a console program (Release) and run
+//
+//	EventReplay <log> [repeat count]
+//
+// Every recorded frame is queued and dispatched the way Engine::RunScene does
+// once per frame, to an observer that only counts, so the time is dispatch alone.
+
+#include "IEventHandler.h"
+#include "EventLog.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+class CountingObserver : public IObserver
+{
+public:
+	uint64_t mCount;
+	uint64_t mBytes;
+
+	CountingObserver() : mCount(0), mBytes(0) {};
+
+	void HandleEvent(const IEvent& iEvent) override
+	{
+		mCount++;
+		mBytes += static_cast<const RecordedEvent&>(iEvent).mSize;
+	}
+};
+
+// Dispatches RecordedEvent by the ID it carries, registering the observer for
+// each ID the first time it shows up.
+class ReplayEventHandler : public IEventHandler
+{
+public:
+	IObserver* mObserver;
+
+	ReplayEventHandler(IObserver* observer) : mObserver(observer) {};
+
+	void NotifyObservers(const IEvent& iEvent) override
+	{
+		const RecordedEvent& recorded = static_cast<const RecordedEvent&>(iEvent);
+		if (mObservers.Find(recorded.mEventID) == nullptr)
+		{
+			RegisterObserver(recorded.mEventID, mObserver);
+		}
+
+		if (IsQueued())
+		{
+			Post(recorded.mEventID, recorded);
+		}
+		else
+		{
+			Dispatch(recorded.mEventID, iEvent);
+		}
+	}
+};
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: EventReplay <log> [repeat count]\n");
+		return 1;
+	}
+
+	int repeatCount = (argc > 2) ? atoi(argv[2]) : 1;
+
+	// No reader: the player posts RecordedEvent, whose payload points into the log.
+	EventPlayer player(argv[1], nullptr);
+	if (!player.IsOpen())
+	{
+		printf("%s is not an event log\n", argv[1]);
+		return 1;
+	}
+
+	CountingObserver observer;
+	ReplayEventHandler handler(&observer);
+	handler.SetQueued(true);
+
+	std::chrono::high_resolution_clock::duration elapsed(0);
+	for (int i = 0; i < repeatCount; i++)
+	{
+		player.Rewind();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		while (player.PlayFrame(handler))
+		{
+			handler.DispatchQueuedEvents();
+		}
+		elapsed += std::chrono::high_resolution_clock::now() - start;
+	}
+
+	double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	uint64_t frameCount = (uint64_t)player.GetFrameCount() * repeatCount;
+
+	printf("%u events in %u frames, replayed %d times\n", player.GetEventCount(), player.GetFrameCount(), repeatCount);
+	printf("dispatched %llu events, %llu payload bytes\n", (unsigned long long)observer.mCount, (unsigned long long)observer.mBytes);
+	printf("%.1f ns/frame, %.1f ns/event\n", (frameCount > 0) ? ns / frameCount : 0.0, (observer.mCount > 0) ? ns / observer.mCount : 0.0);
+
+	handler.SetQueued(false);
+	player.Free();
+	return 0;
+}
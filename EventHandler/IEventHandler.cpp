@@ -1,38 +1,446 @@
 #include "IEventHandler.h"
+#include "EventLog.h"
+#include "DispatchStats.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+#include <typeinfo>
 
-IEventHandler::IEventHandler()
+static const uint32_t INITIAL_LIST_CAPACITY		= 4;
+static const uint32_t INITIAL_SPARSE_CAPACITY	= 32;
+
+static uint32_t SparseSlot(uint32_t eventID, uint32_t capacity)
+{
+	return (eventID * 2654435761u) & (capacity - 1);
+}
+
+#pragma region ObserverTable
+
+ObserverTable::ObserverTable(const EventAllocator& allocator) :
+	mAllocator(allocator),
+	mSparse(nullptr),
+	mSparseCapacity(0),
+	mSparseCount(0),
+	mGeneration(0),
+	mRemovalIDs(nullptr),
+	mRemovalCount(0),
+	mRemovalCapacity(0),
+	mDispatchDepth(0)
+{
+	memset(mDense, 0, sizeof(mDense));
+}
+
+ObserverTable::~ObserverTable()
+{
+	Clear();
+}
+
+void ObserverTable::Add(uint32_t eventID, IObserver* observer)
+{
+	assert(observer != nullptr);	// nullptr marks a removed slot
+	ObserverList* list = FindOrInsert(eventID);
+
+#ifndef NDEBUG
+	for (uint32_t i = 0; i < list->mCount; i++)
+	{
+		assert(list->mObservers[i] != observer);	// Already registered for this event
+	}
+#endif
+
+	if (list->mCount == list->mCapacity)
+	{
+		uint32_t capacity	= (list->mCapacity > 0) ? list->mCapacity * 2 : INITIAL_LIST_CAPACITY;
+		list->mObservers	= (IObserver**)Reallocate(list->mObservers, sizeof(IObserver*) * list->mCapacity, sizeof(IObserver*) * capacity);
+		list->mCapacity		= capacity;
+	}
+
+	list->mObservers[list->mCount++] = observer;
+}
+
+bool ObserverTable::Remove(uint32_t eventID, IObserver* observer)
+{
+	ObserverList* list = (ObserverList*)Find(eventID);
+	if (list == nullptr)
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < list->mCount; i++)
+	{
+		if (list->mObservers[i] != observer)
+		{
+			continue;
+		}
+
+		if (mDispatchDepth == 0)
+		{
+			list->mObservers[i] = list->mObservers[--list->mCount];
+			return true;
+		}
+
+		// Swapping would move an observer the running dispatch has yet to reach
+		// into a slot it has already passed.
+		list->mObservers[i] = nullptr;
+		if (!list->mHasRemovals)
+		{
+			if (mRemovalCount == mRemovalCapacity)
+			{
+				uint32_t capacity	= (mRemovalCapacity > 0) ? mRemovalCapacity * 2 : INITIAL_LIST_CAPACITY;
+				mRemovalIDs			= (uint32_t*)Reallocate(mRemovalIDs, sizeof(uint32_t) * mRemovalCapacity, sizeof(uint32_t) * capacity);
+				mRemovalCapacity	= capacity;
+			}
+
+			mRemovalIDs[mRemovalCount++]	= eventID;
+			list->mHasRemovals				= true;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+const ObserverList* ObserverTable::Find(uint32_t eventID) const
+{
+	if (eventID < DENSE_ID_COUNT)
+	{
+		return (mDense[eventID].mObservers != nullptr) ? &mDense[eventID] : nullptr;
+	}
+
+	SparseEntry* entry = FindSparse(eventID);
+	return (entry != nullptr) ? &entry->mList : nullptr;
+}
+
+EventPolicy& ObserverTable::GetPolicy(uint32_t eventID)
+{
+	return FindOrInsert(eventID)->mPolicy;
+}
+
+const EventPolicy* ObserverTable::FindPolicy(uint32_t eventID) const
+{
+	if (eventID < DENSE_ID_COUNT)
+	{
+		return &mDense[eventID].mPolicy;
+	}
+
+	SparseEntry* entry = FindSparse(eventID);
+	return (entry != nullptr) ? &entry->mList.mPolicy : nullptr;
+}
+
+uint32_t ObserverTable::GetGeneration() const
+{
+	return mGeneration;
+}
+
+void ObserverTable::BeginDispatch()
+{
+	mDispatchDepth++;
+}
+
+void ObserverTable::EndDispatch()
+{
+	assert(mDispatchDepth > 0);
+	if (--mDispatchDepth > 0)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < mRemovalCount; i++)
+	{
+		ObserverList* list = FindOrInsert(mRemovalIDs[i]);
+
+		uint32_t count = 0;
+		for (uint32_t j = 0; j < list->mCount; j++)
+		{
+			if (list->mObservers[j] != nullptr)
+			{
+				list->mObservers[count++] = list->mObservers[j];
+			}
+		}
+
+		list->mCount		= count;
+		list->mHasRemovals	= false;
+	}
+
+	mRemovalCount = 0;
+}
+
+void ObserverTable::Clear()
+{
+	for (uint32_t i = 0; i < DENSE_ID_COUNT; i++)
+	{
+		Release(mDense[i].mObservers, sizeof(IObserver*) * mDense[i].mCapacity);
+	}
+
+	for (uint32_t i = 0; i < mSparseCapacity; i++)
+	{
+		Release(mSparse[i].mList.mObservers, sizeof(IObserver*) * mSparse[i].mList.mCapacity);
+	}
+
+	Release(mSparse, sizeof(SparseEntry) * mSparseCapacity);
+	Release(mRemovalIDs, sizeof(uint32_t) * mRemovalCapacity);
+
+	memset(mDense, 0, sizeof(mDense));
+	mSparse				= nullptr;
+	mSparseCapacity		= 0;
+	mSparseCount		= 0;
+	mRemovalIDs			= nullptr;
+	mRemovalCount		= 0;
+	mRemovalCapacity	= 0;
+	mGeneration++;
+}
+
+ObserverList* ObserverTable::FindOrInsert(uint32_t eventID)
+{
+	if (eventID < DENSE_ID_COUNT)
+	{
+		return &mDense[eventID];
+	}
+
+	assert(eventID != INVALID_ID);
+
+	SparseEntry* entry = FindSparse(eventID);
+	if (entry != nullptr)
+	{
+		return &entry->mList;
+	}
+
+	// Keep the load at or below one half so probes stay short.
+	if ((mSparseCount + 1) * 2 > mSparseCapacity)
+	{
+		GrowSparse();
+	}
+
+	uint32_t mask = mSparseCapacity - 1;
+	for (uint32_t slot = SparseSlot(eventID, mSparseCapacity); ; slot = (slot + 1) & mask)
+	{
+		if (mSparse[slot].mEventID == INVALID_ID)
+		{
+			mSparse[slot].mEventID = eventID;
+			mSparseCount++;
+			return &mSparse[slot].mList;
+		}
+	}
+}
+
+ObserverTable::SparseEntry* ObserverTable::FindSparse(uint32_t eventID) const
+{
+	if (mSparseCount == 0)
+	{
+		return nullptr;
+	}
+
+	uint32_t mask = mSparseCapacity - 1;
+	for (uint32_t slot = SparseSlot(eventID, mSparseCapacity); ; slot = (slot + 1) & mask)
+	{
+		if (mSparse[slot].mEventID == eventID)
+		{
+			return &mSparse[slot];
+		}
+
+		if (mSparse[slot].mEventID == INVALID_ID)
+		{
+			return nullptr;
+		}
+	}
+}
+
+void ObserverTable::GrowSparse()
+{
+	SparseEntry* entries	= mSparse;
+	uint32_t capacity		= mSparseCapacity;
+
+	mSparseCapacity	= (capacity > 0) ? capacity * 2 : INITIAL_SPARSE_CAPACITY;
+	mSparse			= (SparseEntry*)Reallocate(nullptr, 0, sizeof(SparseEntry) * mSparseCapacity);
+	memset(mSparse, 0, sizeof(SparseEntry) * mSparseCapacity);
+	mSparseCount	= 0;
+	mGeneration++;
+
+	for (uint32_t i = 0; i < mSparseCapacity; i++)
+	{
+		mSparse[i].mEventID = INVALID_ID;
+	}
+
+	for (uint32_t i = 0; i < capacity; i++)
+	{
+		if (entries[i].mEventID != INVALID_ID)
+		{
+			*FindOrInsert(entries[i].mEventID) = entries[i].mList;
+		}
+	}
+
+	Release(entries, sizeof(SparseEntry) * capacity);
+}
+
+void* ObserverTable::Reallocate(void* pointer, size_t oldSize, size_t newSize)
+{
+	return mAllocator.mReallocate(mAllocator.mContext, pointer, oldSize, newSize);
+}
+
+void ObserverTable::Release(void* pointer, size_t size)
+{
+	mAllocator.mFree(mAllocator.mContext, pointer, size);
+}
+
+#pragma endregion
+
+#pragma region IEventHandler
+
+IEventHandler::IEventHandler() : mRecorder(nullptr), mPostQueue(0), mIsQueued(false)
+{
+}
+
+IEventHandler::IEventHandler(const EventAllocator& allocator) :
+	mObservers(allocator), mQueues{ { allocator }, { allocator } }, mRecorder(nullptr), mPostQueue(0), mIsQueued(false)
 {
 }
 
 IEventHandler::~IEventHandler()
 {
-	mObservers.clear();
+	mObservers.Clear();
+	mQueues[0].Free();
+	mQueues[1].Free();
 }
 
 void IEventHandler::RegisterObserver(uint32_t eventID, IObserver* observer)
 {
-	ObserverMap::iterator mapEntry = mObservers.find(eventID);
-	if (mapEntry == mObservers.end()) 
+	mObservers.Add(eventID, observer);
+}
+
+void IEventHandler::UnregisterObserver(uint32_t eventID, IObserver* observer)
+{
+	mObservers.Remove(eventID, observer);
+}
+
+void IEventHandler::SetQueued(bool isQueued)
+{
+	if (mIsQueued && !isQueued)
+	{
+		DispatchQueuedEvents();
+	}
+
+	mIsQueued = isQueued;
+}
+
+bool IEventHandler::IsQueued() const
+{
+	return mIsQueued;
+}
+
+void IEventHandler::SetCoalescing(uint32_t eventID, EventCoalescing coalescing)
+{
+	assert(coalescing != EVENT_COALESCE_ACCUMULATE);	// Use SetAccumulator
+	mObservers.GetPolicy(eventID).mCoalescing = coalescing;
+}
+
+void IEventHandler::SetAccumulator(uint32_t eventID, EventAccumulator accumulator)
+{
+	EventPolicy& policy	= mObservers.GetPolicy(eventID);
+	policy.mAccumulator	= accumulator;
+	policy.mCoalescing	= (accumulator != nullptr) ? EVENT_COALESCE_ACCUMULATE : EVENT_COALESCE_NONE;
+}
+
+void IEventHandler::SetPriority(uint32_t eventID, EventPriority priority)
+{
+	mObservers.GetPolicy(eventID).mPriority = priority;
+}
+
+void IEventHandler::SetRecorder(EventRecorder* recorder)
+{
+	mRecorder = recorder;
+}
+
+EventQueue* IEventHandler::ApplyPolicy(uint32_t eventID, const IEvent& iEvent)
+{
+	const EventPolicy* policy = mObservers.FindPolicy(eventID);
+	if (!mIsQueued || (policy != nullptr && policy->mPriority == EVENT_PRIORITY_IMMEDIATE))
+	{
+		Dispatch(eventID, iEvent);
+		return nullptr;
+	}
+
+	EventQueue& queue = mQueues[mPostQueue];
+	if (policy == nullptr || policy->mCoalescing == EVENT_COALESCE_NONE)
 	{
-		// There are no observers for this event. Insert observer into set. Insert set into map.
-		mObservers.insert({ eventID, ObserverSet({ observer }) });
+		return &queue;
 	}
-	else if (mapEntry->second.find(observer) == mapEntry->second.end())
+
+	if (policy->mCoalescing == EVENT_COALESCE_ACCUMULATE)
 	{
-		// There are observers for this event. Check for unique observer.
-		mapEntry->second.insert(observer);
+		IEvent* pending = queue.GetLatest(eventID);
+		if (pending != nullptr)
+		{
+			policy->mAccumulator(*pending, iEvent);
+			return nullptr;
+		}
+
+		return &queue;
 	}
+
+	queue.DiscardLatest(eventID);
+	return &queue;
 }
 
-void IEventHandler::UnregisterObserver(uint32_t eventID, IObserver* observer)
+void IEventHandler::DispatchQueuedEvents()
+{
+	// Observers posting from their handlers fill the other queue.
+	EventQueue& queue	= mQueues[mPostQueue];
+	mPostQueue			^= 1;
+
+	queue.GroupRuns();
+	for (uint32_t i = 0; i < queue.GetBatchCount(); i++)
+	{
+		EventQueue::Batch batch = queue.GetBatch(i);
+		DispatchBatch(batch.mEventID, batch.mEvents, batch.mCount);
+	}
+
+	queue.Reset();
+}
+
+void IEventHandler::Dispatch(uint32_t eventID, const IEvent& iEvent)
+{
+	const IEvent* events[1] = { &iEvent };
+	DispatchBatch(eventID, events, 1);
+}
+
+void IEventHandler::DispatchBatch(uint32_t eventID, const IEvent* const* events, uint32_t count)
 {
-	ObserverMap::iterator mapEntry = mObservers.find(eventID);
-	if (mapEntry != mObservers.end()) 
+	if (mRecorder != nullptr)
 	{
-		mapEntry->second.erase(observer);
-		if (mapEntry->second.empty())
+		for (uint32_t j = 0; j < count; j++)
 		{
-			mObservers.erase(eventID);
+			mRecorder->Record(eventID, *events[j]);
 		}
 	}
-}
\ No newline at end of file
+
+	EVENT_TRACK_DISPATCH(eventID, count);
+
+	const ObserverList* list	= mObservers.Find(eventID);
+	uint32_t generation			= mObservers.GetGeneration();
+
+	mObservers.BeginDispatch();
+	for (uint32_t i = 0; list != nullptr && i < list->mCount; i++)
+	{
+		IObserver* observer = list->mObservers[i];
+
+		for (uint32_t j = 0; observer != nullptr && j < count; j++)
+		{
+			{
+				EVENT_TIME_CALL(eventID, observer, typeid(*observer).name());
+				observer->HandleEvent(*events[j]);
+			}
+
+			if (mObservers.GetGeneration() != generation)
+			{
+				list		= mObservers.Find(eventID);
+				generation	= mObservers.GetGeneration();
+			}
+
+			// An observer unregistered during the batch leaves its slot empty.
+			observer = (list != nullptr) ? list->mObservers[i] : nullptr;
+		}
+	}
+	mObservers.EndDispatch();
+}
+
+#pragma endregion
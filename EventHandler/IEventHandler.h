@@ -1,8 +1,8 @@
 #pragma once
+#include "EventQueue.h"
 #include <functional>
-#include <unordered_map>
-#include <set>
 #include <stdint.h>
+#include <new>
 
 #pragma warning (disable: 4251)
 
@@ -12,6 +12,8 @@
 #define IEVENT_API __declspec(dllimport)
 #endif
 
+class EventRecorder;
+
 class IEVENT_API IEvent
 {
 public:
@@ -28,8 +30,107 @@ public:
 	virtual void HandleEvent(const IEvent& iEvent) = 0;
 };
 
-typedef std::set<IObserver*>						ObserverSet;
-typedef std::unordered_map<uint32_t, ObserverSet>	ObserverMap;
+// What queued mode does with an event that has one of the same ID pending.
+enum EventCoalescing : uint8_t
+{
+	EVENT_COALESCE_NONE,			// Keep every event
+	EVENT_COALESCE_LATEST,			// The new event replaces the pending one
+	EVENT_COALESCE_ACCUMULATE		// The new event is merged into the pending one
+};
+
+enum EventPriority : uint8_t
+{
+	EVENT_PRIORITY_QUEUED,
+	EVENT_PRIORITY_IMMEDIATE		// Dispatched when posted, even in queued mode
+};
+
+// Folds iEvent into accumulated, e.g. summing wheel deltas. Both have the event ID's type.
+typedef void (*EventAccumulator)(IEvent& accumulated, const IEvent& iEvent);
+
+struct IEVENT_API EventPolicy
+{
+	EventAccumulator	mAccumulator;
+	EventCoalescing		mCoalescing;
+	EventPriority		mPriority;
+};
+
+// Observers of one event ID, contiguous so dispatch walks a single array.
+struct IEVENT_API ObserverList
+{
+	IObserver**	mObservers;		// nullptr entries were removed during dispatch
+	uint32_t	mCount;
+	uint32_t	mCapacity;
+	EventPolicy	mPolicy;
+	bool		mHasRemovals;
+};
+
+// Maps event IDs to observer lists. IDs below DENSE_ID_COUNT (every WM_ message
+// below WM_USER) index a flat table; other IDs go to an open addressed table.
+// Adding is an append, removing swaps the last observer into the hole, so the
+// order of observers is not kept. Between BeginDispatch and EndDispatch removal
+// only clears the slot, so no observer moves under a dispatch loop; the lists
+// are compacted when the outermost dispatch ends. A list stays in the table
+// once its ID has been seen, which keeps the sparse table free of tombstones.
+class IEVENT_API ObserverTable
+{
+public:
+	static const uint32_t DENSE_ID_COUNT	= 1024;
+	static const uint32_t INVALID_ID		= 0xFFFFFFFF;
+
+	// The allocator must outlive the table.
+	ObserverTable(const EventAllocator& allocator = EventAllocator::Heap());
+	~ObserverTable();
+
+	// Each observer may be added once per ID.
+	void				Add(uint32_t eventID, IObserver* observer);
+	bool				Remove(uint32_t eventID, IObserver* observer);
+
+	// nullptr when nothing ever registered for eventID.
+	const ObserverList*	Find(uint32_t eventID) const;
+
+	// Policies apply whether or not the ID has observers. FindPolicy is nullptr
+	// for a sparse ID nothing was registered or set for (the default policy).
+	EventPolicy&		GetPolicy(uint32_t eventID);
+	const EventPolicy*	FindPolicy(uint32_t eventID) const;
+
+	// Changes whenever lists move (sparse table growth), invalidating Find results.
+	uint32_t			GetGeneration() const;
+
+	// Dispatches may nest.
+	void				BeginDispatch();
+	void				EndDispatch();
+
+	void				Clear();
+
+private:
+	struct SparseEntry
+	{
+		uint32_t		mEventID;
+		ObserverList	mList;
+	};
+
+	EventAllocator	mAllocator;
+	ObserverList	mDense[DENSE_ID_COUNT];
+	SparseEntry*	mSparse;
+	uint32_t		mSparseCapacity;
+	uint32_t		mSparseCount;
+	uint32_t		mGeneration;
+
+	uint32_t*		mRemovalIDs;	// Lists with cleared slots
+	uint32_t		mRemovalCount;
+	uint32_t		mRemovalCapacity;
+	uint32_t		mDispatchDepth;
+
+	ObserverList*	FindOrInsert(uint32_t eventID);
+	SparseEntry*	FindSparse(uint32_t eventID) const;
+	void			GrowSparse();
+
+	void*			Reallocate(void* pointer, size_t oldSize, size_t newSize);
+	void			Release(void* pointer, size_t size);
+
+	ObserverTable(ObserverTable const&) = delete;
+	void operator=(ObserverTable const&) = delete;
+};
 
 class IEVENT_API IEventHandler
 {
@@ -37,12 +138,58 @@ public:
 	IEventHandler();
 	~IEventHandler();
 
+	// Observer lists and queued events take their memory from allocator.
+	IEventHandler(const EventAllocator& allocator);
+
 	void RegisterObserver(uint32_t eventID, IObserver* observer);
 	void UnregisterObserver(uint32_t eventID, IObserver* observer);
 	virtual void NotifyObservers(const IEvent& iEvent) = 0;
 
+	// In queued mode events are copied when posted and reach observers only in
+	// DispatchQueuedEvents, in posting order. Consecutive events of one ID form a
+	// batch: each observer handles the whole batch before the next observer
+	// runs. Events posted while the queue is dispatched go out with the next
+	// call. Leaving queued mode dispatches what is pending.
+	void SetQueued(bool isQueued);
+	bool IsQueued() const;
+	void DispatchQueuedEvents();
+
+	// Per event ID, for queued mode. Coalesced IDs must always be posted with
+	// the same event type. Immediate events overtake queued ones posted before them.
+	void SetCoalescing(uint32_t eventID, EventCoalescing coalescing);
+	void SetAccumulator(uint32_t eventID, EventAccumulator accumulator);
+	void SetPriority(uint32_t eventID, EventPriority priority);
+
+	// Every event dispatched from now on is also written to recorder; nullptr stops recording.
+	void SetRecorder(EventRecorder* recorder);
+
 protected:
-	ObserverMap mObservers;
+	ObserverTable	mObservers;
+	EventQueue		mQueues[2];
+	EventRecorder*	mRecorder;
+	uint32_t		mPostQueue;
+	bool			mIsQueued;
+
+	// Calls every observer of eventID. Observers may unregister any observer and
+	// register others while it runs; observers registered meanwhile are called too.
+	void Dispatch(uint32_t eventID, const IEvent& iEvent);
+
+	// Handlers that also deliver to typed subscribers extend this.
+	virtual void DispatchBatch(uint32_t eventID, const IEvent* const* events, uint32_t count);
+
+	// What NotifyObservers should do with an event: dispatch it now, or queue a copy.
+	template<class TEvent>
+	void Post(uint32_t eventID, const TEvent& iEvent)
+	{
+		EventQueue* queue = ApplyPolicy(eventID, iEvent);
+		if (queue != nullptr)
+		{
+			queue->Push(eventID, new (queue->Allocate(sizeof(TEvent), alignof(TEvent))) TEvent(iEvent));
+		}
+	}
+
+	// The queue to copy iEvent into, or nullptr when it was dispatched or merged instead.
+	EventQueue* ApplyPolicy(uint32_t eventID, const IEvent& iEvent);
 };
 
 namespace std
@@ -36,19 +36,9 @@ class EV : public IEventHandler
 {
 public:
 
-	void NotifyObservers(uint32_t eventID) override
+	void NotifyObservers(const IEvent& iEvent) override
 	{
-		ObserverMap::iterator mapEntry = mObservers.find(eventID);
-		if (mapEntry == mObservers.end())
-		{
-			return;
-		}
-
-		for (ObserverSet::const_iterator iter = mapEntry->second.begin(); iter != mapEntry->second.end(); iter++)
-		{
-			Eventt e = Eventt(eventID, "Event");
-			(*iter)->HandleEvent(e);
-		}
+		Dispatch(static_cast<const Eventt&>(iEvent).ID, iEvent);
 	}
 };
 
@@ -65,8 +55,8 @@ int main()
 	e.RegisterObserver(eventIDs[0], &o1);
 	e.RegisterObserver(eventIDs[1], &o2);
 	e.RegisterObserver(eventIDs[0], &o3);
-	e.NotifyObservers(eventIDs[0]);
-	e.NotifyObservers(eventIDs[1]);
+	e.NotifyObservers(Eventt(eventIDs[0], "Event"));
+	e.NotifyObservers(Eventt(eventIDs[1], "Event"));
 
 	getchar();
 }
\ No newline at end of file
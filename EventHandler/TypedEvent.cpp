@@ -0,0 +1,163 @@
+#include "TypedEvent.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+static const uint32_t INITIAL_LIST_CAPACITY			= 16;
+static const uint32_t INITIAL_DELEGATE_CAPACITY		= 4;
+
+TypedEventDispatcher::TypedEventDispatcher() : mLists(nullptr), mListCount(0), mListCapacity(0), mGeneration(0), mPublishDepth(0)
+{
+}
+
+TypedEventDispatcher::~TypedEventDispatcher()
+{
+	Clear();
+}
+
+void TypedEventDispatcher::Add(uint32_t eventID, const ErasedDelegate& delegate)
+{
+	assert(delegate.mStub != nullptr);	// nullptr marks a removed slot
+
+	uint32_t index = Find(eventID);
+	if (index == INVALID_INDEX)
+	{
+		if (mListCount == mListCapacity)
+		{
+			mListCapacity	= (mListCapacity > 0) ? mListCapacity * 2 : INITIAL_LIST_CAPACITY;
+			mLists			= (DelegateList*)realloc(mLists, sizeof(DelegateList) * mListCapacity);
+		}
+
+		// Insert in ID order.
+		index = 0;
+		while (index < mListCount && mLists[index].mEventID < eventID)
+		{
+			index++;
+		}
+
+		memmove(&mLists[index + 1], &mLists[index], sizeof(DelegateList) * (mListCount - index));
+		mListCount++;
+		mGeneration++;
+
+		mLists[index].mEventID		= eventID;
+		mLists[index].mCount		= 0;
+		mLists[index].mCapacity		= 0;
+		mLists[index].mDelegates	= nullptr;
+		mLists[index].mHasRemovals	= false;
+	}
+
+	DelegateList& list = mLists[index];
+
+#ifndef NDEBUG
+	for (uint32_t i = 0; i < list.mCount; i++)
+	{
+		assert(!(list.mDelegates[i] == delegate));	// Already subscribed to this event
+	}
+#endif
+
+	if (list.mCount == list.mCapacity)
+	{
+		list.mCapacity	= (list.mCapacity > 0) ? list.mCapacity * 2 : INITIAL_DELEGATE_CAPACITY;
+		list.mDelegates	= (ErasedDelegate*)realloc(list.mDelegates, sizeof(ErasedDelegate) * list.mCapacity);
+	}
+
+	list.mDelegates[list.mCount++] = delegate;
+}
+
+void TypedEventDispatcher::Remove(uint32_t eventID, const ErasedDelegate& delegate)
+{
+	uint32_t index = Find(eventID);
+	if (index == INVALID_INDEX)
+	{
+		return;
+	}
+
+	DelegateList& list = mLists[index];
+	for (uint32_t i = 0; i < list.mCount; i++)
+	{
+		if (!(list.mDelegates[i] == delegate))
+		{
+			continue;
+		}
+
+		if (mPublishDepth == 0)
+		{
+			list.mDelegates[i] = list.mDelegates[--list.mCount];
+		}
+		else
+		{
+			// Swapping would move a delegate the running publish has yet to reach
+			// into a slot it has already passed.
+			list.mDelegates[i].mInstance	= nullptr;
+			list.mDelegates[i].mStub		= nullptr;
+			list.mHasRemovals				= true;
+		}
+
+		return;
+	}
+}
+
+void TypedEventDispatcher::EndPublish()
+{
+	assert(mPublishDepth > 0);
+	if (--mPublishDepth > 0)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < mListCount; i++)
+	{
+		DelegateList& list = mLists[i];
+		if (!list.mHasRemovals)
+		{
+			continue;
+		}
+
+		uint32_t count = 0;
+		for (uint32_t j = 0; j < list.mCount; j++)
+		{
+			if (list.mDelegates[j].mStub != nullptr)
+			{
+				list.mDelegates[count++] = list.mDelegates[j];
+			}
+		}
+
+		list.mCount			= count;
+		list.mHasRemovals	= false;
+	}
+}
+
+uint32_t TypedEventDispatcher::Find(uint32_t eventID) const
+{
+	uint32_t first	= 0;
+	uint32_t last	= mListCount;
+	while (first < last)
+	{
+		uint32_t middle = (first + last) / 2;
+		if (mLists[middle].mEventID < eventID)
+		{
+			first = middle + 1;
+		}
+		else
+		{
+			last = middle;
+		}
+	}
+
+	return (first < mListCount && mLists[first].mEventID == eventID) ? first : INVALID_INDEX;
+}
+
+void TypedEventDispatcher::Clear()
+{
+	for (uint32_t i = 0; i < mListCount; i++)
+	{
+		free(mLists[i].mDelegates);
+	}
+
+	free(mLists);
+
+	mLists			= nullptr;
+	mListCount		= 0;
+	mListCapacity	= 0;
+	mGeneration++;
+}
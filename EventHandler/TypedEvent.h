@@ -0,0 +1,268 @@
+#pragma once
+#include "DispatchStats.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <tuple>
+#include <type_traits>
+
+#pragma warning (disable: 4251)
+
+#ifdef _WINDLL
+#define IEVENT_API __declspec(dllexport)
+#else
+#define IEVENT_API __declspec(dllimport)
+#endif
+
+// Typed events: plain structs that carry their ID, e.g.
+//
+//	struct ControlPointMoved
+//	{
+//		static constexpr uint32_t ID = EventTypeHash("ControlPointMoved");
+//		uint32_t	mIndex;
+//		float		mX, mY;
+//	};
+//
+// Subscribers receive the concrete type through an EventDelegate bound to a
+// member or free function at compile time: no virtual HandleEvent, no downcast
+// and no switch on the ID inside the handler. Types that share one layout for
+// many IDs (window messages) subscribe and publish with an explicit ID.
+//
+// References:	http://www.isthe.com/chongo/tech/comp/fnv/
+//				https://www.codeproject.com/Articles/11015/The-Impossibly-Fast-C-Delegates
+
+// FNV-1a, usable in constant expressions.
+constexpr uint32_t EventTypeHash(const char* name, uint32_t hash = 2166136261u)
+{
+	return (*name == 0) ? hash : EventTypeHash(name + 1, (hash ^ (uint8_t)*name) * 16777619u);
+}
+
+#pragma region EventDelegate
+
+// A function the dispatcher can call without knowing the event type.
+struct IEVENT_API ErasedDelegate
+{
+	typedef void (*Stub)(void* instance, const void* iEvent);
+
+	void*	mInstance;
+	Stub	mStub;
+
+	bool operator==(const ErasedDelegate& other) const { return mInstance == other.mInstance && mStub == other.mStub; };
+};
+
+// Two pointers, bound without allocating. The stub calls the target directly,
+// so the compiler can inline the handler into it.
+template<class TEvent>
+class EventDelegate
+{
+public:
+	template<class T, void (T::*Method)(const TEvent&)>
+	static EventDelegate FromMethod(T* instance)
+	{
+		return EventDelegate(instance, &MethodStub<T, Method>);
+	}
+
+	template<void (*Function)(const TEvent&)>
+	static EventDelegate FromFunction()
+	{
+		return EventDelegate(nullptr, &FunctionStub<Function>);
+	}
+
+	void operator()(const TEvent& iEvent) const
+	{
+		mDelegate.mStub(mDelegate.mInstance, &iEvent);
+	}
+
+	const ErasedDelegate& GetErased() const { return mDelegate; };
+
+private:
+	ErasedDelegate mDelegate;
+
+	EventDelegate(void* instance, ErasedDelegate::Stub stub)
+	{
+		mDelegate.mInstance	= instance;
+		mDelegate.mStub		= stub;
+	}
+
+	template<class T, void (T::*Method)(const TEvent&)>
+	static void MethodStub(void* instance, const void* iEvent)
+	{
+		(static_cast<T*>(instance)->*Method)(*static_cast<const TEvent*>(iEvent));
+	}
+
+	template<void (*Function)(const TEvent&)>
+	static void FunctionStub(void*, const void* iEvent)
+	{
+		Function(*static_cast<const TEvent*>(iEvent));
+	}
+};
+
+#pragma endregion
+
+#pragma region TypedEventDispatcher
+
+// Runtime subscriptions, one delegate list per event ID. Lists are kept sorted
+// by ID and found by binary search; removal swaps the last delegate into the
+// hole, or only clears it while an event is published, so delegates may
+// subscribe and unsubscribe any delegate from inside a handler.
+class IEVENT_API TypedEventDispatcher
+{
+public:
+	TypedEventDispatcher();
+	~TypedEventDispatcher();
+
+	template<class TEvent>
+	void Subscribe(const EventDelegate<TEvent>& delegate)
+	{
+		Add(TEvent::ID, delegate.GetErased());
+	}
+
+	template<class TEvent>
+	void Subscribe(uint32_t eventID, const EventDelegate<TEvent>& delegate)
+	{
+		Add(eventID, delegate.GetErased());
+	}
+
+	template<class TEvent>
+	void Unsubscribe(const EventDelegate<TEvent>& delegate)
+	{
+		Remove(TEvent::ID, delegate.GetErased());
+	}
+
+	template<class TEvent>
+	void Unsubscribe(uint32_t eventID, const EventDelegate<TEvent>& delegate)
+	{
+		Remove(eventID, delegate.GetErased());
+	}
+
+	template<class TEvent>
+	void Publish(const TEvent& iEvent)
+	{
+		const TEvent* events[1] = { &iEvent };
+		PublishBatch(TEvent::ID, events, 1);
+	}
+
+	template<class TEvent>
+	void Publish(uint32_t eventID, const TEvent& iEvent)
+	{
+		const TEvent* events[1] = { &iEvent };
+		PublishBatch(eventID, events, 1);
+	}
+
+	// Each delegate handles every event of the batch before the next delegate runs.
+	// TSource lets a batch of base pointers (IEvent) publish as their concrete type.
+	template<class TEvent, class TSource>
+	void PublishBatch(uint32_t eventID, const TSource* const* events, uint32_t count)
+	{
+		uint32_t listIndex	= Find(eventID);
+		uint32_t generation	= mGeneration;
+
+		mPublishDepth++;
+		for (uint32_t i = 0; listIndex != INVALID_INDEX && i < mLists[listIndex].mCount; i++)
+		{
+			ErasedDelegate delegate = mLists[listIndex].mDelegates[i];
+
+			for (uint32_t j = 0; delegate.mStub != nullptr && j < count; j++)
+			{
+				{
+					// Free function delegates have no instance and go by their stub.
+					EVENT_TIME_CALL(eventID, (delegate.mInstance) ? delegate.mInstance : (const void*)delegate.mStub, nullptr);
+					delegate.mStub(delegate.mInstance, static_cast<const TEvent*>(events[j]));
+				}
+
+				if (mGeneration != generation)
+				{
+					listIndex	= Find(eventID);
+					generation	= mGeneration;
+				}
+
+				// A delegate unsubscribed during the batch leaves its slot empty.
+				delegate.mStub = (listIndex != INVALID_INDEX) ? mLists[listIndex].mDelegates[i].mStub : nullptr;
+			}
+		}
+		EndPublish();
+	}
+
+	template<class TEvent>
+	void PublishBatch(uint32_t eventID, const TEvent* const* events, uint32_t count)
+	{
+		PublishBatch<TEvent, TEvent>(eventID, events, count);
+	}
+
+	void Clear();
+
+private:
+	static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+	struct DelegateList
+	{
+		uint32_t			mEventID;
+		uint32_t			mCount;
+		uint32_t			mCapacity;
+		ErasedDelegate*		mDelegates;		// mStub nullptr for slots cleared while publishing
+		bool				mHasRemovals;
+	};
+
+	DelegateList*	mLists;
+	uint32_t		mListCount;
+	uint32_t		mListCapacity;
+	uint32_t		mGeneration;	// Changes when lists move
+	uint32_t		mPublishDepth;
+
+	void		Add(uint32_t eventID, const ErasedDelegate& delegate);
+	void		Remove(uint32_t eventID, const ErasedDelegate& delegate);
+	uint32_t	Find(uint32_t eventID) const;
+
+	// Compacts the lists with cleared slots once the outermost publish ends.
+	void		EndPublish();
+
+	TypedEventDispatcher(TypedEventDispatcher const&) = delete;
+	void operator=(TypedEventDispatcher const&) = delete;
+};
+
+#pragma endregion
+
+#pragma region StaticEventDispatcher
+
+// For a handler set known at compile time: Publish calls OnEvent(const TEvent&)
+// on every handler that has such an overload, resolved and inlined by the
+// compiler. Handlers without one are skipped at no cost.
+template<class... THandlers>
+class StaticEventDispatcher
+{
+public:
+	StaticEventDispatcher(THandlers&... handlers) : mHandlers(&handlers...) {};
+
+	template<class TEvent>
+	void Publish(const TEvent& iEvent)
+	{
+		PublishFrom<0>(iEvent);
+	}
+
+private:
+	std::tuple<THandlers*...> mHandlers;
+
+	template<size_t Index, class TEvent>
+	typename std::enable_if<(Index < sizeof...(THandlers))>::type PublishFrom(const TEvent& iEvent)
+	{
+		Deliver(*std::get<Index>(mHandlers), iEvent, 0);
+		PublishFrom<Index + 1>(iEvent);
+	}
+
+	template<size_t Index, class TEvent>
+	typename std::enable_if<(Index == sizeof...(THandlers))>::type PublishFrom(const TEvent&)
+	{
+	}
+
+	template<class THandler, class TEvent>
+	static auto Deliver(THandler& handler, const TEvent& iEvent, int) -> decltype(handler.OnEvent(iEvent), void())
+	{
+		handler.OnEvent(iEvent);
+	}
+
+	template<class THandler, class TEvent>
+	static void Deliver(THandler&, const TEvent&, long)
+	{
+	}
+};
+
+#pragma endregion
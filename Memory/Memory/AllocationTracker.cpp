@@ -0,0 +1,359 @@
+#include "AllocationTracker.h"
+#include <atomic>
+
+#if defined(MEMORY_ALLOCATION_TRACKING) && defined(_MSC_VER) && defined(_DEBUG)
+#include <Windows.h>
+#include <crtdbg.h>
+#define MEMORY_CRT_ALLOC_HOOK
+#endif
+
+#if defined(MEMORY_ALLOCATION_TRACKING) && defined(__linux__)
+#include <new>
+#include <errno.h>
+#define MEMORY_MALLOC_INTERPOSITION
+#endif
+
+// The hooks run inside malloc, so thread state must not need malloc itself (initial-exec TLS on glibc).
+#if defined(__GNUC__)
+#define TRACKER_THREAD_LOCAL thread_local __attribute__((tls_model("initial-exec")))
+#else
+#define TRACKER_THREAD_LOCAL thread_local
+#endif
+
+using namespace cliqCity::memory;
+
+namespace
+{
+	struct CallSiteBucket
+	{
+		std::atomic<const void*>	mAddress;		// first call site hashed here
+		std::atomic<uint64_t>		mAllocationCount;
+		std::atomic<uint64_t>		mBytes;
+	};
+
+	// Trivial, so it is zero initialized per thread without a TLS constructor.
+	struct ThreadCounters
+	{
+		uint64_t	mAllocationCount;
+		uint64_t	mBytes;
+		uint64_t	mFrameIndex;
+		uint64_t	mFrameAllocationCount;
+		uint64_t	mFrameBytes;
+		uint32_t	mScopeDepth;
+	};
+
+	// Zero initialized static storage, usable by allocations made before main.
+	std::atomic<uint64_t>		gFrameIndex;
+	std::atomic<uint64_t>		gFrameCount;
+	std::atomic<uint64_t>		gFrameBytes;
+	std::atomic<uint64_t>		gLastFrameCount;
+	std::atomic<uint64_t>		gLastFrameBytes;
+	std::atomic<uint64_t>		gTotalCount;
+	std::atomic<uint64_t>		gTotalBytes;
+	std::atomic<uint64_t>		gViolationCount;
+	std::atomic<const void*>	gLastViolationSite;
+	CallSiteBucket				gCallSites[AllocationTracker::CALL_SITE_BUCKET_COUNT];
+
+	TRACKER_THREAD_LOCAL ThreadCounters gThreadCounters;
+
+	ThreadCounters& GetThreadCountersForFrame()
+	{
+		ThreadCounters& counters	= gThreadCounters;
+		uint64_t frameIndex			= gFrameIndex.load(std::memory_order_relaxed);
+
+		if (counters.mFrameIndex != frameIndex)
+		{
+			counters.mFrameIndex			= frameIndex;
+			counters.mFrameAllocationCount	= 0;
+			counters.mFrameBytes			= 0;
+		}
+
+		return counters;
+	}
+
+	uint32_t CallSiteBucketIndex(const void* callSite)
+	{
+		// Multiplicative hash; the high byte of the product picks one of 256 buckets.
+		static_assert(AllocationTracker::CALL_SITE_BUCKET_COUNT == 256, "Update the shift below");
+		return (uint32_t)((uint32_t)(uintptr_t)callSite * 2654435761u) >> 24;
+	}
+}
+
+#pragma region Hooks
+
+#ifdef MEMORY_CRT_ALLOC_HOOK
+static int __cdecl TrackerAllocHook(int allocType, void*, size_t size, int blockType, long, const unsigned char*, int)
+{
+	// CRT blocks are the CRT's own bookkeeping, and the hook must not allocate from the CRT heap.
+	if (blockType != _CRT_BLOCK && (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC))
+	{
+		void* callSite = nullptr;
+		CaptureStackBackTrace(2, 1, &callSite, nullptr);
+		AllocationTracker::Record(size, callSite);
+	}
+
+	return TRUE;
+}
+#endif
+
+#ifdef MEMORY_MALLOC_INTERPOSITION
+// glibc's own entry points. Frees go straight to glibc, the heap is the same.
+extern "C" void*	__libc_malloc(size_t size);
+extern "C" void*	__libc_calloc(size_t count, size_t size);
+extern "C" void*	__libc_realloc(void* pointer, size_t size);
+extern "C" void*	__libc_memalign(size_t alignment, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+	void* pointer = __libc_malloc(size);
+	AllocationTracker::Record(size, __builtin_return_address(0));
+	return pointer;
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+	void* pointer = __libc_calloc(count, size);
+	AllocationTracker::Record(count * size, __builtin_return_address(0));
+	return pointer;
+}
+
+extern "C" void* realloc(void* pointer, size_t size)
+{
+	// Shrinking or freeing through realloc is not an allocation.
+	if (size > 0)
+	{
+		AllocationTracker::Record(size, __builtin_return_address(0));
+	}
+
+	return __libc_realloc(pointer, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size)
+{
+	void* pointer = __libc_memalign(alignment, size);
+	AllocationTracker::Record(size, __builtin_return_address(0));
+	return pointer;
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+	void* pointer = __libc_memalign(alignment, size);
+	AllocationTracker::Record(size, __builtin_return_address(0));
+	return pointer;
+}
+
+extern "C" int posix_memalign(void** pointer, size_t alignment, size_t size)
+{
+	if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+	{
+		return EINVAL;
+	}
+
+	*pointer = __libc_memalign(alignment, size);
+	AllocationTracker::Record(size, __builtin_return_address(0));
+	return (*pointer) ? 0 : ENOMEM;
+}
+
+// Replaced so the call site is the caller of new rather than operator new itself.
+static void* TrackedNew(size_t size, const void* callSite, bool canThrow)
+{
+	AllocationTracker::Record(size, callSite);
+
+	size = (size == 0) ? 1 : size;
+	for (;;)
+	{
+		void* pointer = __libc_malloc(size);
+		if (pointer != nullptr)
+		{
+			return pointer;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+		if (handler == nullptr)
+		{
+			if (canThrow)
+			{
+				throw std::bad_alloc();
+			}
+
+			return nullptr;
+		}
+
+		handler();
+	}
+}
+
+void* operator new(size_t size)
+{
+	return TrackedNew(size, __builtin_return_address(0), true);
+}
+
+void* operator new[](size_t size)
+{
+	return TrackedNew(size, __builtin_return_address(0), true);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return TrackedNew(size, __builtin_return_address(0), false);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return TrackedNew(size, __builtin_return_address(0), false);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+#endif
+
+#pragma endregion
+
+#pragma region AllocationTracker
+
+void AllocationTracker::Install()
+{
+#ifdef MEMORY_CRT_ALLOC_HOOK
+	if (_CrtGetAllocHook() != TrackerAllocHook)
+	{
+		_CrtSetAllocHook(TrackerAllocHook);
+	}
+#endif
+}
+
+void AllocationTracker::BeginFrame()
+{
+	gLastFrameCount.store(gFrameCount.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+	gLastFrameBytes.store(gFrameBytes.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+	gFrameIndex.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::GetFrameIndex()
+{
+	return gFrameIndex.load(std::memory_order_relaxed);
+}
+
+bool AllocationTracker::IsSteadyState()
+{
+	return GetFrameIndex() >= STEADY_STATE_FRAME;
+}
+
+void AllocationTracker::Record(size_t size, const void* callSite)
+{
+	gFrameCount.fetch_add(1, std::memory_order_relaxed);
+	gFrameBytes.fetch_add(size, std::memory_order_relaxed);
+	gTotalCount.fetch_add(1, std::memory_order_relaxed);
+	gTotalBytes.fetch_add(size, std::memory_order_relaxed);
+
+	ThreadCounters& counters = GetThreadCountersForFrame();
+	counters.mAllocationCount++;
+	counters.mBytes += size;
+	counters.mFrameAllocationCount++;
+	counters.mFrameBytes += size;
+
+	CallSiteBucket& bucket	= gCallSites[CallSiteBucketIndex(callSite)];
+	const void* address		= nullptr;
+	bucket.mAddress.compare_exchange_strong(address, callSite, std::memory_order_relaxed);
+	bucket.mAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	bucket.mBytes.fetch_add(size, std::memory_order_relaxed);
+
+	if (counters.mScopeDepth > 0)
+	{
+		gViolationCount.fetch_add(1, std::memory_order_relaxed);
+		gLastViolationSite.store(callSite, std::memory_order_relaxed);
+	}
+}
+
+AllocationCounters AllocationTracker::GetFrameCounters()
+{
+	return { gFrameCount.load(std::memory_order_relaxed), gFrameBytes.load(std::memory_order_relaxed) };
+}
+
+AllocationCounters AllocationTracker::GetLastFrameCounters()
+{
+	return { gLastFrameCount.load(std::memory_order_relaxed), gLastFrameBytes.load(std::memory_order_relaxed) };
+}
+
+AllocationCounters AllocationTracker::GetTotalCounters()
+{
+	return { gTotalCount.load(std::memory_order_relaxed), gTotalBytes.load(std::memory_order_relaxed) };
+}
+
+AllocationCounters AllocationTracker::GetThreadCounters()
+{
+	return { gThreadCounters.mAllocationCount, gThreadCounters.mBytes };
+}
+
+AllocationCounters AllocationTracker::GetThreadFrameCounters()
+{
+	ThreadCounters& counters = GetThreadCountersForFrame();
+	return { counters.mFrameAllocationCount, counters.mFrameBytes };
+}
+
+uint32_t AllocationTracker::GetCallSites(AllocationCallSite* sites, uint32_t maxCount)
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < CALL_SITE_BUCKET_COUNT; i++)
+	{
+		CallSiteBucket& bucket = gCallSites[i];
+		if (bucket.mAllocationCount.load(std::memory_order_relaxed) == 0)
+		{
+			continue;
+		}
+
+		if (count < maxCount)
+		{
+			sites[count].mAddress			= bucket.mAddress.load(std::memory_order_relaxed);
+			sites[count].mAllocationCount	= bucket.mAllocationCount.load(std::memory_order_relaxed);
+			sites[count].mBytes				= bucket.mBytes.load(std::memory_order_relaxed);
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
+void AllocationTracker::ResetCallSites()
+{
+	for (uint32_t i = 0; i < CALL_SITE_BUCKET_COUNT; i++)
+	{
+		gCallSites[i].mAllocationCount.store(0, std::memory_order_relaxed);
+		gCallSites[i].mBytes.store(0, std::memory_order_relaxed);
+		gCallSites[i].mAddress.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+void AllocationTracker::PushNoAllocationScope()
+{
+	gThreadCounters.mScopeDepth++;
+}
+
+void AllocationTracker::PopNoAllocationScope()
+{
+	assert(gThreadCounters.mScopeDepth > 0);
+	gThreadCounters.mScopeDepth--;
+}
+
+uint64_t AllocationTracker::GetViolationCount()
+{
+	return gViolationCount.load(std::memory_order_relaxed);
+}
+
+const void* AllocationTracker::GetLastViolationSite()
+{
+	return gLastViolationSite.load(std::memory_order_relaxed);
+}
+
+#pragma endregion
@@ -0,0 +1,134 @@
+// AllocationTracker
+//
+// Counts heap allocations (malloc and operator new) per frame, per thread and
+// per call site, so the rule against steady state heap allocation can be
+// measured and enforced. Define MEMORY_ALLOCATION_TRACKING when building Memory
+// and the engine to turn it on; without it the macros below expand to nothing.
+//
+// Hooks: on Linux, Memory replaces malloc, calloc, realloc, the memalign family
+// and the global operator new, forwarding to glibc. With the MSVC debug
+// CRT, MEMORY_ALLOCATION_TRACKER_INSTALL sets a _CrtSetAllocHook that sees every
+// CRT heap allocation in the process. Release CRT builds count nothing.
+//
+// Call sites are return addresses hashed into CALL_SITE_BUCKET_COUNT buckets;
+// a bucket reports the first address that landed in it. On MSVC the address is
+// the first frame above the CRT hook, so treat it as approximate.
+//
+// NoHeapAllocationScope asserts that the calling thread made no heap allocation
+// while it was alive. The tracker remembers the call site of the last
+// offending allocation (GetLastViolationSite) to look up in the debugger.
+//
+// References:	https://www.gnu.org/software/libc/manual/html_node/Replacing-malloc.html
+//				https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/crtsetallochook
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+#define MEMORY_NO_HEAP_ALLOCATIONS_CONCAT(a, b)		a##b
+#define MEMORY_NO_HEAP_ALLOCATIONS_NAME(line)		MEMORY_NO_HEAP_ALLOCATIONS_CONCAT(noHeapAllocationScope, line)
+
+#ifdef MEMORY_ALLOCATION_TRACKING
+#define MEMORY_ALLOCATION_TRACKER_INSTALL()			cliqCity::memory::AllocationTracker::Install()
+#define MEMORY_ALLOCATION_FRAME()					cliqCity::memory::AllocationTracker::BeginFrame()
+#define MEMORY_NO_HEAP_ALLOCATIONS_SCOPE(isEnforced)	cliqCity::memory::NoHeapAllocationScope MEMORY_NO_HEAP_ALLOCATIONS_NAME(__LINE__)(isEnforced)
+#else
+#define MEMORY_ALLOCATION_TRACKER_INSTALL()			((void)0)
+#define MEMORY_ALLOCATION_FRAME()					((void)0)
+#define MEMORY_NO_HEAP_ALLOCATIONS_SCOPE(isEnforced)	((void)0)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		struct AllocationCounters
+		{
+			uint64_t	mAllocationCount;
+			uint64_t	mBytes;
+		};
+
+		struct AllocationCallSite
+		{
+			const void*	mAddress;
+			uint64_t	mAllocationCount;
+			uint64_t	mBytes;
+		};
+
+		class MEMORY_API AllocationTracker
+		{
+		public:
+			static const uint32_t CALL_SITE_BUCKET_COUNT	= 256;
+
+			// Frames before this one may still be warming up caches and pools.
+			static const uint64_t STEADY_STATE_FRAME		= 2;
+
+			// Sets the CRT hook where one is needed. Safe to call more than once.
+			static void					Install();
+
+			// Closes the current frame: its counters become the last frame's.
+			static void					BeginFrame();
+			static uint64_t				GetFrameIndex();
+			static bool					IsSteadyState();
+
+			// Called by the hooks.
+			static void					Record(size_t size, const void* callSite);
+
+			static AllocationCounters	GetFrameCounters();
+			static AllocationCounters	GetLastFrameCounters();
+			static AllocationCounters	GetTotalCounters();
+
+			// Calling thread only: everything since the thread started, and the current frame.
+			static AllocationCounters	GetThreadCounters();
+			static AllocationCounters	GetThreadFrameCounters();
+
+			// Copies up to maxCount used buckets and returns how many are used.
+			static uint32_t				GetCallSites(AllocationCallSite* sites, uint32_t maxCount);
+			static void					ResetCallSites();
+
+			static void					PushNoAllocationScope();
+			static void					PopNoAllocationScope();
+			static uint64_t				GetViolationCount();
+			static const void*			GetLastViolationSite();
+
+		private:
+			AllocationTracker() = delete;
+		};
+
+		class NoHeapAllocationScope
+		{
+		public:
+			NoHeapAllocationScope(bool isEnforced) : mIsEnforced(isEnforced)
+			{
+				if (mIsEnforced)
+				{
+					AllocationTracker::PushNoAllocationScope();
+					mStart = AllocationTracker::GetThreadCounters().mAllocationCount;
+				}
+			}
+
+			~NoHeapAllocationScope()
+			{
+				if (mIsEnforced)
+				{
+					AllocationTracker::PopNoAllocationScope();
+					assert(AllocationTracker::GetThreadCounters().mAllocationCount == mStart);	// Heap allocation in a no allocation scope, see GetLastViolationSite
+				}
+			}
+
+		private:
+			uint64_t	mStart;
+			bool		mIsEnforced;
+
+			NoHeapAllocationScope(NoHeapAllocationScope const&) = delete;
+			void operator=(NoHeapAllocationScope const&) = delete;
+		};
+	}
+}
@@ -1,5 +1,6 @@
 #include "AllocatorUtility.h"
 #include <assert.h>
+#include <stdint.h>
 
 void* AlignedPointer(void* buffer, unsigned int alignment)
 {
@@ -16,4 +17,12 @@ void* AlignedPointer(void* buffer, unsigned int alignment)
 
 	return (void*)alignedPointer;
 }
-	
+
+// Rounds address up to the next multiple of alignment (power of 2).
+// Unlike AlignedPointer it never moves an address that is already aligned
+// and does not store the adjustment.
+void* AlignForward(void* address, size_t alignment)
+{
+	uintptr_t mask = (uintptr_t)(alignment - 1);
+	return (void*)(((uintptr_t)address + mask) & ~mask);
+}
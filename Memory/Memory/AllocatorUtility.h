@@ -2,12 +2,16 @@
 #ifndef ALLOCATOR_UTILITY
 #define ALLOCATOR_UTILITY
 
+#include <stddef.h>
+
 #define EXTERN_C(function) extern "C" { function }
 
 #ifdef __cplusplus
 EXTERN_C(void* AlignedPointer(void* buffer, unsigned int alignment););
+EXTERN_C(void* AlignForward(void* address, size_t alignment););
 #else
 void* AlignedPointer(void* buffer, unsigned int alignment);
+void* AlignForward(void* address, size_t alignment);
 #endif // cplusplus
 
 
@@ -0,0 +1,334 @@
+#include "BuddyAllocator.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+using namespace cliqCity::memory;
+
+static const uint32_t	INVALID_LEAF		= 0xFFFFFFFF;
+static const size_t		HEAP_ALIGNMENT		= 4096;
+
+static uint32_t Log2Floor(size_t value)
+{
+	uint32_t log2 = 0;
+	while (value >>= 1)
+	{
+		log2++;
+	}
+
+	return log2;
+}
+
+static uint32_t Log2Ceil(size_t value)
+{
+	uint32_t log2 = Log2Floor(value);
+	return (((size_t)1 << log2) < value) ? log2 + 1 : log2;
+}
+
+#pragma region BuddyAllocator
+
+BuddyAllocator::BuddyAllocator(size_t size, size_t minBlockSize)
+{
+	assert(size > 0 && minBlockSize > 0);
+
+	uint32_t sizeLog2	= Log2Floor(size);
+	mMinBlockSizeLog2	= Log2Ceil(minBlockSize);
+	mMinBlockSizeLog2	= (mMinBlockSizeLog2 > sizeLog2) ? sizeLog2 : mMinBlockSizeLog2;
+	mLevelCount			= sizeLog2 - mMinBlockSizeLog2 + 1;
+	mSize				= (size_t)1 << sizeLog2;
+	mFreeSize			= mSize;
+
+	assert(mLevelCount <= MAX_LEVEL_COUNT);
+
+	// One allocation for every table: free bits, next, previous, levels.
+	size_t leafCount	= (size_t)1 << (mLevelCount - 1);
+	size_t bitWords		= (2 * leafCount + 31) / 32;
+	mTables		= (uint8_t*)malloc(bitWords * sizeof(uint32_t) + 2 * leafCount * sizeof(uint32_t) + leafCount);
+	mFreeBits	= (uint32_t*)mTables;
+	mNext		= mFreeBits + bitWords;
+	mPrevious	= mNext + leafCount;
+	mLevels		= (uint8_t*)(mPrevious + leafCount);
+
+	memset(mFreeBits, 0, bitWords * sizeof(uint32_t));
+	for (uint32_t i = 0; i < MAX_LEVEL_COUNT; i++)
+	{
+		mHeads[i] = INVALID_LEAF;
+	}
+
+	PushFree(0, 0);
+}
+
+BuddyAllocator::BuddyAllocator()
+{
+	mTables		= nullptr;
+	mFreeBits	= nullptr;
+	mNext		= nullptr;
+	mPrevious	= nullptr;
+	mLevels		= nullptr;
+}
+
+BuddyAllocator::~BuddyAllocator()
+{
+	mTables		= nullptr;
+	mFreeBits	= nullptr;
+	mNext		= nullptr;
+	mPrevious	= nullptr;
+	mLevels		= nullptr;
+}
+
+size_t BuddyAllocator::Allocate(size_t size, size_t alignment)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+
+	// Blocks are aligned to their size, so alignment only matters when it is larger.
+	size_t needed = (size > alignment) ? size : alignment;
+	if (needed == 0 || needed > mSize)
+	{
+		MEMORY_TRACK_FAILURE(this, "BuddyAllocator", size);
+		return INVALID_OFFSET;
+	}
+
+	uint32_t neededLog2	= Log2Ceil(needed);
+	neededLog2			= (neededLog2 < mMinBlockSizeLog2) ? mMinBlockSizeLog2 : neededLog2;
+	uint32_t level		= mLevelCount - 1 - (neededLog2 - mMinBlockSizeLog2);
+
+	// Smallest free block that is large enough.
+	int32_t found = (int32_t)level;
+	while (found >= 0 && mHeads[found] == INVALID_LEAF)
+	{
+		found--;
+	}
+
+	if (found < 0)
+	{
+		// out of memory
+		MEMORY_TRACK_FAILURE(this, "BuddyAllocator", size);
+		return INVALID_OFFSET;
+	}
+
+	uint32_t leaf = mHeads[found];
+	RemoveFree(found, leaf);
+
+	// Split down to the requested level, freeing the upper half each time.
+	for (uint32_t l = found + 1; l <= level; l++)
+	{
+		PushFree(l, leaf + (1u << (mLevelCount - 1 - l)));
+	}
+
+	mLevels[leaf] = (uint8_t)level;
+	mFreeSize -= BlockSize(level);
+
+	MEMORY_TRACK_ALLOCATE(this, "BuddyAllocator", size, BlockSize(level));
+
+	return (size_t)leaf << mMinBlockSizeLog2;
+}
+
+void BuddyAllocator::Free(size_t offset)
+{
+	if (offset == INVALID_OFFSET)
+	{
+		return;
+	}
+
+	uint32_t leaf	= (uint32_t)(offset >> mMinBlockSizeLog2);
+	uint32_t level	= mLevels[leaf];
+
+	assert((offset & (BlockSize(level) - 1)) == 0);
+	assert(!IsInFreeBlock(level, leaf));	// Double free
+
+	mFreeSize += BlockSize(level);
+
+	MEMORY_TRACK_FREE(this, "BuddyAllocator", BlockSize(level));
+
+	// Merge with the buddy for as long as it is free as a whole.
+	while (level > 0)
+	{
+		uint32_t span	= 1u << (mLevelCount - 1 - level);
+		uint32_t buddy	= leaf ^ span;
+		if (!IsFreeNode(NodeIndex(level, buddy)))
+		{
+			break;
+		}
+
+		RemoveFree(level, buddy);
+		leaf &= ~span;
+		level--;
+	}
+
+	PushFree(level, leaf);
+}
+
+void BuddyAllocator::Free()
+{
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mTables != nullptr)
+	{
+		std::free(mTables);
+	}
+
+	mTables		= nullptr;
+	mFreeBits	= nullptr;
+	mNext		= nullptr;
+	mPrevious	= nullptr;
+	mLevels		= nullptr;
+}
+
+size_t BuddyAllocator::GetBlockSize(size_t offset) const
+{
+	return BlockSize(mLevels[offset >> mMinBlockSizeLog2]);
+}
+
+size_t BuddyAllocator::GetSize() const
+{
+	return mSize;
+}
+
+size_t BuddyAllocator::GetFreeSize() const
+{
+	return mFreeSize;
+}
+
+size_t BuddyAllocator::GetLargestFreeBlock() const
+{
+	for (uint32_t level = 0; level < mLevelCount; level++)
+	{
+		if (mHeads[level] != INVALID_LEAF)
+		{
+			return BlockSize(level);
+		}
+	}
+
+	return 0;
+}
+
+size_t BuddyAllocator::BlockSize(uint32_t level) const
+{
+	return mSize >> level;
+}
+
+uint32_t BuddyAllocator::NodeIndex(uint32_t level, uint32_t leaf) const
+{
+	return (1u << level) - 1 + (leaf >> (mLevelCount - 1 - level));
+}
+
+bool BuddyAllocator::IsFreeNode(uint32_t node) const
+{
+	return (mFreeBits[node >> 5] & (1u << (node & 31))) != 0;
+}
+
+bool BuddyAllocator::IsInFreeBlock(uint32_t level, uint32_t leaf) const
+{
+	// A freed block may since have merged into a free ancestor.
+	for (uint32_t l = 0; l <= level; l++)
+	{
+		if (IsFreeNode(NodeIndex(l, leaf)))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BuddyAllocator::SetFreeNode(uint32_t node, bool isFree)
+{
+	if (isFree)
+	{
+		mFreeBits[node >> 5] |= (1u << (node & 31));
+	}
+	else
+	{
+		mFreeBits[node >> 5] &= ~(1u << (node & 31));
+	}
+}
+
+void BuddyAllocator::PushFree(uint32_t level, uint32_t leaf)
+{
+	uint32_t head = mHeads[level];
+
+	mNext[leaf]		= head;
+	mPrevious[leaf]	= INVALID_LEAF;
+	if (head != INVALID_LEAF)
+	{
+		mPrevious[head] = leaf;
+	}
+
+	mHeads[level] = leaf;
+	SetFreeNode(NodeIndex(level, leaf), true);
+}
+
+void BuddyAllocator::RemoveFree(uint32_t level, uint32_t leaf)
+{
+	uint32_t next		= mNext[leaf];
+	uint32_t previous	= mPrevious[leaf];
+
+	if (next != INVALID_LEAF)
+	{
+		mPrevious[next] = previous;
+	}
+
+	if (previous != INVALID_LEAF)
+	{
+		mNext[previous] = next;
+	}
+	else
+	{
+		mHeads[level] = next;
+	}
+
+	SetFreeNode(NodeIndex(level, leaf), false);
+}
+
+#pragma endregion
+
+#pragma region BuddyHeap
+
+BuddyHeap::BuddyHeap(size_t size, size_t minBlockSize) : mBuddy(size, minBlockSize)
+{
+	// Aligning the base lets blocks keep their natural alignment up to HEAP_ALIGNMENT.
+	mMemory	= (uint8_t*)malloc(mBuddy.GetSize() + HEAP_ALIGNMENT);
+	mStart	= (uint8_t*)AlignForward(mMemory, HEAP_ALIGNMENT);
+
+	MEMORY_TRACK_ALIAS(&mBuddy, this);
+}
+
+BuddyHeap::~BuddyHeap()
+{
+	mMemory	= nullptr;
+	mStart	= nullptr;
+}
+
+void* BuddyHeap::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	assert(alignment <= HEAP_ALIGNMENT);
+	assert(offset == 0);
+
+	size_t blockOffset = mBuddy.Allocate(size, alignment);
+	return (blockOffset == BuddyAllocator::INVALID_OFFSET) ? nullptr : mStart + blockOffset;
+}
+
+void BuddyHeap::Free(void* pointer)
+{
+	if (pointer != nullptr)
+	{
+		mBuddy.Free((uint8_t*)pointer - mStart);
+	}
+}
+
+void BuddyHeap::Free()
+{
+	mBuddy.Free();
+
+	if (mMemory != nullptr)
+	{
+		std::free(mMemory);
+	}
+
+	mMemory	= nullptr;
+	mStart	= nullptr;
+}
+
+#pragma endregion
@@ -0,0 +1,102 @@
+// BuddyAllocator
+//
+// Binary buddy allocator over an abstract offset space [0, size). It never
+// touches the memory it manages, so the same allocator can sub-allocate a CPU
+// staging buffer or ranges of a large GPU vertex/index buffer. Blocks are
+// powers of two between the minimum block size and the full size, and every
+// block is aligned to its own size.
+//
+// Bookkeeping lives in side tables: one free bit per node of the implicit
+// binary tree, one free list per level threaded through arrays indexed by
+// leaf, and the level of every allocated block. Allocate splits and Free
+// merges in O(log n).
+//
+// References:	https://en.wikipedia.org/wiki/Buddy_memory_allocation
+//				http://www.gameenginebook.com/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		class MEMORY_API BuddyAllocator
+		{
+		public:
+			static const size_t		INVALID_OFFSET	= ~(size_t)0;
+			static const uint32_t	MAX_LEVEL_COUNT	= 32;
+
+			// size is rounded down and minBlockSize up to powers of two.
+			BuddyAllocator(size_t size, size_t minBlockSize);
+			~BuddyAllocator();
+
+			// Returns the offset of a block of at least size bytes, or INVALID_OFFSET.
+			size_t	Allocate(size_t size, size_t alignment);
+			void	Free(size_t offset);
+
+			// Releases the bookkeeping tables.
+			void	Free();
+
+			size_t	GetBlockSize(size_t offset) const;
+			size_t	GetSize() const;
+			size_t	GetFreeSize() const;
+			size_t	GetLargestFreeBlock() const;
+
+		private:
+			uint8_t*	mTables;
+			uint32_t*	mFreeBits;		// one bit per tree node, set while the node is a free block
+			uint32_t*	mNext;			// free list links, indexed by leaf
+			uint32_t*	mPrevious;
+			uint8_t*	mLevels;		// level of the allocated block starting at each leaf
+			uint32_t	mHeads[MAX_LEVEL_COUNT];
+
+			size_t		mSize;
+			size_t		mFreeSize;
+			uint32_t	mMinBlockSizeLog2;
+			uint32_t	mLevelCount;	// level 0 is the whole range
+
+			size_t		BlockSize(uint32_t level) const;
+			uint32_t	NodeIndex(uint32_t level, uint32_t leaf) const;
+			bool		IsFreeNode(uint32_t node) const;
+			bool		IsInFreeBlock(uint32_t level, uint32_t leaf) const;
+			void		SetFreeNode(uint32_t node, bool isFree);
+			void		PushFree(uint32_t level, uint32_t leaf);
+			void		RemoveFree(uint32_t level, uint32_t leaf);
+
+			BuddyAllocator();
+			BuddyAllocator(BuddyAllocator const&) = delete;
+			void operator=(BuddyAllocator const&) = delete;
+		};
+
+		// BuddyAllocator over an owned block of memory, with the usual pointer interface.
+		// Supports alignments up to 4 KB.
+		class MEMORY_API BuddyHeap
+		{
+		public:
+			BuddyHeap(size_t size, size_t minBlockSize);
+			~BuddyHeap();
+
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+			void	Free(void* pointer);
+			void	Free();
+
+			BuddyAllocator& GetBuddyAllocator() { return mBuddy; };
+
+		private:
+			BuddyAllocator	mBuddy;
+			uint8_t*		mMemory;
+			uint8_t*		mStart;
+
+			BuddyHeap(BuddyHeap const&) = delete;
+			void operator=(BuddyHeap const&) = delete;
+		};
+	}
+}
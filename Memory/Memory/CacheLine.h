@@ -0,0 +1,94 @@
+// CacheLine
+//
+// Placement helpers against false sharing: data written by different threads
+// (per-thread counters, queue heads and tails, work indices) gets a cache line
+// of its own, so one thread's writes do not keep invalidating another's reads.
+//
+// CacheLinePadded<T> is aligned and padded to CACHE_LINE_SIZE. Static and stack
+// instances honor the alignment; operator new before C++17 does not, so heap
+// arrays of them belong in a CacheLineArray, which aligns its storage itself.
+//
+// References:	https://software.intel.com/en-us/articles/avoiding-and-identifying-false-sharing-among-threads
+//				http://en.cppreference.com/w/cpp/thread/hardware_destructive_interference_size
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <cstdlib>
+#include <new>
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		static const size_t CACHE_LINE_SIZE = 64;
+
+		template<class T>
+		struct alignas(CACHE_LINE_SIZE) CacheLinePadded
+		{
+			T mValue;
+
+			T&			operator*() { return mValue; };
+			const T&	operator*() const { return mValue; };
+			T*			operator->() { return &mValue; };
+			const T*	operator->() const { return &mValue; };
+		};
+
+		// Fixed size array with every element on its own cache line(s), e.g. one slot per worker.
+		template<class T>
+		class CacheLineArray
+		{
+		public:
+			CacheLineArray() : mMemory(nullptr), mElements(nullptr), mCount(0) {};
+
+			CacheLineArray(uint32_t count) : mCount(count)
+			{
+				mMemory		= malloc(sizeof(CacheLinePadded<T>) * count + CACHE_LINE_SIZE);
+				// Aligned here rather than with AlignForward: this header compiles into
+				// other modules, and the Memory DLL does not export it.
+				mElements	= (CacheLinePadded<T>*)(((uintptr_t)mMemory + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+
+				for (uint32_t i = 0; i < count; i++)
+				{
+					new (&mElements[i]) CacheLinePadded<T>();
+				}
+			}
+
+			~CacheLineArray()
+			{
+				mMemory		= nullptr;
+				mElements	= nullptr;
+			}
+
+			T&			operator[](uint32_t index) { return mElements[index].mValue; };
+			const T&	operator[](uint32_t index) const { return mElements[index].mValue; };
+
+			uint32_t	GetCount() const { return mCount; };
+
+			void Free()
+			{
+				if (mMemory != nullptr)
+				{
+					for (uint32_t i = 0; i < mCount; i++)
+					{
+						mElements[i].~CacheLinePadded<T>();
+					}
+
+					std::free(mMemory);
+				}
+
+				mMemory		= nullptr;
+				mElements	= nullptr;
+				mCount		= 0;
+			}
+
+		private:
+			void*					mMemory;
+			CacheLinePadded<T>*		mElements;
+			uint32_t				mCount;
+
+			CacheLineArray(CacheLineArray const&) = delete;
+			void operator=(CacheLineArray const&) = delete;
+		};
+	}
+}
@@ -0,0 +1,391 @@
+#include "ConcurrentPoolAllocator.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace cliqCity::memory;
+
+static const uint32_t	INVALID_INDEX	= 0xFFFFFFFF;
+static const uint64_t	INDEX_MASK		= 0x00000000FFFFFFFF;
+
+static_assert(ConcurrentPoolAllocator::MAX_THREADS <= 64, "Thread slots are bits of one 64 bit word");
+
+// Process wide thread slots, a set bit per slot in use. Constant initialized, so
+// pools constructed during static initialization can use them.
+static std::atomic<uint64_t>		gUsedThreadSlots(0);
+
+// Live pools, guarded by a spin lock: taken to register or free a pool and when a thread exits.
+static std::atomic_flag				gPoolsLock = ATOMIC_FLAG_INIT;
+static ConcurrentPoolAllocator*		gPools = nullptr;
+
+static inline uint64_t PackHead(uint64_t head, uint32_t index)
+{
+	return (((head >> 32) + 1) << 32) | index;
+}
+
+static void LockPools()
+{
+	while (gPoolsLock.test_and_set(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+}
+
+static void UnlockPools()
+{
+	gPoolsLock.clear(std::memory_order_release);
+}
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		// The calling thread's slot, returned at thread exit with the magazines it holds.
+		struct ConcurrentPoolThreadSlot
+		{
+			uint32_t mIndex;
+
+			~ConcurrentPoolThreadSlot()
+			{
+				if (mIndex == INVALID_INDEX)
+				{
+					return;
+				}
+
+				LockPools();
+				for (ConcurrentPoolAllocator* pool = gPools; pool != nullptr; pool = pool->mNextPool)
+				{
+					ConcurrentPoolAllocator::Magazine& magazine = pool->mMagazines[mIndex];
+					if (magazine.mCount > 0)
+					{
+						pool->Spill(magazine, magazine.mCount);
+					}
+				}
+				UnlockPools();
+
+				gUsedThreadSlots.fetch_and(~(1ull << mIndex), std::memory_order_release);
+				mIndex = INVALID_INDEX;
+			}
+		};
+	}
+}
+
+static thread_local ConcurrentPoolThreadSlot gThreadSlot = { INVALID_INDEX };
+
+// A free slot, or INVALID_INDEX while every slot is in use.
+static uint32_t AcquireThreadSlot()
+{
+	uint64_t used = gUsedThreadSlots.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		uint32_t index = 0;
+		while (index < ConcurrentPoolAllocator::MAX_THREADS && (used & (1ull << index)) != 0)
+		{
+			index++;
+		}
+
+		if (index == ConcurrentPoolAllocator::MAX_THREADS)
+		{
+			return INVALID_INDEX;
+		}
+
+		if (gUsedThreadSlots.compare_exchange_weak(used, used | (1ull << index), std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			return index;
+		}
+	}
+}
+
+ConcurrentPoolAllocator::ConcurrentPoolAllocator(size_t blockSize, size_t alignment, uint32_t blockCount) :
+	mGlobalHead(INVALID_INDEX),
+	mNextPool(nullptr),
+	mBlockCount(blockCount)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+	assert(blockCount < INVALID_INDEX);
+
+	if (alignment < sizeof(uint32_t))
+	{
+		alignment = sizeof(uint32_t);
+	}
+
+	mBlockSize = (blockSize < sizeof(uint32_t)) ? sizeof(uint32_t) : blockSize;
+	mBlockSize = (mBlockSize + alignment - 1) & ~(alignment - 1);
+
+	// Magazines first, each on its own cache line, then the blocks.
+	size_t magazinesSize = sizeof(Magazine) * MAX_THREADS;
+	mMemory		= (uint8_t*)malloc(CACHE_LINE_SIZE + magazinesSize + alignment + mBlockSize * blockCount);
+	mMagazines	= (Magazine*)AlignForward(mMemory, CACHE_LINE_SIZE);
+	mBlocks		= (uint8_t*)AlignForward((uint8_t*)mMagazines + magazinesSize, alignment);
+
+	for (uint32_t i = 0; i < MAX_THREADS; i++)
+	{
+		mMagazines[i].mHead		= INVALID_INDEX;
+		mMagazines[i].mCount	= 0;
+	}
+
+	if (blockCount > 0)
+	{
+		for (uint32_t i = 0; i < blockCount - 1; i++)
+		{
+			Next(i) = i + 1;
+		}
+
+		Next(blockCount - 1) = INVALID_INDEX;
+		mGlobalHead.store(0, std::memory_order_release);
+	}
+
+	Register();
+}
+
+ConcurrentPoolAllocator::ConcurrentPoolAllocator() : mGlobalHead(INVALID_INDEX), mNextPool(nullptr)
+{
+	mMemory		= nullptr;
+	mBlocks		= nullptr;
+	mMagazines	= nullptr;
+}
+
+ConcurrentPoolAllocator::~ConcurrentPoolAllocator()
+{
+	// Free() releases the memory, as with every allocator here. A pool destroyed
+	// without it still leaves the registry, so exiting threads never flush into it.
+	if (mMemory != nullptr)
+	{
+		Unregister();
+	}
+
+	mMemory		= nullptr;
+	mBlocks		= nullptr;
+	mMagazines	= nullptr;
+}
+
+void* ConcurrentPoolAllocator::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	assert(size <= mBlockSize);
+	assert(alignment <= mBlockSize && (((uintptr_t)mBlocks) & (alignment - 1)) == 0);
+	assert(offset == 0);
+
+	return Allocate();
+}
+
+void* ConcurrentPoolAllocator::Allocate()
+{
+	Magazine* magazine = GetThreadMagazine();
+	if (magazine == nullptr)
+	{
+		uint32_t index = PopGlobal();
+		if (index == INVALID_INDEX)
+		{
+			// out of memory
+			MEMORY_TRACK_FAILURE(this, "ConcurrentPoolAllocator", mBlockSize);
+			return nullptr;
+		}
+
+		MEMORY_TRACK_ALLOCATE(this, "ConcurrentPoolAllocator", mBlockSize, mBlockSize);
+		return BlockAt(index);
+	}
+
+	if (magazine->mCount == 0)
+	{
+		Refill(*magazine);
+
+		if (magazine->mCount == 0)
+		{
+			// out of memory
+			MEMORY_TRACK_FAILURE(this, "ConcurrentPoolAllocator", mBlockSize);
+			return nullptr;
+		}
+	}
+
+	MEMORY_TRACK_ALLOCATE(this, "ConcurrentPoolAllocator", mBlockSize, mBlockSize);
+
+	uint32_t index = magazine->mHead;
+	magazine->mHead = Next(index);
+	magazine->mCount--;
+
+	return BlockAt(index);
+}
+
+void ConcurrentPoolAllocator::Free(void* block)
+{
+	if (block == nullptr)
+	{
+		return;
+	}
+
+	MEMORY_TRACK_FREE(this, "ConcurrentPoolAllocator", mBlockSize);
+
+	uint32_t index = IndexOf(block);
+
+	Magazine* magazine = GetThreadMagazine();
+	if (magazine == nullptr)
+	{
+		PushGlobal(index, index);
+		return;
+	}
+
+	if (magazine->mCount == MAGAZINE_SIZE)
+	{
+		Spill(*magazine, MAGAZINE_SIZE / 2);
+	}
+
+	Next(index) = magazine->mHead;
+	magazine->mHead = index;
+	magazine->mCount++;
+}
+
+void ConcurrentPoolAllocator::FlushThreadCache()
+{
+	Magazine* magazine = GetThreadMagazine();
+	if (magazine != nullptr && magazine->mCount > 0)
+	{
+		Spill(*magazine, magazine->mCount);
+	}
+}
+
+void ConcurrentPoolAllocator::Free()
+{
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mMemory != nullptr)
+	{
+		Unregister();
+		std::free(mMemory);
+	}
+
+	mMemory		= nullptr;
+	mBlocks		= nullptr;
+	mMagazines	= nullptr;
+	mBlockCount	= 0;
+	mGlobalHead.store(INVALID_INDEX, std::memory_order_relaxed);
+}
+
+size_t ConcurrentPoolAllocator::GetBlockSize() const
+{
+	return mBlockSize;
+}
+
+uint32_t ConcurrentPoolAllocator::GetBlockCount() const
+{
+	return mBlockCount;
+}
+
+uint32_t& ConcurrentPoolAllocator::Next(uint32_t index) const
+{
+	return *(uint32_t*)(mBlocks + index * mBlockSize);
+}
+
+uint32_t ConcurrentPoolAllocator::IndexOf(void* block) const
+{
+	assert((uint8_t*)block >= mBlocks && (uint8_t*)block < mBlocks + mBlockSize * mBlockCount);
+	return (uint32_t)(((uint8_t*)block - mBlocks) / mBlockSize);
+}
+
+void* ConcurrentPoolAllocator::BlockAt(uint32_t index) const
+{
+	return mBlocks + index * mBlockSize;
+}
+
+uint32_t ConcurrentPoolAllocator::PopGlobal()
+{
+	uint64_t head = mGlobalHead.load(std::memory_order_acquire);
+	for (;;)
+	{
+		uint32_t index = (uint32_t)(head & INDEX_MASK);
+		if (index == INVALID_INDEX)
+		{
+			return INVALID_INDEX;
+		}
+
+		// The block may already be owned by another thread, in which case the
+		// value read here is garbage, but the tag makes the CAS below fail.
+		uint32_t next = Next(index);
+		if (mGlobalHead.compare_exchange_weak(head, PackHead(head, next), std::memory_order_acquire, std::memory_order_acquire))
+		{
+			return index;
+		}
+	}
+}
+
+void ConcurrentPoolAllocator::PushGlobal(uint32_t first, uint32_t last)
+{
+	uint64_t head = mGlobalHead.load(std::memory_order_relaxed);
+	do
+	{
+		Next(last) = (uint32_t)(head & INDEX_MASK);
+	} while (!mGlobalHead.compare_exchange_weak(head, PackHead(head, first), std::memory_order_release, std::memory_order_relaxed));
+}
+
+void ConcurrentPoolAllocator::Refill(Magazine& magazine)
+{
+	for (uint32_t i = 0; i < MAGAZINE_SIZE / 2; i++)
+	{
+		uint32_t index = PopGlobal();
+		if (index == INVALID_INDEX)
+		{
+			break;
+		}
+
+		Next(index) = magazine.mHead;
+		magazine.mHead = index;
+		magazine.mCount++;
+	}
+}
+
+void ConcurrentPoolAllocator::Spill(Magazine& magazine, uint32_t count)
+{
+	assert(count > 0 && count <= magazine.mCount);
+
+	// The magazine is already a linked chain, so detach its first count blocks
+	// and publish them with a single CAS.
+	uint32_t first	= magazine.mHead;
+	uint32_t last	= first;
+	for (uint32_t i = 1; i < count; i++)
+	{
+		last = Next(last);
+	}
+
+	magazine.mHead = Next(last);
+	magazine.mCount -= count;
+
+	PushGlobal(first, last);
+}
+
+ConcurrentPoolAllocator::Magazine* ConcurrentPoolAllocator::GetThreadMagazine() const
+{
+	if (gThreadSlot.mIndex == INVALID_INDEX)
+	{
+		gThreadSlot.mIndex = AcquireThreadSlot();
+	}
+
+	return (gThreadSlot.mIndex != INVALID_INDEX) ? &mMagazines[gThreadSlot.mIndex] : nullptr;
+}
+
+void ConcurrentPoolAllocator::Register()
+{
+	LockPools();
+	mNextPool	= gPools;
+	gPools		= this;
+	UnlockPools();
+}
+
+void ConcurrentPoolAllocator::Unregister()
+{
+	LockPools();
+	ConcurrentPoolAllocator** link = &gPools;
+	while (*link != nullptr && *link != this)
+	{
+		link = &(*link)->mNextPool;
+	}
+
+	if (*link == this)
+	{
+		*link = mNextPool;
+	}
+	UnlockPools();
+
+	mNextPool = nullptr;
+}
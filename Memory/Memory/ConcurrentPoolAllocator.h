@@ -0,0 +1,100 @@
+// ConcurrentPoolAllocator
+//
+// Thread safe fixed size block allocator. Each thread owns a small magazine of
+// free blocks that it pops and pushes without synchronization. Magazines refill
+// from, and spill half of their blocks back to, a lock free global free list.
+// A block freed on a thread other than the one that allocated it simply lands
+// in the freeing thread's magazine and travels back to the global list in a
+// batch, with a single CAS for the whole chain.
+//
+// The global list head packs a 32 bit block index and a 32 bit tag into one
+// 64 bit word. The tag is bumped on every successful CAS, which prevents ABA.
+//
+// A thread takes a magazine slot on its first allocation or free and gives it
+// back when it exits, after returning its magazine in every live pool to the
+// global list, so slots are reused and no blocks are stranded.
+//
+// References:	http://www.boost.org/doc/libs/1_60_0/doc/html/lockfree.html
+//				https://www.usenix.org/legacy/event/usenix01/full_papers/bonwick/bonwick.pdf
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		class MEMORY_API ConcurrentPoolAllocator
+		{
+		public:
+			static const uint32_t CACHE_LINE_SIZE	= 64;
+			static const uint32_t MAGAZINE_SIZE		= 64;
+			static const uint32_t MAX_THREADS		= 64;
+
+			// All blocks are allocated up front. While MAX_THREADS threads hold slots, others bypass the magazines.
+			ConcurrentPoolAllocator(size_t blockSize, size_t alignment, uint32_t blockCount);
+			~ConcurrentPoolAllocator();
+
+			// size and alignment must fit the block, offset must be 0. Matches RIG_NEW.
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+			void*	Allocate();
+			void	Free(void* block);
+
+			// Returns the calling thread's magazine to the global list. Done at thread exit too.
+			void	FlushThreadCache();
+
+			// Releases the blocks. No thread may be using the pool.
+			void	Free();
+
+			size_t		GetBlockSize() const;
+			uint32_t	GetBlockCount() const;
+
+		private:
+			// Free blocks store the index of the next free block in their first 4 bytes.
+			struct Magazine
+			{
+				uint32_t mHead;
+				uint32_t mCount;
+				uint8_t	 mPadding[CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+			};
+
+			std::atomic<uint64_t>	mGlobalHead;
+			uint8_t					mPadding[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+
+			ConcurrentPoolAllocator*	mNextPool;	// Live pools, flushed by exiting threads
+
+			uint8_t*	mMemory;
+			uint8_t*	mBlocks;
+			Magazine*	mMagazines;
+			size_t		mBlockSize;
+			uint32_t	mBlockCount;
+
+			uint32_t&	Next(uint32_t index) const;
+			uint32_t	IndexOf(void* block) const;
+			void*		BlockAt(uint32_t index) const;
+
+			uint32_t	PopGlobal();
+			void		PushGlobal(uint32_t first, uint32_t last);
+			void		Refill(Magazine& magazine);
+			void		Spill(Magazine& magazine, uint32_t count);
+			Magazine*	GetThreadMagazine() const;
+
+			void		Register();
+			void		Unregister();
+
+			ConcurrentPoolAllocator();
+			ConcurrentPoolAllocator(ConcurrentPoolAllocator const&) = delete;
+			void operator=(ConcurrentPoolAllocator const&) = delete;
+
+			friend struct ConcurrentPoolThreadSlot;
+		};
+	}
+}
@@ -0,0 +1,68 @@
+#include "FrameAllocator.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <cstdlib>
+
+using namespace cliqCity::memory;
+
+FrameAllocator::FrameAllocator(size_t sizePerFrame, uint32_t frameCount) : mFrameCount(frameCount), mFrameIndex(0)
+{
+	assert(frameCount > 0 && frameCount <= MAX_FRAME_COUNT);
+
+	// One block for every frame. The frames borrow their slices and never free them.
+	mMemory = (uint8_t*)malloc(sizePerFrame * frameCount);
+
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		uint8_t* start = mMemory + sizePerFrame * i;
+		mFrames[i] = LinearAllocator(start, start + sizePerFrame);
+		MEMORY_TRACK_ALIAS(&mFrames[i], this);
+	}
+}
+
+FrameAllocator::FrameAllocator()
+{
+	mMemory = nullptr;
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	mMemory = nullptr;
+}
+
+void* FrameAllocator::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	return mFrames[mFrameIndex].Allocate(size, alignment, offset);
+}
+
+void FrameAllocator::BeginFrame()
+{
+	mFrameIndex = (mFrameIndex + 1) % mFrameCount;
+	mFrames[mFrameIndex].Rewind();
+}
+
+void FrameAllocator::Free()
+{
+	for (uint32_t i = 0; i < mFrameCount; i++)
+	{
+		MEMORY_TRACK_RETIRE(&mFrames[i]);
+	}
+
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mMemory != nullptr) {
+		std::free(mMemory);
+	}
+
+	mMemory = nullptr;
+}
+
+uint32_t FrameAllocator::GetFrameIndex() const
+{
+	return mFrameIndex;
+}
+
+uint32_t FrameAllocator::GetFrameCount() const
+{
+	return mFrameCount;
+}
@@ -0,0 +1,52 @@
+// FrameAllocator
+//
+// N linear buffers used round robin, one per frame in flight. BeginFrame moves
+// to the oldest buffer and rewinds it without clearing, so a pointer returned
+// during frame F stays valid until BeginFrame has been called N more times.
+//
+// References:	http://www.gameenginebook.com/
+
+#pragma once
+#include <stddef.h>
+#include "LinearAllocator.h"
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		class MEMORY_API FrameAllocator
+		{
+		public:
+			static const uint32_t MAX_FRAME_COUNT		= 3;
+			static const uint32_t DEFAULT_FRAME_COUNT	= 2;
+
+			FrameAllocator(size_t sizePerFrame, uint32_t frameCount);
+			~FrameAllocator();
+
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+
+			// Retires the oldest frame and makes its buffer current.
+			void	BeginFrame();
+			void	Free();
+
+			uint32_t	GetFrameIndex() const;
+			uint32_t	GetFrameCount() const;
+
+		private:
+			LinearAllocator	mFrames[MAX_FRAME_COUNT];
+			uint8_t*		mMemory;
+			uint32_t		mFrameCount;
+			uint32_t		mFrameIndex;
+
+			FrameAllocator();
+			FrameAllocator(FrameAllocator const&) = delete;
+			void operator=(FrameAllocator const&) = delete;
+		};
+	}
+}
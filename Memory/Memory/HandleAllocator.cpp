@@ -0,0 +1,326 @@
+#include "HandleAllocator.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+using namespace cliqCity::memory;
+
+static const uint32_t	INVALID_SLOT		= 0xFFFFFFFF;
+static const uint32_t	NO_HOLE				= 0xFFFFFFFF;
+static const uint32_t	BLOCK_ALIGNMENT		= 8;
+static const uint32_t	INDEX_MASK			= (1 << HandleAllocator::INDEX_BITS) - 1;
+static const uint32_t	GENERATION_MASK		= (1 << (32 - HandleAllocator::INDEX_BITS)) - 1;
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		// Precedes every block in the region, so a pass can walk blocks in address order.
+		struct HandleBlock
+		{
+			uint32_t	mSlot;		// INVALID_SLOT for a hole
+			uint32_t	mSize;		// whole block, header and padding included
+		};
+
+		struct HandleSlot
+		{
+			uint32_t	mBlock;		// next free slot while the slot is unused
+			uint32_t	mOffset;
+			uint32_t	mSize;
+			uint16_t	mGeneration;
+			uint16_t	mAlignment;
+		};
+	}
+}
+
+static inline uint32_t AlignUp(uint32_t value, uint32_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+HandleAllocator::HandleAllocator(size_t size, uint32_t maxHandleCount)
+{
+	assert(size <= 0xFFFFFFFF - MAX_ALIGNMENT);
+	assert(maxHandleCount > 0 && maxHandleCount <= MAX_HANDLE_COUNT);
+
+	// The region is aligned to MAX_ALIGNMENT, so aligned offsets are aligned addresses.
+	mMemory			= (uint8_t*)malloc(size + MAX_ALIGNMENT);
+	mStart			= (uint8_t*)AlignForward(mMemory, MAX_ALIGNMENT);
+	mCapacity		= (uint32_t)size & ~(BLOCK_ALIGNMENT - 1);
+	mTop			= 0;
+	mUsedSize		= 0;
+	mFirstHole		= NO_HOLE;
+	mPacked			= 0;
+	mScan			= 0;
+	mIsCompacting	= false;
+
+	mSlots			= (HandleSlot*)malloc(sizeof(HandleSlot) * maxHandleCount);
+	mSlotCount		= maxHandleCount;
+	mHandleCount	= 0;
+	mFreeSlot		= 0;
+
+	for (uint32_t i = 0; i < maxHandleCount; i++)
+	{
+		mSlots[i].mBlock		= (i + 1 < maxHandleCount) ? i + 1 : INVALID_SLOT;
+		mSlots[i].mGeneration	= 1;
+	}
+}
+
+HandleAllocator::HandleAllocator()
+{
+	mMemory	= nullptr;
+	mStart	= nullptr;
+	mSlots	= nullptr;
+}
+
+HandleAllocator::~HandleAllocator()
+{
+	mMemory	= nullptr;
+	mStart	= nullptr;
+	mSlots	= nullptr;
+}
+
+Handle HandleAllocator::Allocate(size_t size, size_t alignment)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+	assert(alignment <= MAX_ALIGNMENT);
+
+	alignment = (alignment < BLOCK_ALIGNMENT) ? BLOCK_ALIGNMENT : alignment;
+
+	if (mFreeSlot == INVALID_SLOT || size > mCapacity)
+	{
+		MEMORY_TRACK_FAILURE(this, "HandleAllocator", size);
+		return INVALID_HANDLE;
+	}
+
+	if (!Fits(size, alignment))
+	{
+		// Only worth a full compaction if the holes could make room.
+		if (mCapacity - mUsedSize < size + sizeof(HandleBlock))
+		{
+			// out of memory
+			MEMORY_TRACK_FAILURE(this, "HandleAllocator", size);
+			return INVALID_HANDLE;
+		}
+
+		Defragment((size_t)-1);
+		if (!Fits(size, alignment))
+		{
+			// out of memory
+			MEMORY_TRACK_FAILURE(this, "HandleAllocator", size);
+			return INVALID_HANDLE;
+		}
+	}
+
+	uint32_t index		= mFreeSlot;
+	HandleSlot& slot	= mSlots[index];
+	mFreeSlot			= slot.mBlock;
+
+	uint32_t block		= mTop;
+	uint32_t offset		= AlignUp(block + sizeof(HandleBlock), (uint32_t)alignment);
+	uint32_t end		= AlignUp(offset + (uint32_t)size, BLOCK_ALIGNMENT);
+
+	HandleBlock* header	= (HandleBlock*)(mStart + block);
+	header->mSlot		= index;
+	header->mSize		= end - block;
+
+	slot.mBlock			= block;
+	slot.mOffset		= offset;
+	slot.mSize			= (uint32_t)size;
+	slot.mAlignment		= (uint16_t)alignment;
+
+	mTop		= end;
+	mUsedSize	+= end - block;
+	mHandleCount++;
+
+	MEMORY_TRACK_ALLOCATE(this, "HandleAllocator", size, end - block);
+
+	return ((Handle)slot.mGeneration << INDEX_BITS) | index;
+}
+
+void HandleAllocator::Free(Handle handle)
+{
+	HandleSlot* slot = Resolve(handle);
+	assert(handle == INVALID_HANDLE || slot != nullptr);	// Double free or stale handle
+
+	if (slot == nullptr)
+	{
+		return;
+	}
+
+	uint32_t block		= slot->mBlock;
+	HandleBlock* header	= (HandleBlock*)(mStart + block);
+	header->mSlot		= INVALID_SLOT;
+	mUsedSize			-= header->mSize;
+
+	MEMORY_TRACK_FREE(this, "HandleAllocator", header->mSize);
+
+	if (block + header->mSize == mTop && (!mIsCompacting || block >= mScan))
+	{
+		// Top block: give the space straight back.
+		mTop = block;
+		if (mIsCompacting && mTop == mScan)
+		{
+			FinishPass();
+		}
+	}
+	else if (!mIsCompacting || block < mPacked)
+	{
+		// Holes at or above mScan are swept up by the pass in progress.
+		mFirstHole = (block < mFirstHole) ? block : mFirstHole;
+	}
+
+	// A new generation makes every copy of the handle stale.
+	uint16_t generation	= (uint16_t)((slot->mGeneration + 1) & GENERATION_MASK);
+	slot->mGeneration	= (generation == 0) ? 1 : generation;
+	slot->mBlock		= mFreeSlot;
+	mFreeSlot			= handle & INDEX_MASK;
+	mHandleCount--;
+}
+
+void HandleAllocator::Free()
+{
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mMemory != nullptr)
+	{
+		std::free(mMemory);
+	}
+
+	if (mSlots != nullptr)
+	{
+		std::free(mSlots);
+	}
+
+	mMemory	= nullptr;
+	mStart	= nullptr;
+	mSlots	= nullptr;
+}
+
+void* HandleAllocator::Get(Handle handle) const
+{
+	HandleSlot* slot = Resolve(handle);
+	return (slot) ? mStart + slot->mOffset : nullptr;
+}
+
+bool HandleAllocator::IsValid(Handle handle) const
+{
+	return Resolve(handle) != nullptr;
+}
+
+size_t HandleAllocator::GetSize(Handle handle) const
+{
+	HandleSlot* slot = Resolve(handle);
+	return (slot) ? slot->mSize : 0;
+}
+
+size_t HandleAllocator::Defragment(size_t maxBytes)
+{
+	size_t moved = 0;
+	while (moved < maxBytes)
+	{
+		if (!mIsCompacting)
+		{
+			if (mFirstHole >= mTop)
+			{
+				break;
+			}
+
+			mPacked			= mFirstHole;
+			mScan			= mFirstHole;
+			mFirstHole		= NO_HOLE;
+			mIsCompacting	= true;
+		}
+
+		while (mScan < mTop && moved < maxBytes)
+		{
+			// The move below may overwrite this header, so read it first.
+			HandleBlock* header	= (HandleBlock*)(mStart + mScan);
+			uint32_t index		= header->mSlot;
+			uint32_t blockSize	= header->mSize;
+
+			if (index != INVALID_SLOT)
+			{
+				// Moving down never needs more padding, so the block cannot grow past its old end.
+				HandleSlot& slot	= mSlots[index];
+				uint32_t offset		= AlignUp(mPacked + sizeof(HandleBlock), slot.mAlignment);
+				uint32_t end		= AlignUp(offset + slot.mSize, BLOCK_ALIGNMENT);
+
+				memmove(mStart + offset, mStart + slot.mOffset, slot.mSize);
+
+				HandleBlock* packed	= (HandleBlock*)(mStart + mPacked);
+				packed->mSlot		= index;
+				packed->mSize		= end - mPacked;
+
+				mUsedSize		= mUsedSize - blockSize + packed->mSize;
+				slot.mBlock		= mPacked;
+				slot.mOffset	= offset;
+				mPacked			= end;
+				moved			+= slot.mSize;
+			}
+
+			mScan += blockSize;
+		}
+
+		if (mScan == mTop)
+		{
+			FinishPass();
+		}
+		else if (mPacked < mScan)
+		{
+			// Keep the region walkable: the gap left behind is one hole.
+			HandleBlock* gap	= (HandleBlock*)(mStart + mPacked);
+			gap->mSlot			= INVALID_SLOT;
+			gap->mSize			= mScan - mPacked;
+		}
+	}
+
+	return moved;
+}
+
+size_t HandleAllocator::GetUsedSize() const
+{
+	return mUsedSize;
+}
+
+size_t HandleAllocator::GetFragmentedSize() const
+{
+	return mTop - mUsedSize;
+}
+
+size_t HandleAllocator::GetCapacity() const
+{
+	return mCapacity;
+}
+
+uint32_t HandleAllocator::GetHandleCount() const
+{
+	return mHandleCount;
+}
+
+HandleSlot* HandleAllocator::Resolve(Handle handle) const
+{
+	// Live generations are never 0, so INVALID_HANDLE never resolves.
+	uint32_t index = handle & INDEX_MASK;
+	if (index >= mSlotCount || mSlots[index].mGeneration != (handle >> INDEX_BITS))
+	{
+		return nullptr;
+	}
+
+	return &mSlots[index];
+}
+
+bool HandleAllocator::Fits(size_t size, size_t alignment) const
+{
+	size_t offset = AlignUp(mTop + sizeof(HandleBlock), (uint32_t)alignment);
+	return offset + size <= mCapacity;
+}
+
+void HandleAllocator::FinishPass()
+{
+	mTop			= mPacked;
+	mIsCompacting	= false;
+	mFirstHole		= (mFirstHole >= mTop) ? NO_HOLE : mFirstHole;
+}
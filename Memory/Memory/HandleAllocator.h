@@ -0,0 +1,99 @@
+// HandleAllocator
+//
+// Relocatable allocator for long lived, streamed data. Clients hold 32-bit
+// handles (slot index + generation) instead of pointers, which lets the
+// allocator slide live blocks down over holes and so undo fragmentation. A
+// stale handle has an old generation and is detected with one compare.
+//
+// Blocks are bump allocated from the top of a single region. Defragment does a
+// bounded amount of that compaction per call (e.g. once per frame) and picks up
+// where it left off, so no frame pays for a full pass.
+//
+// Pointers returned by Get are only valid until the next Allocate or
+// Defragment; store handles, resolve them when needed. Blocks are moved with
+// memmove, so only trivially relocatable data belongs here.
+//
+// References:	http://bitsquid.blogspot.com/2011/09/managing-decoupling-part-4-id-lookup.html
+//				http://gamesfromwithin.com/managing-data-relationships
+//				https://en.wikipedia.org/wiki/Mark-compact_algorithm
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		typedef uint32_t Handle;
+
+		struct HandleSlot;
+
+		class MEMORY_API HandleAllocator
+		{
+		public:
+			static const Handle		INVALID_HANDLE		= 0;
+			static const uint32_t	INDEX_BITS			= 20;
+			static const uint32_t	MAX_HANDLE_COUNT	= (1 << INDEX_BITS) - 1;
+			static const size_t		MAX_ALIGNMENT		= 64;
+
+			HandleAllocator(size_t size, uint32_t maxHandleCount);
+			~HandleAllocator();
+
+			// Compacts completely before giving up when the top of the region is full.
+			Handle	Allocate(size_t size, size_t alignment);
+			void	Free(Handle handle);
+
+			// Releases the region and the handle table.
+			void	Free();
+
+			// Returns nullptr for a freed (stale) handle.
+			void*	Get(Handle handle) const;
+			bool	IsValid(Handle handle) const;
+			size_t	GetSize(Handle handle) const;
+
+			template<class T>
+			T*		Get(Handle handle) const { return (T*)Get(handle); };
+
+			// Moves at most roughly maxBytes of live data and returns the bytes moved.
+			size_t	Defragment(size_t maxBytes);
+
+			size_t	GetUsedSize() const;
+			size_t	GetFragmentedSize() const;	// bytes in holes below the top
+			size_t	GetCapacity() const;
+			uint32_t GetHandleCount() const;
+
+		private:
+			uint8_t*	mMemory;
+			uint8_t*	mStart;
+			HandleSlot*	mSlots;
+			uint32_t	mFreeSlot;
+			uint32_t	mSlotCount;
+			uint32_t	mHandleCount;
+
+			uint32_t	mCapacity;
+			uint32_t	mTop;
+			uint32_t	mUsedSize;
+			uint32_t	mFirstHole;		// lowest hole the current pass will not reach
+
+			// Compaction pass: blocks below mPacked are packed, [mPacked, mScan) is one hole.
+			uint32_t	mPacked;
+			uint32_t	mScan;
+			bool		mIsCompacting;
+
+			HandleSlot*	Resolve(Handle handle) const;
+			bool		Fits(size_t size, size_t alignment) const;
+			void		FinishPass();
+
+			HandleAllocator();
+			HandleAllocator(HandleAllocator const&) = delete;
+			void operator=(HandleAllocator const&) = delete;
+		};
+	}
+}
@@ -1,5 +1,6 @@
 #include "LinearAllocator.h"
 #include "AllocatorUtility.h"
+#include "MemoryStats.h"
 #include <assert.h>
 #include <cstdlib>
 #include <cstring>
@@ -38,28 +39,38 @@ void* LinearAllocator::Allocate(size_t size, size_t alignment, size_t offset)
 	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
 
 	// offset pointer first, align it, and offset it back
-	mCurrent = (uint8_t*)AlignedPointer((void*)(mCurrent + offset), alignment) - offset;
+	uint8_t* userPtr = (uint8_t*)AlignForward(mCurrent + offset, alignment) - offset;
 
-	void* userPtr = mCurrent;
-	mCurrent += size + alignment + offset;
-
-	if (mCurrent >= mEnd)
+	if (userPtr + size > mEnd)
 	{
 		// out of memory
+		MEMORY_TRACK_FAILURE(this, "LinearAllocator", size);
 		return nullptr;
 	}
 
+	MEMORY_TRACK_ALLOCATE(this, "LinearAllocator", size, userPtr + size - mCurrent);
+
+	mCurrent = userPtr + size;
 	return userPtr;
 }
 
 void LinearAllocator::Reset()
 {
+	MEMORY_TRACK_RELEASE(this, "LinearAllocator", mCurrent - mStart);
 	std::memset(mStart, 0, (mEnd - mStart) * sizeof(uint8_t));
 	mCurrent = mStart;
 }
 
+void LinearAllocator::Rewind()
+{
+	MEMORY_TRACK_RELEASE(this, "LinearAllocator", mCurrent - mStart);
+	mCurrent = mStart;
+}
+
 void LinearAllocator::Free()
 {
+	MEMORY_TRACK_RETIRE(this);
+
 	if (mIsOwner && mStart != nullptr) {
 		std::free(mStart);
 	}
@@ -25,6 +25,7 @@ namespace cliqCity
 
 			void*	Allocate(size_t size, size_t alignment, size_t offset);
 			void	Reset();
+			void	Rewind();	// Reset without clearing memory
 			void    Free();
 
 		private:
@@ -34,6 +35,8 @@ namespace cliqCity
 			bool     mIsOwner;
 
 			LinearAllocator();
+
+			friend class FrameAllocator;
 		};
 	}
 }
\ No newline at end of file
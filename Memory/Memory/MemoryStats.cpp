@@ -0,0 +1,433 @@
+#include "MemoryStats.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+
+using namespace cliqCity::memory;
+
+namespace
+{
+	struct StatsEntry
+	{
+		std::atomic<const void*>	mAllocator;		// nullptr while unused
+		std::atomic<StatsEntry*>	mOwner;			// set for aliases
+		std::atomic<const char*>	mTag;
+		std::atomic<const char*>	mSubsystem;
+		std::atomic<const char*>	mType;
+		std::atomic<uint64_t>		mAllocationCount;
+		std::atomic<uint64_t>		mFreeCount;
+		std::atomic<uint64_t>		mReleaseCount;
+		std::atomic<uint64_t>		mFailedCount;
+		std::atomic<uint64_t>		mRequestedBytes;
+		std::atomic<uint64_t>		mWastedBytes;
+		std::atomic<uint64_t>		mLiveBytes;
+		std::atomic<uint64_t>		mPeakBytes;
+		std::atomic<bool>			mIsRetired;
+	};
+
+	// Zero initialized static storage; entries are claimed by address. Retired
+	// entries stay for reports until a new allocator needs the slot.
+	StatsEntry	gEntries[MemoryStats::MAX_ENTRY_COUNT];
+	StatsEntry	gOverflow;
+
+	// gOverflow collects records once the table is full of live allocators.
+	const char*	OVERFLOW_TAG	= "overflow";
+
+	StatsEntry* Resolve(StatsEntry& entry, const char* type)
+	{
+		// Entries claimed by SetTag learn their type from the first record.
+		if (type != nullptr && entry.mType.load(std::memory_order_relaxed) == nullptr)
+		{
+			entry.mType.store(type, std::memory_order_relaxed);
+		}
+
+		StatsEntry* owner = entry.mOwner.load(std::memory_order_relaxed);
+		return (owner) ? owner : &entry;
+	}
+
+	// Hands a retired entry to allocator, starting it over. Clearing mIsRetired is
+	// the claim, so two allocators can't both take it.
+	bool Reclaim(StatsEntry* entry, const void* allocator)
+	{
+		bool isRetired = true;
+		if (entry == nullptr || !entry->mIsRetired.compare_exchange_strong(isRetired, false, std::memory_order_acq_rel))
+		{
+			return false;
+		}
+
+		entry->mOwner.store(nullptr, std::memory_order_relaxed);
+		entry->mTag.store(nullptr, std::memory_order_relaxed);
+		entry->mSubsystem.store(nullptr, std::memory_order_relaxed);
+		entry->mType.store(nullptr, std::memory_order_relaxed);
+		entry->mAllocationCount.store(0, std::memory_order_relaxed);
+		entry->mFreeCount.store(0, std::memory_order_relaxed);
+		entry->mReleaseCount.store(0, std::memory_order_relaxed);
+		entry->mFailedCount.store(0, std::memory_order_relaxed);
+		entry->mRequestedBytes.store(0, std::memory_order_relaxed);
+		entry->mWastedBytes.store(0, std::memory_order_relaxed);
+		entry->mLiveBytes.store(0, std::memory_order_relaxed);
+		entry->mPeakBytes.store(0, std::memory_order_relaxed);
+		entry->mAllocator.store(allocator, std::memory_order_release);
+		return true;
+	}
+
+	// A new allocator takes, in order: the retired entry of an earlier allocator at
+	// its address, a free slot, any retired entry. Only then does it overflow.
+	StatsEntry* FindEntry(const void* allocator, const char* type)
+	{
+		uint32_t mask	= MemoryStats::MAX_ENTRY_COUNT - 1;
+		uint32_t index	= (uint32_t)(((uintptr_t)allocator >> 4) * 2654435761u) & mask;
+
+		StatsEntry* sameRetired	= nullptr;
+		StatsEntry* anyRetired	= nullptr;
+
+		for (uint32_t probe = 0; probe < MemoryStats::MAX_ENTRY_COUNT; probe++)
+		{
+			StatsEntry& entry	= gEntries[(index + probe) & mask];
+			const void* key		= entry.mAllocator.load(std::memory_order_acquire);
+
+			if (key == nullptr)
+			{
+				if (Reclaim(sameRetired, allocator))
+				{
+					return Resolve(*sameRetired, type);
+				}
+
+				// Claim it; losing to the same allocator on another thread is as good.
+				entry.mAllocator.compare_exchange_strong(key, allocator, std::memory_order_acq_rel);
+				key = (key == nullptr) ? allocator : key;
+			}
+
+			bool isRetired = entry.mIsRetired.load(std::memory_order_relaxed);
+			if (key == allocator && !isRetired)
+			{
+				return Resolve(entry, type);
+			}
+
+			if (isRetired)
+			{
+				sameRetired	= (key == allocator && sameRetired == nullptr) ? &entry : sameRetired;
+				anyRetired	= (anyRetired == nullptr) ? &entry : anyRetired;
+			}
+		}
+
+		if (Reclaim(sameRetired, allocator))
+		{
+			return Resolve(*sameRetired, type);
+		}
+
+		if (Reclaim(anyRetired, allocator))
+		{
+			return Resolve(*anyRetired, type);
+		}
+
+		gOverflow.mTag.store(OVERFLOW_TAG, std::memory_order_relaxed);
+		return &gOverflow;
+	}
+
+	bool IsEmpty(const StatsEntry& entry)
+	{
+		return entry.mAllocationCount.load(std::memory_order_relaxed) == 0 &&
+			entry.mFreeCount.load(std::memory_order_relaxed) == 0 &&
+			entry.mReleaseCount.load(std::memory_order_relaxed) == 0 &&
+			entry.mFailedCount.load(std::memory_order_relaxed) == 0 &&
+			entry.mLiveBytes.load(std::memory_order_relaxed) == 0 &&
+			entry.mPeakBytes.load(std::memory_order_relaxed) == 0;
+	}
+
+	void AddLive(StatsEntry* entry, uint64_t bytes)
+	{
+		uint64_t live = entry->mLiveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+		uint64_t peak = entry->mPeakBytes.load(std::memory_order_relaxed);
+		while (live > peak && !entry->mPeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void SubtractLive(StatsEntry* entry, uint64_t bytes)
+	{
+		entry->mLiveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+	}
+
+	bool IsReported(const StatsEntry& entry)
+	{
+		return entry.mAllocator.load(std::memory_order_acquire) != nullptr && entry.mOwner.load(std::memory_order_relaxed) == nullptr;
+	}
+
+	void CopyEntry(const StatsEntry& entry, MemoryTagStats* stats)
+	{
+		stats->mTag					= entry.mTag.load(std::memory_order_relaxed);
+		stats->mSubsystem			= entry.mSubsystem.load(std::memory_order_relaxed);
+		stats->mType				= entry.mType.load(std::memory_order_relaxed);
+		stats->mAllocationCount		= entry.mAllocationCount.load(std::memory_order_relaxed);
+		stats->mFreeCount			= entry.mFreeCount.load(std::memory_order_relaxed);
+		stats->mReleaseCount		= entry.mReleaseCount.load(std::memory_order_relaxed);
+		stats->mFailedCount			= entry.mFailedCount.load(std::memory_order_relaxed);
+		stats->mRequestedBytes		= entry.mRequestedBytes.load(std::memory_order_relaxed);
+		stats->mWastedBytes			= entry.mWastedBytes.load(std::memory_order_relaxed);
+		stats->mLiveBytes			= entry.mLiveBytes.load(std::memory_order_relaxed);
+		stats->mPeakBytes			= entry.mPeakBytes.load(std::memory_order_relaxed);
+		stats->mIsRetired			= entry.mIsRetired.load(std::memory_order_relaxed);
+
+		// Untagged allocators go by their type.
+		stats->mType		= (stats->mType) ? stats->mType : "unknown";
+		stats->mTag			= (stats->mTag) ? stats->mTag : stats->mType;
+		stats->mSubsystem	= (stats->mSubsystem) ? stats->mSubsystem : "";
+	}
+
+	void Accumulate(MemoryTagStats* total, const MemoryTagStats& stats)
+	{
+		total->mAllocationCount	+= stats.mAllocationCount;
+		total->mFreeCount		+= stats.mFreeCount;
+		total->mReleaseCount	+= stats.mReleaseCount;
+		total->mFailedCount		+= stats.mFailedCount;
+		total->mRequestedBytes	+= stats.mRequestedBytes;
+		total->mWastedBytes		+= stats.mWastedBytes;
+		total->mLiveBytes		+= stats.mLiveBytes;
+		total->mPeakBytes		+= stats.mPeakBytes;	// upper bound: instance peaks need not coincide
+	}
+
+	// snprintf that keeps counting past the end of the buffer.
+	void Append(char* buffer, size_t size, size_t* length, const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		int written = vsnprintf((*length < size) ? buffer + *length : nullptr, (*length < size) ? size - *length : 0, format, args);
+		va_end(args);
+
+		*length += (written > 0) ? written : 0;
+	}
+
+	void AppendString(char* buffer, size_t size, size_t* length, const char* string)
+	{
+		Append(buffer, size, length, "\"");
+		for (const char* c = string; *c; c++)
+		{
+			Append(buffer, size, length, (*c == '"' || *c == '\\') ? "\\%c" : "%c", *c);
+		}
+		Append(buffer, size, length, "\"");
+	}
+
+	void AppendStats(char* buffer, size_t size, size_t* length, const MemoryTagStats& stats)
+	{
+		double averageWaste = (stats.mAllocationCount) ? (double)stats.mWastedBytes / stats.mAllocationCount : 0.0;
+
+		Append(buffer, size, length,
+			"\"allocations\": %llu, \"frees\": %llu, \"releases\": %llu, \"failed\": %llu, "
+			"\"requestedBytes\": %llu, \"wastedBytes\": %llu, \"averageWaste\": %.2f, \"liveBytes\": %llu, \"peakBytes\": %llu",
+			(unsigned long long)stats.mAllocationCount, (unsigned long long)stats.mFreeCount,
+			(unsigned long long)stats.mReleaseCount, (unsigned long long)stats.mFailedCount,
+			(unsigned long long)stats.mRequestedBytes, (unsigned long long)stats.mWastedBytes, averageWaste,
+			(unsigned long long)stats.mLiveBytes, (unsigned long long)stats.mPeakBytes);
+	}
+
+	// Writes one JSON array of stats summed over entries with the same tag (or subsystem).
+	void AppendGroups(char* buffer, size_t size, size_t* length, const MemoryTagStats* stats, uint32_t count, bool bySubsystem)
+	{
+		const char* key = (bySubsystem) ? "subsystem" : "tag";
+		bool isFirst	= true;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const char* name = (bySubsystem) ? stats[i].mSubsystem : stats[i].mTag;
+
+			// Only the first entry of each group writes it.
+			bool isWritten = false;
+			for (uint32_t j = 0; j < i && !isWritten; j++)
+			{
+				isWritten = strcmp(name, (bySubsystem) ? stats[j].mSubsystem : stats[j].mTag) == 0;
+			}
+
+			if (isWritten)
+			{
+				continue;
+			}
+
+			MemoryTagStats total;
+			memset(&total, 0, sizeof(MemoryTagStats));
+			for (uint32_t j = i; j < count; j++)
+			{
+				if (strcmp(name, (bySubsystem) ? stats[j].mSubsystem : stats[j].mTag) == 0)
+				{
+					Accumulate(&total, stats[j]);
+				}
+			}
+
+			Append(buffer, size, length, "%s\n\t\t{ \"%s\": ", (isFirst) ? "" : ",", key);
+			AppendString(buffer, size, length, name);
+			Append(buffer, size, length, ", ");
+			AppendStats(buffer, size, length, total);
+			Append(buffer, size, length, " }");
+			isFirst = false;
+		}
+	}
+}
+
+void MemoryStats::SetTag(const void* allocator, const char* tag, const char* subsystem)
+{
+	StatsEntry* entry = FindEntry(allocator, nullptr);
+	entry->mTag.store(tag, std::memory_order_relaxed);
+	entry->mSubsystem.store(subsystem, std::memory_order_relaxed);
+}
+
+void MemoryStats::SetAlias(const void* allocator, const void* owner)
+{
+	StatsEntry* ownerEntry = FindEntry(owner, nullptr);
+
+	// FindEntry follows aliases, so claim the alias entry before marking it.
+	StatsEntry* entry = FindEntry(allocator, nullptr);
+	if (entry != ownerEntry && entry != &gOverflow)
+	{
+		entry->mOwner.store(ownerEntry, std::memory_order_relaxed);
+	}
+}
+
+void MemoryStats::RecordAllocate(const void* allocator, const char* type, size_t requested, size_t consumed)
+{
+	StatsEntry* entry = FindEntry(allocator, type);
+	entry->mAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	entry->mRequestedBytes.fetch_add(requested, std::memory_order_relaxed);
+	entry->mWastedBytes.fetch_add((consumed > requested) ? consumed - requested : 0, std::memory_order_relaxed);
+	AddLive(entry, consumed);
+}
+
+void MemoryStats::RecordFailure(const void* allocator, const char* type, size_t)
+{
+	FindEntry(allocator, type)->mFailedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryStats::RecordFree(const void* allocator, const char* type, size_t consumed)
+{
+	StatsEntry* entry = FindEntry(allocator, type);
+	entry->mFreeCount.fetch_add(1, std::memory_order_relaxed);
+	SubtractLive(entry, consumed);
+}
+
+void MemoryStats::RecordRelease(const void* allocator, const char* type, size_t consumed)
+{
+	StatsEntry* entry = FindEntry(allocator, type);
+	entry->mReleaseCount.fetch_add(1, std::memory_order_relaxed);
+	SubtractLive(entry, consumed);
+}
+
+void MemoryStats::Retire(const void* allocator)
+{
+	uint32_t mask	= MAX_ENTRY_COUNT - 1;
+	uint32_t index	= (uint32_t)(((uintptr_t)allocator >> 4) * 2654435761u) & mask;
+
+	for (uint32_t probe = 0; probe < MAX_ENTRY_COUNT; probe++)
+	{
+		StatsEntry& entry	= gEntries[(index + probe) & mask];
+		const void* key		= entry.mAllocator.load(std::memory_order_acquire);
+
+		if (key == nullptr)
+		{
+			return;
+		}
+
+		if (key == allocator && !entry.mIsRetired.load(std::memory_order_relaxed))
+		{
+			entry.mIsRetired.store(true, std::memory_order_relaxed);
+			return;
+		}
+	}
+}
+
+uint32_t MemoryStats::GetSnapshot(MemoryTagStats* stats, uint32_t maxCount)
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < MAX_ENTRY_COUNT; i++)
+	{
+		if (IsReported(gEntries[i]))
+		{
+			if (count < maxCount)
+			{
+				CopyEntry(gEntries[i], &stats[count]);
+			}
+
+			count++;
+		}
+	}
+
+	if (!IsEmpty(gOverflow))
+	{
+		if (count < maxCount)
+		{
+			CopyEntry(gOverflow, &stats[count]);
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
+size_t MemoryStats::WriteJSON(char* buffer, size_t size)
+{
+	MemoryTagStats stats[MAX_ENTRY_COUNT + 1];
+	uint32_t count = GetSnapshot(stats, MAX_ENTRY_COUNT + 1);
+
+	size_t length = 0;
+	Append(buffer, size, &length, "{\n\t\"allocators\": [");
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Append(buffer, size, &length, "%s\n\t\t{ \"tag\": ", (i == 0) ? "" : ",");
+		AppendString(buffer, size, &length, stats[i].mTag);
+		Append(buffer, size, &length, ", \"subsystem\": ");
+		AppendString(buffer, size, &length, stats[i].mSubsystem);
+		Append(buffer, size, &length, ", \"type\": ");
+		AppendString(buffer, size, &length, stats[i].mType);
+		Append(buffer, size, &length, ", \"retired\": %s, ", (stats[i].mIsRetired) ? "true" : "false");
+		AppendStats(buffer, size, &length, stats[i]);
+		Append(buffer, size, &length, " }");
+	}
+
+	Append(buffer, size, &length, "\n\t],\n\t\"tags\": [");
+	AppendGroups(buffer, size, &length, stats, count, false);
+	Append(buffer, size, &length, "\n\t],\n\t\"subsystems\": [");
+	AppendGroups(buffer, size, &length, stats, count, true);
+	Append(buffer, size, &length, "\n\t]\n}\n");
+
+	return length;
+}
+
+bool MemoryStats::WriteJSON(const char* filename)
+{
+	size_t size		= WriteJSON((char*)nullptr, 0) + 1;
+	char* buffer	= new char[size];
+	WriteJSON(buffer, size);
+
+	FILE* file = nullptr;
+#ifdef _MSC_VER
+	fopen_s(&file, filename, "w");
+#else
+	file = fopen(filename, "w");
+#endif
+
+	bool isWritten = false;
+	if (file != nullptr)
+	{
+		isWritten = fputs(buffer, file) >= 0;
+		fclose(file);
+	}
+
+	delete[] buffer;
+	return isWritten;
+}
+
+void MemoryStats::Reset()
+{
+	// Live bytes stay: the allocations they count are still out there.
+	for (uint32_t i = 0; i <= MAX_ENTRY_COUNT; i++)
+	{
+		StatsEntry& entry = (i < MAX_ENTRY_COUNT) ? gEntries[i] : gOverflow;
+		entry.mAllocationCount.store(0, std::memory_order_relaxed);
+		entry.mFreeCount.store(0, std::memory_order_relaxed);
+		entry.mReleaseCount.store(0, std::memory_order_relaxed);
+		entry.mFailedCount.store(0, std::memory_order_relaxed);
+		entry.mRequestedBytes.store(0, std::memory_order_relaxed);
+		entry.mWastedBytes.store(0, std::memory_order_relaxed);
+		entry.mPeakBytes.store(entry.mLiveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,101 @@
+// MemoryStats
+//
+// Opt-in accounting for the Memory allocators, for sizing arenas and pools from
+// measurements. Define MEMORY_INSTRUMENTATION when building Memory (and any
+// project using MEMORY_TAG) to turn it on; without it every hook below expands
+// to nothing, so the allocators compile exactly as before.
+//
+// Each allocator instance is an entry keyed by its address. It is named after
+// its type until MEMORY_TAG gives it a tag and a subsystem. Entries count
+// allocations, frees, bulk releases (Reset, FreeToMarker, ...), failures,
+// requested bytes, live and peak bytes, and wasted bytes: what an allocation
+// consumed beyond the request (alignment padding, block rounding). Snapshots and
+// the JSON dump report every entry and aggregate by tag and by subsystem.
+//
+// Counters are atomics, so hot multithreaded allocators stay correct when
+// instrumented. Tag and subsystem strings must outlive the stats (use literals).
+//
+// References:	http://www.gamasutra.com/view/feature/132399/monitoring_your_pcs_memory_usage_.php
+//				https://www.gdcvault.com/play/1012262/Memory-Management-in
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+#ifdef MEMORY_INSTRUMENTATION
+#define MEMORY_TAG(allocator, tag, subsystem)							cliqCity::memory::MemoryStats::SetTag(allocator, tag, subsystem)
+#define MEMORY_TRACK_ALIAS(allocator, owner)							cliqCity::memory::MemoryStats::SetAlias(allocator, owner)
+#define MEMORY_TRACK_ALLOCATE(allocator, type, requested, consumed)		cliqCity::memory::MemoryStats::RecordAllocate(allocator, type, requested, consumed)
+#define MEMORY_TRACK_FAILURE(allocator, type, requested)				cliqCity::memory::MemoryStats::RecordFailure(allocator, type, requested)
+#define MEMORY_TRACK_FREE(allocator, type, consumed)					cliqCity::memory::MemoryStats::RecordFree(allocator, type, consumed)
+#define MEMORY_TRACK_RELEASE(allocator, type, consumed)					cliqCity::memory::MemoryStats::RecordRelease(allocator, type, consumed)
+#define MEMORY_TRACK_RETIRE(allocator)									cliqCity::memory::MemoryStats::Retire(allocator)
+#else
+#define MEMORY_TAG(allocator, tag, subsystem)							((void)0)
+#define MEMORY_TRACK_ALIAS(allocator, owner)							((void)0)
+#define MEMORY_TRACK_ALLOCATE(allocator, type, requested, consumed)		((void)0)
+#define MEMORY_TRACK_FAILURE(allocator, type, requested)				((void)0)
+#define MEMORY_TRACK_FREE(allocator, type, consumed)					((void)0)
+#define MEMORY_TRACK_RELEASE(allocator, type, consumed)					((void)0)
+#define MEMORY_TRACK_RETIRE(allocator)									((void)0)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		struct MemoryTagStats
+		{
+			const char*	mTag;
+			const char*	mSubsystem;
+			const char*	mType;
+			uint64_t	mAllocationCount;
+			uint64_t	mFreeCount;
+			uint64_t	mReleaseCount;
+			uint64_t	mFailedCount;
+			uint64_t	mRequestedBytes;
+			uint64_t	mWastedBytes;
+			uint64_t	mLiveBytes;
+			uint64_t	mPeakBytes;
+			bool		mIsRetired;
+		};
+
+		class MEMORY_API MemoryStats
+		{
+		public:
+			static const uint32_t MAX_ENTRY_COUNT = 256;
+
+			static void		SetTag(const void* allocator, const char* tag, const char* subsystem);
+
+			// Records for allocator go to owner's entry (e.g. the frames of a FrameAllocator).
+			static void		SetAlias(const void* allocator, const void* owner);
+
+			static void		RecordAllocate(const void* allocator, const char* type, size_t requested, size_t consumed);
+			static void		RecordFailure(const void* allocator, const char* type, size_t requested);
+			static void		RecordFree(const void* allocator, const char* type, size_t consumed);
+			static void		RecordRelease(const void* allocator, const char* type, size_t consumed);
+
+			// Keeps the entry for reports until a new allocator needs its slot; one at the
+			// same address starts over in it.
+			static void		Retire(const void* allocator);
+
+			// Copies up to maxCount entries and returns how many exist.
+			static uint32_t	GetSnapshot(MemoryTagStats* stats, uint32_t maxCount);
+
+			// Like snprintf: returns the full length, writes at most size - 1 characters.
+			static size_t	WriteJSON(char* buffer, size_t size);
+			static bool		WriteJSON(const char* filename);
+
+			static void		Reset();
+
+		private:
+			MemoryStats() = delete;
+		};
+	}
+}
@@ -0,0 +1,132 @@
+#include "Numa.h"
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace cliqCity::memory;
+
+#if defined(__linux__)
+// From linux/mempolicy.h, spelled out to avoid depending on libnuma's headers.
+static const int MEMORY_POLICY_DEFAULT		= 0;
+static const int MEMORY_POLICY_PREFERRED	= 1;
+
+static const size_t NODE_MASK_BITS			= 8 * sizeof(unsigned long);
+static const size_t NODE_MASK_WORDS			= Numa::MAX_NODE_COUNT / NODE_MASK_BITS;
+
+static uint32_t ReadNodeCount()
+{
+	// "0", "0-1", ... : the highest possible node, plus one.
+	FILE* file = fopen("/sys/devices/system/node/possible", "r");
+	if (file == nullptr)
+	{
+		return 1;
+	}
+
+	uint32_t first = 0, last = 0;
+	int fields = fscanf(file, "%u-%u", &first, &last);
+	fclose(file);
+
+	uint32_t count = ((fields == 2) ? last : first) + 1;
+	return (fields >= 1 && count <= Numa::MAX_NODE_COUNT) ? count : 1;
+}
+
+static long SetNodeMask(unsigned long* mask, uint32_t node)
+{
+	for (size_t i = 0; i < NODE_MASK_WORDS; i++)
+	{
+		mask[i] = 0;
+	}
+
+	mask[node / NODE_MASK_BITS] = 1ul << (node % NODE_MASK_BITS);
+
+	// The kernel reads maxnode - 1 bits.
+	return Numa::MAX_NODE_COUNT + 1;
+}
+#endif
+
+uint32_t Numa::GetNodeCount()
+{
+	static std::atomic<uint32_t> sNodeCount(0);
+
+	uint32_t count = sNodeCount.load(std::memory_order_relaxed);
+	if (count == 0)
+	{
+#ifdef _WIN32
+		ULONG highest = 0;
+		count = (GetNumaHighestNodeNumber(&highest) && highest < MAX_NODE_COUNT) ? (uint32_t)highest + 1 : 1;
+#elif defined(__linux__)
+		count = ReadNodeCount();
+#else
+		count = 1;
+#endif
+		sNodeCount.store(count, std::memory_order_relaxed);
+	}
+
+	return count;
+}
+
+uint32_t Numa::GetCurrentNode()
+{
+#ifdef _WIN32
+	PROCESSOR_NUMBER processor;
+	GetCurrentProcessorNumberEx(&processor);
+
+	USHORT node = 0;
+	return GetNumaProcessorNodeEx(&processor, &node) ? (uint32_t)node : 0;
+#elif defined(__linux__)
+	unsigned int cpu = 0, node = 0;
+	return (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 && node < MAX_NODE_COUNT) ? node : 0;
+#else
+	return 0;
+#endif
+}
+
+bool Numa::BindMemory(void* start, size_t size, uint32_t node)
+{
+#if defined(__linux__)
+	if (node >= GetNodeCount() || GetNodeCount() == 1)
+	{
+		return false;
+	}
+
+	unsigned long mask[NODE_MASK_WORDS];
+	long maxNode = SetNodeMask(mask, node);
+
+	// Preferred, not bound: a bound range that runs out of node memory faults with
+	// SIGBUS/OOM instead of spilling to another node.
+	return syscall(SYS_mbind, start, size, MEMORY_POLICY_PREFERRED, mask, maxNode, 0) == 0;
+#else
+	(void)start;
+	(void)size;
+	(void)node;
+	return false;
+#endif
+}
+
+bool Numa::SetThreadPreferredNode(uint32_t node)
+{
+#if defined(__linux__)
+	if (node == NUMA_NODE_ANY)
+	{
+		return syscall(SYS_set_mempolicy, MEMORY_POLICY_DEFAULT, nullptr, 0) == 0;
+	}
+
+	if (node >= GetNodeCount())
+	{
+		return false;
+	}
+
+	unsigned long mask[NODE_MASK_WORDS];
+	long maxNode = SetNodeMask(mask, node);
+	return syscall(SYS_set_mempolicy, MEMORY_POLICY_PREFERRED, mask, maxNode) == 0;
+#else
+	(void)node;
+	return false;
+#endif
+}
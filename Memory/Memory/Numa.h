@@ -0,0 +1,54 @@
+// Numa
+//
+// Node queries and memory placement for multi-socket machines. Memory on a
+// remote node costs a trip over the socket interconnect on every miss, so bulk
+// data processed by a worker should live on that worker's node.
+//
+// Linux places ranges with mbind and sets thread policies with set_mempolicy,
+// called through syscall so libnuma is not needed. Windows has no rebinding:
+// placement is chosen when pages are committed (VirtualAllocExNuma, see
+// VirtualArena's node constructor), so BindMemory and SetThreadPreferredNode
+// return false there. Machines without NUMA report a single node 0.
+//
+// References:	http://man7.org/linux/man-pages/man2/mbind.2.html
+//				http://man7.org/linux/man-pages/man2/set_mempolicy.2.html
+//				https://msdn.microsoft.com/en-us/library/windows/desktop/aa965223(v=vs.85).aspx
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		static const uint32_t NUMA_NODE_ANY = 0xFFFFFFFF;
+
+		class MEMORY_API Numa
+		{
+		public:
+			static const uint32_t MAX_NODE_COUNT = 64;
+
+			static uint32_t	GetNodeCount();
+
+			// Node of the processor the calling thread runs on right now (threads can migrate).
+			static uint32_t	GetCurrentNode();
+
+			// Pages of [start, start + size) faulted in from now on come from node while it
+			// has free memory, then from any node. start must be page aligned.
+			static bool		BindMemory(void* start, size_t size, uint32_t node);
+
+			// Preferred node for the calling thread's future page faults; NUMA_NODE_ANY restores the default.
+			static bool		SetThreadPreferredNode(uint32_t node);
+
+		private:
+			Numa() = delete;
+		};
+	}
+}
@@ -0,0 +1,77 @@
+#include "NumaArena.h"
+#include <assert.h>
+
+using namespace cliqCity::memory;
+
+NumaArena::NumaArena(size_t reserveSizePerNode, size_t commitSize) : mNodes(Numa::GetNodeCount())
+{
+	uint32_t nodeCount = mNodes.GetCount();
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		// A single node needs no binding.
+		uint32_t node		= (nodeCount > 1) ? i : NUMA_NODE_ANY;
+		mNodes[i].mArena	= new (mNodes[i].mArenaStorage) VirtualArena(reserveSizePerNode, commitSize, VIRTUAL_ARENA_PAGES_DEFAULT, node);
+	}
+}
+
+NumaArena::NumaArena(size_t reserveSizePerNode) : NumaArena(reserveSizePerNode, VirtualArena::DEFAULT_COMMIT_SIZE)
+{
+
+}
+
+NumaArena::NumaArena()
+{
+
+}
+
+NumaArena::~NumaArena()
+{
+
+}
+
+void* NumaArena::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	uint32_t node = Numa::GetCurrentNode();
+	return AllocateOnNode((node < mNodes.GetCount()) ? node : 0, size, alignment, offset);
+}
+
+void* NumaArena::AllocateOnNode(uint32_t node, size_t size, size_t alignment, size_t offset)
+{
+	assert(node < mNodes.GetCount());
+
+	NodeArena& nodeArena = mNodes[node];
+	std::lock_guard<std::mutex> lock(nodeArena.mMutex);
+	return nodeArena.mArena->Allocate(size, alignment, offset);
+}
+
+void NumaArena::Reset()
+{
+	for (uint32_t i = 0; i < mNodes.GetCount(); i++)
+	{
+		std::lock_guard<std::mutex> lock(mNodes[i].mMutex);
+		mNodes[i].mArena->Reset();
+	}
+}
+
+void NumaArena::Free()
+{
+	for (uint32_t i = 0; i < mNodes.GetCount(); i++)
+	{
+		mNodes[i].mArena->Free();
+		mNodes[i].mArena->~VirtualArena();
+		mNodes[i].mArena = nullptr;
+	}
+
+	mNodes.Free();
+}
+
+uint32_t NumaArena::GetNodeCount() const
+{
+	return mNodes.GetCount();
+}
+
+VirtualArena& NumaArena::GetArena(uint32_t node)
+{
+	assert(node < mNodes.GetCount());
+	return *mNodes[node].mArena;
+}
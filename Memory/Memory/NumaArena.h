@@ -0,0 +1,67 @@
+// NumaArena
+//
+// One VirtualArena per NUMA node. Allocate serves the calling thread from the
+// arena of the node it is running on, so a worker's bulk data (mesh processing
+// buffers, math batches) ends up in its local memory. AllocateOnNode places
+// data for a known consumer instead.
+//
+// Each node's arena sits behind its own lock on its own cache line; this is
+// meant for bulk blocks, not for many small objects (see SmallObjectAllocator).
+// On a machine without NUMA it is a locked VirtualArena.
+//
+// References:	https://www.kernel.org/doc/html/latest/vm/numa.html
+//				https://msdn.microsoft.com/en-us/library/windows/desktop/aa363804(v=vs.85).aspx
+
+#pragma once
+#include "VirtualArena.h"
+#include "CacheLine.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+#pragma warning (disable: 4251)
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		class MEMORY_API NumaArena
+		{
+		public:
+			NumaArena(size_t reserveSizePerNode, size_t commitSize);
+			NumaArena(size_t reserveSizePerNode);
+			~NumaArena();
+
+			// From the calling thread's current node.
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+			void*	AllocateOnNode(uint32_t node, size_t size, size_t alignment, size_t offset);
+
+			// Rewinds every node. No thread may be allocating.
+			void	Reset();
+			void	Free();
+
+			uint32_t		GetNodeCount() const;
+			VirtualArena&	GetArena(uint32_t node);
+
+		private:
+			struct NodeArena
+			{
+				std::mutex		mMutex;
+				VirtualArena*	mArena;
+				alignas(VirtualArena) uint8_t mArenaStorage[sizeof(VirtualArena)];
+			};
+
+			CacheLineArray<NodeArena> mNodes;
+
+			NumaArena();
+			NumaArena(NumaArena const&) = delete;
+			void operator=(NumaArena const&) = delete;
+		};
+	}
+}
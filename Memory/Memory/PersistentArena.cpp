@@ -0,0 +1,314 @@
+#include "PersistentArena.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace cliqCity::memory;
+
+static const uint32_t	PERSISTENT_ARENA_MAGIC	= 0x414E5250;	// "PRNA"
+static const intptr_t	INVALID_FILE			= -1;
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		// Lives in the first HEADER_SIZE bytes of the file.
+		struct PersistentArenaHeader
+		{
+			uint32_t	mMagic;
+			uint32_t	mVersion;
+			uint64_t	mUsedSize;		// header included
+			uint64_t	mRootOffset;	// from the start of the file, 0 for no root
+			uint32_t	mPointerSize;
+			uint32_t	mReserved;
+		};
+	}
+}
+
+static_assert(sizeof(PersistentArenaHeader) <= PersistentArena::HEADER_SIZE, "Header does not fit");
+
+PersistentArena::PersistentArena(const char* filename, size_t capacity) : PersistentArena()
+{
+	assert(capacity > HEADER_SIZE);
+
+	mIsReadOnly = false;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)capacity >> 32), (DWORD)capacity, nullptr);
+	void* address = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity) : nullptr;
+	if (address == nullptr)
+	{
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+
+		CloseHandle(file);
+		return;
+	}
+
+	mFile		= (intptr_t)file;
+	mMapping	= (intptr_t)mapping;
+#else
+	int file = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0)
+	{
+		return;
+	}
+
+	void* address = (ftruncate(file, (off_t)capacity) == 0) ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+	if (address == MAP_FAILED)
+	{
+		close(file);
+		return;
+	}
+
+	mFile = file;
+#endif
+
+	mStart		= (uint8_t*)address;
+	mCurrent	= mStart + HEADER_SIZE;
+	mEnd		= mStart + capacity;
+
+	PersistentArenaHeader* header = (PersistentArenaHeader*)mStart;
+	memset(header, 0, HEADER_SIZE);
+	header->mMagic			= PERSISTENT_ARENA_MAGIC;
+	header->mVersion		= VERSION;
+	header->mPointerSize	= sizeof(void*);
+}
+
+PersistentArena::PersistentArena(const char* filename) : PersistentArena()
+{
+	mIsReadOnly = true;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= (LONGLONG)HEADER_SIZE)
+		? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+		: nullptr;
+	void* address = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (address == nullptr)
+	{
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+
+		CloseHandle(file);
+		return;
+	}
+
+	size_t size	= (size_t)fileSize.QuadPart;
+	mFile		= (intptr_t)file;
+	mMapping	= (intptr_t)mapping;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+	{
+		return;
+	}
+
+	struct stat status;
+	void* address = (fstat(file, &status) == 0 && status.st_size >= (off_t)HEADER_SIZE)
+		? mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, file, 0)
+		: MAP_FAILED;
+	if (address == MAP_FAILED)
+	{
+		close(file);
+		return;
+	}
+
+	size_t size	= (size_t)status.st_size;
+	mFile		= file;
+#endif
+
+	mStart		= (uint8_t*)address;
+	mEnd		= mStart + size;
+
+	const PersistentArenaHeader* header = (const PersistentArenaHeader*)mStart;
+	if (header->mMagic != PERSISTENT_ARENA_MAGIC || header->mVersion != VERSION || header->mPointerSize != sizeof(void*) ||
+		header->mUsedSize < HEADER_SIZE || header->mUsedSize > size || header->mRootOffset >= header->mUsedSize)
+	{
+		// Not an arena, or not one this build can read.
+		Close(0);
+		return;
+	}
+
+	mCurrent = mStart + header->mUsedSize;
+}
+
+PersistentArena::PersistentArena()
+{
+	mStart		= nullptr;
+	mCurrent	= nullptr;
+	mEnd		= nullptr;
+	mFile		= INVALID_FILE;
+	mMapping	= 0;
+	mIsReadOnly	= true;
+}
+
+PersistentArena::~PersistentArena()
+{
+	mStart		= nullptr;
+	mCurrent	= nullptr;
+	mEnd		= nullptr;
+}
+
+void* PersistentArena::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+
+	if (mIsReadOnly || mStart == nullptr)
+	{
+		return nullptr;
+	}
+
+	// offset pointer first, align it, and offset it back
+	uint8_t* userPtr = (uint8_t*)AlignForward(mCurrent + offset, alignment) - offset;
+
+	if (userPtr > mEnd || size > (size_t)(mEnd - userPtr))
+	{
+		// out of memory
+		MEMORY_TRACK_FAILURE(this, "PersistentArena", size);
+		return nullptr;
+	}
+
+	MEMORY_TRACK_ALLOCATE(this, "PersistentArena", size, userPtr + size - mCurrent);
+
+	mCurrent = userPtr + size;
+	return userPtr;
+}
+
+void PersistentArena::SetRoot(const void* root)
+{
+	assert(!mIsReadOnly && mStart != nullptr);
+	assert(root == nullptr || ((const uint8_t*)root >= mStart + HEADER_SIZE && (const uint8_t*)root < mCurrent));
+
+	((PersistentArenaHeader*)mStart)->mRootOffset = (root != nullptr) ? (const uint8_t*)root - mStart : 0;
+}
+
+void* PersistentArena::GetRoot() const
+{
+	if (mStart == nullptr)
+	{
+		return nullptr;
+	}
+
+	uint64_t rootOffset = ((const PersistentArenaHeader*)mStart)->mRootOffset;
+	return (rootOffset != 0) ? mStart + rootOffset : nullptr;
+}
+
+bool PersistentArena::Save()
+{
+	if (mIsReadOnly || mStart == nullptr)
+	{
+		return false;
+	}
+
+	((PersistentArenaHeader*)mStart)->mUsedSize = mCurrent - mStart;
+
+#ifdef _WIN32
+	return FlushViewOfFile(mStart, mCurrent - mStart) && FlushFileBuffers((HANDLE)mFile);
+#else
+	return msync(mStart, mCurrent - mStart, MS_SYNC) == 0;
+#endif
+}
+
+void PersistentArena::Free()
+{
+	if (mStart == nullptr)
+	{
+		return;
+	}
+
+	MEMORY_TRACK_RETIRE(this);
+
+	size_t usedSize = 0;
+	if (!mIsReadOnly)
+	{
+		Save();
+		usedSize = mCurrent - mStart;
+	}
+
+	Close(usedSize);
+}
+
+void* PersistentArena::GetStart() const
+{
+	return mStart;
+}
+
+bool PersistentArena::IsReadOnly() const
+{
+	return mIsReadOnly;
+}
+
+size_t PersistentArena::GetUsedSize() const
+{
+	return mCurrent - mStart;
+}
+
+size_t PersistentArena::GetCapacity() const
+{
+	return mEnd - mStart;
+}
+
+void PersistentArena::Close(size_t fileSize)
+{
+	// fileSize is where to trim a writable file; 0 leaves it as it is.
+#ifdef _WIN32
+	UnmapViewOfFile(mStart);
+	CloseHandle((HANDLE)mMapping);
+
+	if (fileSize > 0)
+	{
+		LARGE_INTEGER position;
+		position.QuadPart = (LONGLONG)fileSize;
+		if (SetFilePointerEx((HANDLE)mFile, position, nullptr, FILE_BEGIN))
+		{
+			SetEndOfFile((HANDLE)mFile);
+		}
+	}
+
+	CloseHandle((HANDLE)mFile);
+#else
+	munmap(mStart, mEnd - mStart);
+
+	if (fileSize > 0)
+	{
+		// A failed trim only leaves unused capacity on disk.
+		int result = ftruncate((int)mFile, (off_t)fileSize);
+		(void)result;
+	}
+
+	close((int)mFile);
+#endif
+
+	mStart		= nullptr;
+	mCurrent	= nullptr;
+	mEnd		= nullptr;
+	mFile		= INVALID_FILE;
+	mMapping	= 0;
+}
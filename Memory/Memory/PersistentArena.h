@@ -0,0 +1,121 @@
+// PersistentArena
+//
+// Linear allocator over a memory mapped file, for data that is baked once and
+// mapped on the next launch instead of being rebuilt (meshes, curve LUTs,
+// lookup tables). Data in the arena must not hold raw pointers: link it with
+// OffsetPtr, which stores the distance to its target and so stays valid
+// wherever the file is mapped. SetRoot marks the object a reader starts from.
+//
+// The writing constructor creates (or truncates) the file at full capacity and
+// maps it read-write; the capacity cannot grow. Free saves, unmaps and trims the
+// file to what was used. The reading constructor maps an existing file
+// read-only, checks its header, and is ready without any parsing; Allocate
+// returns nullptr on it. Either constructor leaves GetStart() == nullptr when
+// the file cannot be opened or is not a valid arena.
+//
+// Files are not portable across endianness or pointer width, and the layout of
+// the stored types is the caller's contract: keep a version in the root object
+// and check it after opening.
+//
+// References:	https://msdn.microsoft.com/en-us/library/windows/desktop/aa366556(v=vs.85).aspx
+//				http://man7.org/linux/man-pages/man2/mmap.2.html
+//				http://www.boost.org/doc/libs/1_60_0/doc/html/interprocess/offset_ptr.html
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		// Self-relative pointer. 0 is null, which is fine since one never points at itself.
+		template<class T>
+		class OffsetPtr
+		{
+		public:
+			OffsetPtr() : mOffset(0) {};
+			OffsetPtr(T* pointer) { Set(pointer); };
+			OffsetPtr(const OffsetPtr& other) { Set(other.Get()); };
+
+			OffsetPtr& operator=(const OffsetPtr& other) { Set(other.Get()); return *this; };
+			OffsetPtr& operator=(T* pointer) { Set(pointer); return *this; };
+
+			T* Get() const { return (mOffset != 0) ? (T*)((const uint8_t*)this + mOffset) : nullptr; };
+
+			T* operator->() const { return Get(); };
+			T& operator*() const { return *Get(); };
+			T& operator[](size_t index) const { return Get()[index]; };
+			explicit operator bool() const { return mOffset != 0; };
+
+		private:
+			int64_t mOffset;
+
+			void Set(T* pointer) { mOffset = (pointer != nullptr) ? (const uint8_t*)pointer - (const uint8_t*)this : 0; };
+		};
+
+		template<class T>
+		struct OffsetArray
+		{
+			OffsetPtr<T>	mData;
+			uint64_t		mCount;
+
+			T& operator[](size_t index) const { return mData[index]; };
+		};
+
+		class MEMORY_API PersistentArena
+		{
+		public:
+			static const uint32_t VERSION		= 1;
+			static const size_t HEADER_SIZE		= 64;
+
+			// Creates or truncates filename and maps capacity bytes (header included) read-write.
+			PersistentArena(const char* filename, size_t capacity);
+
+			// Maps an existing arena read-only.
+			PersistentArena(const char* filename);
+			~PersistentArena();
+
+			// Returns nullptr when read-only or full.
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+
+			// root must be inside the arena (or nullptr).
+			void	SetRoot(const void* root);
+			void*	GetRoot() const;
+
+			template<class T>
+			T*		GetRoot() const { return (T*)GetRoot(); };
+
+			// Writes the header and flushes the mapping to disk.
+			bool	Save();
+
+			// Saves (when writable), unmaps, trims the file to the used size and closes it.
+			void	Free();
+
+			void*	GetStart() const;
+			bool	IsReadOnly() const;
+			size_t	GetUsedSize() const;
+			size_t	GetCapacity() const;
+
+		private:
+			uint8_t*	mStart;
+			uint8_t*	mCurrent;
+			uint8_t*	mEnd;
+			intptr_t	mFile;		// HANDLE or file descriptor
+			intptr_t	mMapping;	// file mapping HANDLE (Windows only)
+			bool		mIsReadOnly;
+
+			void	Close(size_t fileSize);
+
+			PersistentArena();
+			PersistentArena(PersistentArena const&) = delete;
+			void operator=(PersistentArena const&) = delete;
+		};
+	}
+}
@@ -0,0 +1,218 @@
+#include "PoolAllocator.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <cstdlib>
+
+using namespace cliqCity::memory;
+
+// Every free block stores the pointer to the next free block.
+static size_t BlockAlignment(size_t alignment)
+{
+	return (alignment < alignof(void*)) ? alignof(void*) : alignment;
+}
+
+static size_t BlockSize(size_t blockSize, size_t alignment)
+{
+	size_t size = (blockSize < sizeof(void*)) ? sizeof(void*) : blockSize;
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+PoolAllocator::PoolAllocator(size_t blockSize, size_t alignment, size_t blocksPerPage, bool canGrow) :
+	mFreeList(nullptr),
+	mPages(nullptr),
+	mStart(nullptr),
+	mEnd(nullptr),
+	mBlocksPerPage(blocksPerPage),
+	mBlockCount(0),
+	mFreeCount(0),
+	mCanGrow(canGrow),
+	mIsOwner(true)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+	assert(blocksPerPage > 0);
+
+	mAlignment = BlockAlignment(alignment);
+	mBlockSize = BlockSize(blockSize, mAlignment);
+
+	Grow();
+}
+
+PoolAllocator::PoolAllocator(void* start, void* end, size_t blockSize, size_t alignment) :
+	mFreeList(nullptr),
+	mPages(nullptr),
+	mStart((uint8_t*)start),
+	mEnd((uint8_t*)end),
+	mBlocksPerPage(0),
+	mBlockCount(0),
+	mFreeCount(0),
+	mCanGrow(false),
+	mIsOwner(false)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+
+	mAlignment = BlockAlignment(alignment);
+	mBlockSize = BlockSize(blockSize, mAlignment);
+
+	uint8_t* first = (uint8_t*)AlignForward(mStart, mAlignment);
+	if (first < mEnd)
+	{
+		mBlockCount = (mEnd - first) / mBlockSize;
+		PushBlocks(first, mBlockCount);
+	}
+}
+
+PoolAllocator::PoolAllocator()
+{
+	mFreeList	= nullptr;
+	mPages		= nullptr;
+	mStart		= nullptr;
+	mEnd		= nullptr;
+}
+
+PoolAllocator::~PoolAllocator()
+{
+	mFreeList	= nullptr;
+	mPages		= nullptr;
+	mStart		= nullptr;
+	mEnd		= nullptr;
+}
+
+void* PoolAllocator::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	assert(size <= mBlockSize);
+	assert(alignment <= mAlignment);
+	assert(offset == 0);
+
+	return Allocate();
+}
+
+void* PoolAllocator::Allocate()
+{
+	if (mFreeList == nullptr && !(mCanGrow && Grow()))
+	{
+		// out of memory
+		MEMORY_TRACK_FAILURE(this, "PoolAllocator", mBlockSize);
+		return nullptr;
+	}
+
+	MEMORY_TRACK_ALLOCATE(this, "PoolAllocator", mBlockSize, mBlockSize);
+
+	void* block = mFreeList;
+	mFreeList = *(void**)block;
+	mFreeCount--;
+
+	return block;
+}
+
+void PoolAllocator::Free(void* block)
+{
+	if (block == nullptr)
+	{
+		return;
+	}
+
+	MEMORY_TRACK_FREE(this, "PoolAllocator", mBlockSize);
+
+	*(void**)block = mFreeList;
+	mFreeList = block;
+	mFreeCount++;
+}
+
+void PoolAllocator::Reset()
+{
+	MEMORY_TRACK_RELEASE(this, "PoolAllocator", (mBlockCount - mFreeCount) * mBlockSize);
+
+	mFreeList	= nullptr;
+	mFreeCount	= 0;
+
+	if (mIsOwner)
+	{
+		for (Page* page = mPages; page != nullptr; page = page->mNext)
+		{
+			PushBlocks((uint8_t*)PageBlocks(page), mBlocksPerPage);
+		}
+	}
+	else
+	{
+		PushBlocks((uint8_t*)AlignForward(mStart, mAlignment), mBlockCount);
+	}
+}
+
+void PoolAllocator::Free()
+{
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mIsOwner)
+	{
+		Page* page = mPages;
+		while (page != nullptr)
+		{
+			Page* next = page->mNext;
+			std::free(page);
+			page = next;
+		}
+	}
+
+	mPages		= nullptr;
+	mFreeList	= nullptr;
+	mBlockCount	= 0;
+	mFreeCount	= 0;
+}
+
+size_t PoolAllocator::GetBlockSize() const
+{
+	return mBlockSize;
+}
+
+size_t PoolAllocator::GetBlockCount() const
+{
+	return mBlockCount;
+}
+
+size_t PoolAllocator::GetFreeCount() const
+{
+	return mFreeCount;
+}
+
+bool PoolAllocator::Grow()
+{
+	// Page header, then padding up to the first aligned block.
+	Page* page = (Page*)malloc(sizeof(Page) + mAlignment - 1 + mBlockSize * mBlocksPerPage);
+	if (page == nullptr)
+	{
+		return false;
+	}
+
+	page->mNext = mPages;
+	mPages = page;
+	mBlockCount += mBlocksPerPage;
+
+	PushBlocks((uint8_t*)PageBlocks(page), mBlocksPerPage);
+	return true;
+}
+
+void* PoolAllocator::PageBlocks(Page* page) const
+{
+	return AlignForward(page + 1, mAlignment);
+}
+
+void PoolAllocator::PushBlocks(uint8_t* first, size_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Link in address order so fresh pages hand out blocks front to back.
+	uint8_t* block = first;
+	for (size_t i = 1; i < count; i++)
+	{
+		*(void**)block = block + mBlockSize;
+		block += mBlockSize;
+	}
+
+	*(void**)block = mFreeList;
+	mFreeList = first;
+	mFreeCount += count;
+}
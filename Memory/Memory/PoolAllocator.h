@@ -0,0 +1,110 @@
+// PoolAllocator
+//
+// Fixed size block allocator. Free blocks are threaded into an intrusive
+// singly linked list stored in the blocks themselves, so Allocate and Free
+// are a pointer pop and push. Growable pools chain extra pages on demand.
+//
+// References:	http://blog.molecular-matters.com/2012/09/17/memory-allocation-strategies-a-pool-allocator/
+//				http://www.gameenginebook.com/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <new>
+#include <utility>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		class MEMORY_API PoolAllocator
+		{
+		public:
+			// Owns its memory. blocksPerPage blocks are allocated up front, and again
+			// every time the pool runs dry if canGrow is set.
+			PoolAllocator(size_t blockSize, size_t alignment, size_t blocksPerPage, bool canGrow);
+
+			// Carves as many blocks as fit into [start, end). Never grows.
+			PoolAllocator(void* start, void* end, size_t blockSize, size_t alignment);
+			~PoolAllocator();
+
+			// size and alignment must fit the block, offset must be 0. Matches RIG_NEW.
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+			void*	Allocate();
+			void	Free(void* block);
+
+			// Returns every block to the pool. Pages are kept.
+			void	Reset();
+
+			// Releases owned pages.
+			void	Free();
+
+			size_t	GetBlockSize() const;
+			size_t	GetBlockCount() const;
+			size_t	GetFreeCount() const;
+
+		private:
+			struct Page
+			{
+				Page* mNext;
+			};
+
+			void*	mFreeList;
+			Page*	mPages;
+			uint8_t* mStart;
+			uint8_t* mEnd;
+			size_t	mBlockSize;
+			size_t	mAlignment;
+			size_t	mBlocksPerPage;
+			size_t	mBlockCount;
+			size_t	mFreeCount;
+			bool	mCanGrow;
+			bool	mIsOwner;
+
+			bool	Grow();
+			void*	PageBlocks(Page* page) const;
+			void	PushBlocks(uint8_t* first, size_t count);
+
+			PoolAllocator();
+			PoolAllocator(PoolAllocator const&) = delete;
+			void operator=(PoolAllocator const&) = delete;
+		};
+
+		// Pool of T that runs constructors and destructors.
+		template<class T>
+		class TypedPoolAllocator
+		{
+		public:
+			TypedPoolAllocator(size_t objectsPerPage, bool canGrow) : mPool(sizeof(T), alignof(T), objectsPerPage, canGrow) {};
+			TypedPoolAllocator(void* start, void* end) : mPool(start, end, sizeof(T), alignof(T)) {};
+			~TypedPoolAllocator() { mPool.Free(); };
+
+			template<class... Args>
+			T* New(Args&&... args)
+			{
+				void* block = mPool.Allocate();
+				return (block) ? new (block) T(std::forward<Args>(args)...) : nullptr;
+			}
+
+			void Delete(T* object)
+			{
+				if (object)
+				{
+					object->~T();
+					mPool.Free(object);
+				}
+			}
+
+			PoolAllocator& GetPool() { return mPool; };
+
+		private:
+			PoolAllocator mPool;
+		};
+	}
+}
@@ -0,0 +1,110 @@
+// STLAllocator
+//
+// std::allocator compatible adapter over any engine allocator with the usual
+// Allocate(size, alignment, offset), so standard containers can live in an
+// arena, a pool or a frame. The container keeps a pointer to the engine
+// allocator; copies and rebinds share it.
+//
+// deallocate calls Free(pointer) on allocators that can free single blocks.
+// Arenas (linear, stack, frame, virtual) ignore it and are reclaimed as a
+// whole, so reserve up front: a growing vector leaves its old buffers behind.
+//
+// References:	http://en.cppreference.com/w/cpp/concept/Allocator
+//				http://howardhinnant.github.io/allocator_boilerplate.html
+
+#pragma once
+#include "LinearAllocator.h"
+#include "StackAllocator.h"
+#include "FrameAllocator.h"
+#include "VirtualArena.h"
+#include <stddef.h>
+#include <new>
+#include <vector>
+#include <map>
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		template<class Allocator>
+		struct STLDeallocator
+		{
+			static void Deallocate(Allocator* allocator, void* pointer) { allocator->Free(pointer); };
+		};
+
+		template<>
+		struct STLDeallocator<LinearAllocator>
+		{
+			static void Deallocate(LinearAllocator*, void*) {};
+		};
+
+		template<>
+		struct STLDeallocator<StackAllocator>
+		{
+			static void Deallocate(StackAllocator*, void*) {};
+		};
+
+		template<>
+		struct STLDeallocator<FrameAllocator>
+		{
+			static void Deallocate(FrameAllocator*, void*) {};
+		};
+
+		template<>
+		struct STLDeallocator<VirtualArena>
+		{
+			static void Deallocate(VirtualArena*, void*) {};
+		};
+
+		template<class T, class Allocator>
+		class STLAllocator
+		{
+		public:
+			typedef T value_type;
+
+			template<class U>
+			struct rebind
+			{
+				typedef STLAllocator<U, Allocator> other;
+			};
+
+			STLAllocator(Allocator* allocator) : mAllocator(allocator) {};
+
+			template<class U>
+			STLAllocator(const STLAllocator<U, Allocator>& other) : mAllocator(other.GetAllocator()) {};
+
+			T* allocate(size_t count)
+			{
+				void* pointer = mAllocator->Allocate(sizeof(T) * count, alignof(T), 0);
+				if (pointer == nullptr)
+				{
+					throw std::bad_alloc();
+				}
+
+				return (T*)pointer;
+			}
+
+			void deallocate(T* pointer, size_t)
+			{
+				STLDeallocator<Allocator>::Deallocate(mAllocator, pointer);
+			}
+
+			Allocator* GetAllocator() const { return mAllocator; };
+
+			template<class U>
+			bool operator==(const STLAllocator<U, Allocator>& other) const { return mAllocator == other.GetAllocator(); };
+
+			template<class U>
+			bool operator!=(const STLAllocator<U, Allocator>& other) const { return mAllocator != other.GetAllocator(); };
+
+		private:
+			Allocator* mAllocator;
+		};
+
+		template<class T, class Allocator>
+		using STLVector = std::vector<T, STLAllocator<T, Allocator>>;
+
+		template<class Key, class Value, class Allocator, class Compare = std::less<Key>>
+		using STLMap = std::map<Key, Value, Compare, STLAllocator<std::pair<const Key, Value>, Allocator>>;
+	}
+}
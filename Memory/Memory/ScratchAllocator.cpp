@@ -0,0 +1,79 @@
+#include "ScratchAllocator.h"
+#include <assert.h>
+#include <atomic>
+
+using namespace cliqCity::memory;
+
+static std::atomic<size_t> gDefaultArenaSize(ScratchAllocator::DEFAULT_ARENA_SIZE);
+
+// Created on first use, freed when the owning thread exits.
+struct ThreadArenas
+{
+	StackAllocator* mArenas[2];
+
+	ThreadArenas()
+	{
+		mArenas[0] = nullptr;
+		mArenas[1] = nullptr;
+	}
+
+	~ThreadArenas()
+	{
+		Release();
+	}
+
+	void Create(size_t size)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			mArenas[i] = new StackAllocator(size);
+		}
+	}
+
+	void Release()
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			if (mArenas[i] != nullptr)
+			{
+				assert(mArenas[i]->GetUsedSize() == 0);	// A scope is still open
+				mArenas[i]->Free();
+				delete mArenas[i];
+				mArenas[i] = nullptr;
+			}
+		}
+	}
+};
+
+static thread_local ThreadArenas gThreadArenas;
+
+void ScratchAllocator::SetDefaultArenaSize(size_t size)
+{
+	gDefaultArenaSize.store(size, std::memory_order_relaxed);
+}
+
+size_t ScratchAllocator::GetDefaultArenaSize()
+{
+	return gDefaultArenaSize.load(std::memory_order_relaxed);
+}
+
+void ScratchAllocator::SetThreadArenaSize(size_t size)
+{
+	gThreadArenas.Release();
+	gThreadArenas.Create(size);
+}
+
+StackAllocator& ScratchAllocator::GetThreadArena(const StackAllocator* conflict)
+{
+	if (gThreadArenas.mArenas[0] == nullptr)
+	{
+		gThreadArenas.Create(GetDefaultArenaSize());
+	}
+
+	return (gThreadArenas.mArenas[0] != conflict) ? *gThreadArenas.mArenas[0] : *gThreadArenas.mArenas[1];
+}
+
+void ScratchAllocator::ReleaseThreadArenas()
+{
+	gThreadArenas.Release();
+}
@@ -0,0 +1,72 @@
+// ScratchAllocator
+//
+// Per thread scratch memory. Every thread lazily gets two StackAllocators, and
+// a ScratchScope borrows one of them and rolls it back when it ends. Passing the
+// arena a caller already uses (e.g. for its output) as the conflict picks the
+// other one, so a callee's temporaries can never be freed from under the
+// caller's allocations when scopes nest across function boundaries.
+//
+// References:	https://www.rfleury.com/p/untangling-lifetimes-the-arena-allocator
+
+#pragma once
+#include "StackAllocator.h"
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		class MEMORY_API ScratchAllocator
+		{
+		public:
+			static const size_t DEFAULT_ARENA_SIZE = 1024 * 1024;
+
+			// Size of each arena for threads that have not touched scratch memory yet.
+			static void				SetDefaultArenaSize(size_t size);
+			static size_t			GetDefaultArenaSize();
+
+			// Resizes the calling thread's arenas. They must not be in use.
+			static void				SetThreadArenaSize(size_t size);
+
+			// Returns the calling thread's arena that is not conflict (which may be nullptr).
+			static StackAllocator&	GetThreadArena(const StackAllocator* conflict);
+
+			// Frees the calling thread's arenas. They are also freed when the thread exits.
+			static void				ReleaseThreadArenas();
+		};
+
+		// The conflict to pass to ScratchScope for temporaries of a function whose
+		// results go to allocator: only a thread arena can conflict with scratch.
+		inline const StackAllocator* ScratchConflict(const void*) { return nullptr; };
+		inline const StackAllocator* ScratchConflict(const StackAllocator* allocator) { return allocator; };
+
+		// Borrows a thread scratch arena and rolls it back on destruction.
+		class ScratchScope
+		{
+		public:
+			ScratchScope(const StackAllocator* conflict = nullptr) :
+				mArena(ScratchAllocator::GetThreadArena(conflict)),
+				mMarker(mArena.GetMarker()) {};
+			~ScratchScope() { mArena.FreeToMarker(mMarker); };
+
+			void* Allocate(size_t size, size_t alignment, size_t offset) { return mArena.Allocate(size, alignment, offset); };
+
+			template<class T>
+			T* Allocate(size_t count) { return (T*)mArena.Allocate(sizeof(T) * count, alignof(T), 0); };
+
+			StackAllocator& GetArena() { return mArena; };
+
+		private:
+			StackAllocator&	mArena;
+			Marker			mMarker;
+
+			ScratchScope(ScratchScope const&) = delete;
+			void operator=(ScratchScope const&) = delete;
+		};
+	}
+}
@@ -0,0 +1,373 @@
+#include "SmallObjectAllocator.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace cliqCity::memory;
+
+static const uint32_t CLASS_SIZES[SmallObjectAllocator::CLASS_COUNT] =
+{
+	8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256
+};
+
+#if SIZE_MAX > 0xFFFFFFFF
+static const size_t SLAB_RESERVE_SIZE = (size_t)1024 * 1024 * 1024;
+#else
+static const size_t SLAB_RESERVE_SIZE = (size_t)256 * 1024 * 1024;
+#endif
+
+static const uint32_t SLAB_BITMAP_WORDS	= SmallObjectAllocator::SLAB_SIZE / 8 / 32;
+static const uint32_t REFILL_COUNT		= SmallObjectAllocator::THREAD_CACHE_SIZE / 2;
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		// Lives at the start of every slab. A set bit in mFreeBits is a free slot.
+		struct SmallObjectSlab
+		{
+			SmallObjectSlab*	mNext;
+			SmallObjectSlab*	mPrevious;
+			uint8_t*			mSlots;
+			uint32_t			mClass;
+			uint32_t			mSlotCount;
+			uint32_t			mFreeCount;
+			uint32_t			mSearchStart;	// no free slot below this bitmap word
+			uint32_t			mFreeBits[SLAB_BITMAP_WORDS];
+		};
+
+		// Per thread stacks of free objects, returned to their slabs at thread exit.
+		struct SmallObjectThreadCache
+		{
+			void*		mObjects[SmallObjectAllocator::CLASS_COUNT][SmallObjectAllocator::THREAD_CACHE_SIZE];
+			uint32_t	mCounts[SmallObjectAllocator::CLASS_COUNT];
+
+			~SmallObjectThreadCache()
+			{
+				Flush();
+			}
+
+			void Flush()
+			{
+				SmallObjectAllocator& allocator = SmallObjectAllocator::SharedInstance();
+				for (uint32_t i = 0; i < SmallObjectAllocator::CLASS_COUNT; i++)
+				{
+					if (mCounts[i] > 0)
+					{
+						allocator.Release(i, mObjects[i], mCounts[i]);
+						mCounts[i] = 0;
+					}
+				}
+			}
+		};
+	}
+}
+
+// Trivially constructed (zero initialized per thread); the destructor flushes at thread exit.
+static thread_local SmallObjectThreadCache gThreadCache;
+
+static inline uint32_t FindFirstSet(uint32_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, word);
+	return index;
+#else
+	return __builtin_ctz(word);
+#endif
+}
+
+static inline SmallObjectSlab* SlabFromPointer(const void* pointer)
+{
+	return (SmallObjectSlab*)((uintptr_t)pointer & ~(uintptr_t)(SmallObjectAllocator::SLAB_SIZE - 1));
+}
+
+SmallObjectAllocator& SmallObjectAllocator::SharedInstance()
+{
+	// Placement new into static storage: constructed on first use, never destroyed.
+	static uint64_t storage[(sizeof(SmallObjectAllocator) + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+	static SmallObjectAllocator* instance = new (storage) SmallObjectAllocator();
+	return *instance;
+}
+
+SmallObjectAllocator::SmallObjectAllocator() :
+	mEmptySlabs(nullptr),
+	mSlabArena(SLAB_RESERVE_SIZE, SLAB_SIZE, VIRTUAL_ARENA_PAGES_DEFAULT)
+{
+	for (uint32_t i = 0, size = 0; i < CLASS_COUNT; i++)
+	{
+		mClasses[i].mPartial	= nullptr;
+		mClasses[i].mSize		= CLASS_SIZES[i];
+
+		for (; size <= CLASS_SIZES[i]; size += 8)
+		{
+			mClassLookup[size / 8] = (uint8_t)i;
+		}
+	}
+}
+
+SmallObjectAllocator::~SmallObjectAllocator()
+{
+	mSlabArena.Free();
+}
+
+void* SmallObjectAllocator::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+	assert(offset == 0);
+
+	if (size > MAX_SMALL_SIZE || alignment > MAX_SMALL_ALIGNMENT)
+	{
+		return AllocateLarge(size, alignment);
+	}
+
+	// Slots of a size class that is a multiple of 16 are 16 byte aligned.
+	size_t slotSize	= (size == 0) ? 1 : size;
+	slotSize		= (alignment == MAX_SMALL_ALIGNMENT) ? (slotSize + 15) & ~(size_t)15 : slotSize;
+
+	uint32_t classIndex	= mClassLookup[(slotSize + 7) / 8];
+	uint32_t& count		= gThreadCache.mCounts[classIndex];
+
+	if (count == 0)
+	{
+		count = Refill(classIndex, gThreadCache.mObjects[classIndex], REFILL_COUNT);
+		if (count == 0)
+		{
+			// No slab: the arena is exhausted or its reservation failed. Owns() is
+			// false for malloc'd memory, so Free routes it back correctly.
+			return AllocateLarge(size, alignment);
+		}
+	}
+
+	MEMORY_TRACK_ALLOCATE(this, "SmallObjectAllocator", size, mClasses[classIndex].mSize);
+
+	return gThreadCache.mObjects[classIndex][--count];
+}
+
+void* SmallObjectAllocator::Allocate(size_t size)
+{
+	// Every slot is aligned to the largest power of two (up to 16) dividing its size,
+	// which is as strict as any type of that size can require.
+	return Allocate(size, 8, 0);
+}
+
+void SmallObjectAllocator::Free(void* pointer)
+{
+	if (pointer == nullptr)
+	{
+		return;
+	}
+
+	if (!Owns(pointer))
+	{
+		FreeLarge(pointer);
+		return;
+	}
+
+	uint32_t classIndex	= SlabFromPointer(pointer)->mClass;
+	uint32_t& count		= gThreadCache.mCounts[classIndex];
+
+	MEMORY_TRACK_FREE(this, "SmallObjectAllocator", mClasses[classIndex].mSize);
+
+	if (count == THREAD_CACHE_SIZE)
+	{
+		// Hand the older half back and keep the recently freed (cache warm) objects.
+		Release(classIndex, gThreadCache.mObjects[classIndex], THREAD_CACHE_SIZE / 2);
+		memmove(gThreadCache.mObjects[classIndex], gThreadCache.mObjects[classIndex] + THREAD_CACHE_SIZE / 2, sizeof(void*) * (THREAD_CACHE_SIZE / 2));
+		count = THREAD_CACHE_SIZE / 2;
+	}
+
+	gThreadCache.mObjects[classIndex][count++] = pointer;
+}
+
+void SmallObjectAllocator::FlushThreadCache()
+{
+	gThreadCache.Flush();
+}
+
+bool SmallObjectAllocator::Owns(const void* pointer) const
+{
+	// Slabs are only ever carved from the arena, whose reservation never moves.
+	return (size_t)((uint8_t*)pointer - (uint8_t*)mSlabArena.GetStart()) < mSlabArena.GetReservedSize();
+}
+
+size_t SmallObjectAllocator::GetSizeClass(uint32_t classIndex) const
+{
+	return CLASS_SIZES[classIndex];
+}
+
+SmallObjectSlab* SmallObjectAllocator::NewSlab(uint32_t classIndex)
+{
+	SmallObjectSlab* slab;
+	{
+		std::lock_guard<std::mutex> lock(mSlabMutex);
+
+		slab = mEmptySlabs;
+		if (slab != nullptr)
+		{
+			mEmptySlabs = slab->mNext;
+		}
+		else
+		{
+			slab = (SmallObjectSlab*)mSlabArena.Allocate(SLAB_SIZE, SLAB_SIZE, 0);
+			if (slab == nullptr)
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	uint32_t slotSize = CLASS_SIZES[classIndex];
+
+	slab->mNext			= nullptr;
+	slab->mPrevious		= nullptr;
+	slab->mClass		= classIndex;
+	slab->mSlots		= (uint8_t*)AlignForward(slab + 1, MAX_SMALL_ALIGNMENT);
+	slab->mSlotCount	= (uint32_t)(((uint8_t*)slab + SLAB_SIZE - slab->mSlots) / slotSize);
+	slab->mFreeCount	= slab->mSlotCount;
+	slab->mSearchStart	= 0;
+
+	uint32_t fullWords = slab->mSlotCount / 32;
+	memset(slab->mFreeBits, 0xFF, fullWords * sizeof(uint32_t));
+	memset(slab->mFreeBits + fullWords, 0, (SLAB_BITMAP_WORDS - fullWords) * sizeof(uint32_t));
+	if (slab->mSlotCount % 32)
+	{
+		slab->mFreeBits[fullWords] = (1u << (slab->mSlotCount % 32)) - 1;
+	}
+
+	return slab;
+}
+
+void SmallObjectAllocator::ReleaseSlab(SmallObjectSlab* slab)
+{
+	std::lock_guard<std::mutex> lock(mSlabMutex);
+
+	slab->mNext = mEmptySlabs;
+	mEmptySlabs = slab;
+}
+
+uint32_t SmallObjectAllocator::Refill(uint32_t classIndex, void** objects, uint32_t count)
+{
+	SizeClass& sizeClass = mClasses[classIndex];
+	std::lock_guard<std::mutex> lock(sizeClass.mMutex);
+
+	uint32_t filled = 0;
+	while (filled < count)
+	{
+		SmallObjectSlab* slab = sizeClass.mPartial;
+		if (slab == nullptr)
+		{
+			slab = NewSlab(classIndex);
+			if (slab == nullptr)
+			{
+				break;
+			}
+
+			sizeClass.mPartial = slab;
+		}
+
+		// Take as many slots from this slab as it has, lowest addresses first.
+		while (filled < count && slab->mFreeCount > 0)
+		{
+			uint32_t word = slab->mSearchStart;
+			while (slab->mFreeBits[word] == 0)
+			{
+				word++;
+			}
+
+			uint32_t bit = FindFirstSet(slab->mFreeBits[word]);
+			slab->mFreeBits[word] &= ~(1u << bit);
+			slab->mSearchStart = word;
+			slab->mFreeCount--;
+
+			objects[filled++] = slab->mSlots + (word * 32 + bit) * sizeClass.mSize;
+		}
+
+		if (slab->mFreeCount == 0)
+		{
+			// Full slabs leave the partial list until a slot comes back.
+			sizeClass.mPartial = slab->mNext;
+			if (slab->mNext != nullptr)
+			{
+				slab->mNext->mPrevious = nullptr;
+			}
+
+			slab->mNext = nullptr;
+		}
+	}
+
+	return filled;
+}
+
+void SmallObjectAllocator::Release(uint32_t classIndex, void** objects, uint32_t count)
+{
+	SizeClass& sizeClass = mClasses[classIndex];
+	std::lock_guard<std::mutex> lock(sizeClass.mMutex);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		SmallObjectSlab* slab	= SlabFromPointer(objects[i]);
+		uint32_t slot			= (uint32_t)(((uint8_t*)objects[i] - slab->mSlots) / sizeClass.mSize);
+		uint32_t word			= slot / 32;
+
+		assert((slab->mFreeBits[word] & (1u << (slot % 32))) == 0);	// Double free
+
+		slab->mFreeBits[word] |= (1u << (slot % 32));
+		slab->mSearchStart = (word < slab->mSearchStart) ? word : slab->mSearchStart;
+
+		if (slab->mFreeCount++ == 0)
+		{
+			// Was full: back on the partial list.
+			slab->mPrevious	= nullptr;
+			slab->mNext		= sizeClass.mPartial;
+			if (sizeClass.mPartial != nullptr)
+			{
+				sizeClass.mPartial->mPrevious = slab;
+			}
+
+			sizeClass.mPartial = slab;
+		}
+
+		if (slab->mFreeCount == slab->mSlotCount && (slab->mPrevious != nullptr || slab->mNext != nullptr))
+		{
+			// Empty and not the only partial slab: let any size class reuse it.
+			if (slab->mPrevious != nullptr)
+			{
+				slab->mPrevious->mNext = slab->mNext;
+			}
+			else
+			{
+				sizeClass.mPartial = slab->mNext;
+			}
+
+			if (slab->mNext != nullptr)
+			{
+				slab->mNext->mPrevious = slab->mPrevious;
+			}
+
+			ReleaseSlab(slab);
+		}
+	}
+}
+
+void* SmallObjectAllocator::AllocateLarge(size_t size, size_t alignment)
+{
+	// AlignedPointer stores the adjustment in a (signed) char before the returned pointer.
+	alignment = (alignment < MAX_SMALL_ALIGNMENT) ? MAX_SMALL_ALIGNMENT : alignment;
+	assert(alignment <= 64);
+
+	void* buffer = malloc(size + alignment);
+	return (buffer) ? AlignedPointer(buffer, (unsigned int)alignment) : nullptr;
+}
+
+void SmallObjectAllocator::FreeLarge(void* pointer)
+{
+	uint8_t adjustment = ((uint8_t*)pointer)[-1];
+	std::free((uint8_t*)pointer - adjustment);
+}
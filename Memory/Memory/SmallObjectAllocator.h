@@ -0,0 +1,165 @@
+// SmallObjectAllocator
+//
+// Process wide allocator for requests of up to 256 bytes. Sizes are rounded to
+// one of 16 size classes, and every class carves 64 KB slabs into equal slots
+// whose state is tracked in a bitmap in the slab header. Slabs come from one
+// reserved VirtualArena range, so Free can tell a small object from anything
+// else with a range check and find its slab by masking the pointer.
+//
+// Each thread keeps a short stack of free objects per class and only takes the
+// class lock to refill or flush half of it, so the common path is a push or a
+// pop. Larger or over-aligned requests fall through to malloc, as does every
+// request once the arena has no slab left (or could not be reserved).
+//
+// References:	http://www.boost.org/doc/libs/1_60_0/libs/pool/doc/html/index.html
+//				https://www.usenix.org/legacy/event/usenix01/full_papers/bonwick/bonwick.pdf
+//				Alexandrescu, Modern C++ Design, chapter 4 (Small-Object Allocation)
+
+#pragma once
+#include "VirtualArena.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <new>
+#include <mutex>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		struct SmallObjectSlab;
+
+		class MEMORY_API SmallObjectAllocator
+		{
+		public:
+			static const size_t		MAX_SMALL_SIZE		= 256;
+			static const size_t		MAX_SMALL_ALIGNMENT	= 16;	// larger requests (up to 64) go to malloc
+			static const size_t		SLAB_SIZE			= 64 * 1024;
+			static const uint32_t	CLASS_COUNT			= 16;
+			static const uint32_t	THREAD_CACHE_SIZE	= 32;
+
+			// Never destroyed, so objects may still be freed during static destruction.
+			static SmallObjectAllocator& SharedInstance();
+
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+			void*	Allocate(size_t size);
+			void	Free(void* pointer);
+
+			// Returns the calling thread's cached objects to their slabs.
+			void	FlushThreadCache();
+
+			bool	Owns(const void* pointer) const;
+			size_t	GetSizeClass(uint32_t classIndex) const;
+
+		private:
+			struct SizeClass
+			{
+				std::mutex			mMutex;
+				SmallObjectSlab*	mPartial;	// slabs with at least one free slot
+				uint32_t			mSize;
+			};
+
+			SizeClass			mClasses[CLASS_COUNT];
+			uint8_t				mClassLookup[MAX_SMALL_SIZE / 8 + 1];
+
+			std::mutex			mSlabMutex;
+			SmallObjectSlab*	mEmptySlabs;
+			VirtualArena		mSlabArena;
+
+			SmallObjectAllocator();
+			~SmallObjectAllocator();
+
+			SmallObjectSlab*	NewSlab(uint32_t classIndex);
+			void				ReleaseSlab(SmallObjectSlab* slab);
+			uint32_t			Refill(uint32_t classIndex, void** objects, uint32_t count);
+			void				Release(uint32_t classIndex, void** objects, uint32_t count);
+
+			void*				AllocateLarge(size_t size, size_t alignment);
+			void				FreeLarge(void* pointer);
+
+			friend struct SmallObjectThreadCache;
+
+			SmallObjectAllocator(SmallObjectAllocator const&) = delete;
+			void operator=(SmallObjectAllocator const&) = delete;
+		};
+
+		// STL allocator that routes container nodes through the small object allocator.
+		template<class T>
+		class SmallObjectSTLAllocator
+		{
+		public:
+			typedef T value_type;
+
+			SmallObjectSTLAllocator() {};
+
+			template<class U>
+			SmallObjectSTLAllocator(const SmallObjectSTLAllocator<U>&) {};
+
+			T* allocate(size_t count)
+			{
+				void* pointer = SmallObjectAllocator::SharedInstance().Allocate(sizeof(T) * count, alignof(T), 0);
+				if (pointer == nullptr)
+				{
+					throw std::bad_alloc();
+				}
+
+				return (T*)pointer;
+			}
+
+			void deallocate(T* pointer, size_t)
+			{
+				SmallObjectAllocator::SharedInstance().Free(pointer);
+			}
+
+			template<class U>
+			bool operator==(const SmallObjectSTLAllocator<U>&) const { return true; };
+
+			template<class U>
+			bool operator!=(const SmallObjectSTLAllocator<U>&) const { return false; };
+		};
+	}
+}
+
+// Replaces global operator new and delete with the small object allocator.
+// Place once in a .cpp of the executable. Replacing them inside a DLL only
+// affects that DLL.
+#define DECLARE_SMALL_OBJECT_OPERATOR_NEW																	\
+void* operator new(size_t size)																				\
+{																											\
+	void* pointer = cliqCity::memory::SmallObjectAllocator::SharedInstance().Allocate(size);				\
+	if (pointer == nullptr) throw std::bad_alloc();															\
+	return pointer;																							\
+}																											\
+void* operator new[](size_t size)																			\
+{																											\
+	return operator new(size);																				\
+}																											\
+void* operator new(size_t size, const std::nothrow_t&) throw()												\
+{																											\
+	return cliqCity::memory::SmallObjectAllocator::SharedInstance().Allocate(size);						\
+}																											\
+void* operator new[](size_t size, const std::nothrow_t&) throw()											\
+{																											\
+	return cliqCity::memory::SmallObjectAllocator::SharedInstance().Allocate(size);						\
+}																											\
+void operator delete(void* pointer) throw()																	\
+{																											\
+	cliqCity::memory::SmallObjectAllocator::SharedInstance().Free(pointer);								\
+}																											\
+void operator delete[](void* pointer) throw()																\
+{																											\
+	cliqCity::memory::SmallObjectAllocator::SharedInstance().Free(pointer);								\
+}																											\
+void operator delete(void* pointer, size_t) throw()															\
+{																											\
+	cliqCity::memory::SmallObjectAllocator::SharedInstance().Free(pointer);								\
+}																											\
+void operator delete[](void* pointer, size_t) throw()														\
+{																											\
+	cliqCity::memory::SmallObjectAllocator::SharedInstance().Free(pointer);								\
+}
@@ -0,0 +1,220 @@
+#include "StackAllocator.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <cstdlib>
+
+using namespace cliqCity::memory;
+
+#pragma region StackAllocator
+
+StackAllocator::StackAllocator(size_t size) : mIsOwner(true)
+{
+	mStart		= (uint8_t*)malloc(size);
+	mEnd		= (mStart + size);
+	mCurrent	= mStart;
+}
+
+StackAllocator::StackAllocator(void* start, void* end) : mStart((uint8_t*)start), mEnd((uint8_t*)end), mIsOwner(false)
+{
+	mCurrent = mStart;
+}
+
+StackAllocator::StackAllocator()
+{
+	mStart		= nullptr;
+	mEnd		= nullptr;
+	mCurrent	= nullptr;
+}
+
+StackAllocator::~StackAllocator()
+{
+	mStart		= nullptr;
+	mEnd		= nullptr;
+	mCurrent	= nullptr;
+}
+
+void* StackAllocator::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+
+	// offset pointer first, align it, and offset it back
+	uint8_t* userPtr = (uint8_t*)AlignForward(mCurrent + offset, alignment) - offset;
+
+	if (userPtr + size > mEnd)
+	{
+		// out of memory
+		MEMORY_TRACK_FAILURE(this, "StackAllocator", size);
+		return nullptr;
+	}
+
+	MEMORY_TRACK_ALLOCATE(this, "StackAllocator", size, userPtr + size - mCurrent);
+
+	mCurrent = userPtr + size;
+	return userPtr;
+}
+
+Marker StackAllocator::GetMarker() const
+{
+	return mCurrent - mStart;
+}
+
+void StackAllocator::FreeToMarker(Marker marker)
+{
+	assert(marker <= (Marker)(mCurrent - mStart));	// Markers must be freed in LIFO order
+	MEMORY_TRACK_RELEASE(this, "StackAllocator", (mCurrent - mStart) - marker);
+	mCurrent = mStart + marker;
+}
+
+void StackAllocator::Reset()
+{
+	MEMORY_TRACK_RELEASE(this, "StackAllocator", mCurrent - mStart);
+	mCurrent = mStart;
+}
+
+void StackAllocator::Free()
+{
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mIsOwner && mStart != nullptr) {
+		std::free(mStart);
+	}
+}
+
+size_t StackAllocator::GetUsedSize() const
+{
+	return mCurrent - mStart;
+}
+
+size_t StackAllocator::GetCapacity() const
+{
+	return mEnd - mStart;
+}
+
+#pragma endregion
+
+#pragma region DoubleEndedStackAllocator
+
+DoubleEndedStackAllocator::DoubleEndedStackAllocator(size_t size) : mIsOwner(true)
+{
+	mStart	= (uint8_t*)malloc(size);
+	mEnd	= (mStart + size);
+	mLower	= mStart;
+	mUpper	= mEnd;
+}
+
+DoubleEndedStackAllocator::DoubleEndedStackAllocator(void* start, void* end) : mStart((uint8_t*)start), mEnd((uint8_t*)end), mIsOwner(false)
+{
+	mLower	= mStart;
+	mUpper	= mEnd;
+}
+
+DoubleEndedStackAllocator::DoubleEndedStackAllocator()
+{
+	mStart	= nullptr;
+	mEnd	= nullptr;
+	mLower	= nullptr;
+	mUpper	= nullptr;
+}
+
+DoubleEndedStackAllocator::~DoubleEndedStackAllocator()
+{
+	mStart	= nullptr;
+	mEnd	= nullptr;
+	mLower	= nullptr;
+	mUpper	= nullptr;
+}
+
+void* DoubleEndedStackAllocator::AllocateLower(size_t size, size_t alignment, size_t offset)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+
+	uint8_t* userPtr = (uint8_t*)AlignForward(mLower + offset, alignment) - offset;
+
+	if (userPtr + size > mUpper)
+	{
+		// out of memory
+		MEMORY_TRACK_FAILURE(this, "DoubleEndedStackAllocator", size);
+		return nullptr;
+	}
+
+	MEMORY_TRACK_ALLOCATE(this, "DoubleEndedStackAllocator", size, userPtr + size - mLower);
+
+	mLower = userPtr + size;
+	return userPtr;
+}
+
+void* DoubleEndedStackAllocator::AllocateUpper(size_t size, size_t alignment, size_t offset)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+
+	if ((size_t)(mUpper - mLower) < size)
+	{
+		// out of memory
+		MEMORY_TRACK_FAILURE(this, "DoubleEndedStackAllocator", size);
+		return nullptr;
+	}
+
+	// Round (top - size + offset) down to the alignment, then offset it back.
+	uintptr_t aligned = ((uintptr_t)(mUpper - size + offset)) & ~((uintptr_t)alignment - 1);
+	uint8_t* userPtr = (uint8_t*)aligned - offset;
+
+	if (userPtr < mLower)
+	{
+		// out of memory
+		MEMORY_TRACK_FAILURE(this, "DoubleEndedStackAllocator", size);
+		return nullptr;
+	}
+
+	MEMORY_TRACK_ALLOCATE(this, "DoubleEndedStackAllocator", size, mUpper - userPtr);
+
+	mUpper = userPtr;
+	return userPtr;
+}
+
+Marker DoubleEndedStackAllocator::GetLowerMarker() const
+{
+	return mLower - mStart;
+}
+
+Marker DoubleEndedStackAllocator::GetUpperMarker() const
+{
+	return mEnd - mUpper;
+}
+
+void DoubleEndedStackAllocator::FreeToLowerMarker(Marker marker)
+{
+	assert(marker <= (Marker)(mLower - mStart));	// Markers must be freed in LIFO order
+	MEMORY_TRACK_RELEASE(this, "DoubleEndedStackAllocator", (mLower - mStart) - marker);
+	mLower = mStart + marker;
+}
+
+void DoubleEndedStackAllocator::FreeToUpperMarker(Marker marker)
+{
+	assert(marker <= (Marker)(mEnd - mUpper));	// Markers must be freed in LIFO order
+	MEMORY_TRACK_RELEASE(this, "DoubleEndedStackAllocator", (mEnd - mUpper) - marker);
+	mUpper = mEnd - marker;
+}
+
+void DoubleEndedStackAllocator::Reset()
+{
+	MEMORY_TRACK_RELEASE(this, "DoubleEndedStackAllocator", (mLower - mStart) + (mEnd - mUpper));
+	mLower = mStart;
+	mUpper = mEnd;
+}
+
+void DoubleEndedStackAllocator::Free()
+{
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mIsOwner && mStart != nullptr) {
+		std::free(mStart);
+	}
+}
+
+size_t DoubleEndedStackAllocator::GetFreeSize() const
+{
+	return mUpper - mLower;
+}
+
+#pragma endregion
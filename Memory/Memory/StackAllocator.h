@@ -0,0 +1,100 @@
+// StackAllocator
+//
+// Linear allocator that can roll back to any earlier marker in O(1).
+// Nothing is cleared on rollback, so unwinding megabytes of scratch memory
+// costs the same as unwinding a few bytes.
+//
+// References:	http://blog.molecular-matters.com/2012/08/27/memory-allocation-strategies-a-stack-like-lifo-allocator/
+//				http://www.gameenginebook.com/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		// Offset of the top of a stack from its start.
+		typedef size_t Marker;
+
+		class MEMORY_API StackAllocator
+		{
+		public:
+			StackAllocator(size_t size);
+			StackAllocator(void* start, void* end);
+			~StackAllocator();
+
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+			Marker	GetMarker() const;
+			void	FreeToMarker(Marker marker);
+			void	Reset();
+			void	Free();
+
+			size_t	GetUsedSize() const;
+			size_t	GetCapacity() const;
+
+		private:
+			uint8_t* mCurrent;
+			uint8_t* mStart;
+			uint8_t* mEnd;
+			bool     mIsOwner;
+
+			StackAllocator();
+		};
+
+		// Two stacks sharing one buffer: the lower one grows up, the upper one grows down.
+		// Typical use is long lived data at the bottom and temporaries at the top.
+		class MEMORY_API DoubleEndedStackAllocator
+		{
+		public:
+			DoubleEndedStackAllocator(size_t size);
+			DoubleEndedStackAllocator(void* start, void* end);
+			~DoubleEndedStackAllocator();
+
+			void*	AllocateLower(size_t size, size_t alignment, size_t offset);
+			void*	AllocateUpper(size_t size, size_t alignment, size_t offset);
+
+			Marker	GetLowerMarker() const;
+			Marker	GetUpperMarker() const;
+			void	FreeToLowerMarker(Marker marker);
+			void	FreeToUpperMarker(Marker marker);
+
+			void	Reset();
+			void	Free();
+
+			size_t	GetFreeSize() const;
+
+		private:
+			uint8_t* mLower;
+			uint8_t* mUpper;
+			uint8_t* mStart;
+			uint8_t* mEnd;
+			bool     mIsOwner;
+
+			DoubleEndedStackAllocator();
+		};
+
+		// Restores a stack to the marker taken at construction when it goes out of scope.
+		template<class Allocator>
+		class StackAllocatorScope
+		{
+		public:
+			StackAllocatorScope(Allocator& allocator) : mAllocator(allocator), mMarker(allocator.GetMarker()) {};
+			~StackAllocatorScope() { mAllocator.FreeToMarker(mMarker); };
+
+		private:
+			Allocator&	mAllocator;
+			Marker		mMarker;
+
+			StackAllocatorScope(StackAllocatorScope const&) = delete;
+			void operator=(StackAllocatorScope const&) = delete;
+		};
+	}
+}
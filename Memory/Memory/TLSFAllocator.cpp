@@ -0,0 +1,576 @@
+#include "TLSFAllocator.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace cliqCity::memory;
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		// mPrevPhysical lives in the last word of the previous block and is only
+		// valid while that block is free. mNextFree and mPrevFree overlap the
+		// payload and only exist while this block is free, so a used block costs
+		// a single size_t of overhead.
+		struct TLSFBlock
+		{
+			TLSFBlock*	mPrevPhysical;
+			size_t		mSize;			// low bits: BLOCK_FREE, BLOCK_PREV_FREE
+			TLSFBlock*	mNextFree;
+			TLSFBlock*	mPrevFree;
+		};
+	}
+}
+
+static const size_t BLOCK_FREE			= 1 << 0;
+static const size_t BLOCK_PREV_FREE		= 1 << 1;
+static const size_t BLOCK_FLAGS			= BLOCK_FREE | BLOCK_PREV_FREE;
+
+static const size_t BLOCK_OVERHEAD		= sizeof(size_t);
+static const size_t BLOCK_START_OFFSET	= offsetof(TLSFBlock, mSize) + sizeof(size_t);
+static const size_t BLOCK_SIZE_MIN		= sizeof(TLSFBlock) - sizeof(TLSFBlock*);
+static const size_t BLOCK_SIZE_MAX		= (size_t)1 << TLSFAllocator::FL_INDEX_MAX;
+
+#pragma region Bit Scans
+
+// Index of the lowest set bit. word must not be 0.
+static inline uint32_t FindFirstSet(uint32_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, word);
+	return index;
+#else
+	return __builtin_ctz(word);
+#endif
+}
+
+// Index of the highest set bit. size must not be 0.
+static inline uint32_t FindLastSet(size_t size)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, size);
+	return index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, size);
+	return index;
+#else
+	return (uint32_t)(sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(size));
+#endif
+}
+
+#pragma endregion
+
+#pragma region Block Helpers
+
+static inline size_t BlockSize(const TLSFBlock* block)
+{
+	return block->mSize & ~BLOCK_FLAGS;
+}
+
+static inline void SetBlockSize(TLSFBlock* block, size_t size)
+{
+	block->mSize = size | (block->mSize & BLOCK_FLAGS);
+}
+
+static inline bool IsLastBlock(const TLSFBlock* block)
+{
+	return BlockSize(block) == 0;
+}
+
+static inline bool IsFree(const TLSFBlock* block)
+{
+	return (block->mSize & BLOCK_FREE) != 0;
+}
+
+static inline void SetFree(TLSFBlock* block, bool isFree)
+{
+	block->mSize = (isFree) ? (block->mSize | BLOCK_FREE) : (block->mSize & ~BLOCK_FREE);
+}
+
+static inline bool IsPrevFree(const TLSFBlock* block)
+{
+	return (block->mSize & BLOCK_PREV_FREE) != 0;
+}
+
+static inline void SetPrevFree(TLSFBlock* block, bool isFree)
+{
+	block->mSize = (isFree) ? (block->mSize | BLOCK_PREV_FREE) : (block->mSize & ~BLOCK_PREV_FREE);
+}
+
+static inline TLSFBlock* BlockFromPointer(const void* pointer)
+{
+	return (TLSFBlock*)((uint8_t*)pointer - BLOCK_START_OFFSET);
+}
+
+static inline void* BlockToPointer(const TLSFBlock* block)
+{
+	return (uint8_t*)block + BLOCK_START_OFFSET;
+}
+
+static inline TLSFBlock* OffsetToBlock(const void* pointer, ptrdiff_t offset)
+{
+	return (TLSFBlock*)((uint8_t*)pointer + offset);
+}
+
+static inline TLSFBlock* NextBlock(const TLSFBlock* block)
+{
+	assert(!IsLastBlock(block));
+	return OffsetToBlock(BlockToPointer(block), BlockSize(block) - BLOCK_OVERHEAD);
+}
+
+static inline TLSFBlock* LinkNext(TLSFBlock* block)
+{
+	TLSFBlock* next = NextBlock(block);
+	next->mPrevPhysical = block;
+	return next;
+}
+
+static inline void MarkAsFree(TLSFBlock* block)
+{
+	TLSFBlock* next = LinkNext(block);
+	SetPrevFree(next, true);
+	SetFree(block, true);
+}
+
+static inline void MarkAsUsed(TLSFBlock* block)
+{
+	TLSFBlock* next = NextBlock(block);
+	SetPrevFree(next, false);
+	SetFree(block, false);
+}
+
+static inline bool CanSplit(const TLSFBlock* block, size_t size)
+{
+	return BlockSize(block) >= sizeof(TLSFBlock) + size;
+}
+
+// Splits block so it holds size bytes and returns the free remainder.
+static TLSFBlock* Split(TLSFBlock* block, size_t size)
+{
+	TLSFBlock* remaining = OffsetToBlock(BlockToPointer(block), size - BLOCK_OVERHEAD);
+	remaining->mSize = BlockSize(block) - (size + BLOCK_OVERHEAD);
+
+	SetBlockSize(block, size);
+	MarkAsFree(remaining);
+
+	return remaining;
+}
+
+// Merges block into previous, its physical predecessor.
+static TLSFBlock* Absorb(TLSFBlock* previous, TLSFBlock* block)
+{
+	previous->mSize += BlockSize(block) + BLOCK_OVERHEAD;
+	LinkNext(previous);
+	return previous;
+}
+
+static inline size_t AlignUp(size_t size, size_t alignment)
+{
+	return (size + (alignment - 1)) & ~(alignment - 1);
+}
+
+static inline size_t AlignDown(size_t size, size_t alignment)
+{
+	return size - (size & (alignment - 1));
+}
+
+// 0 means the request cannot be satisfied.
+static inline size_t AdjustRequestSize(size_t size, size_t alignment)
+{
+	if (size == 0 || size >= BLOCK_SIZE_MAX)
+	{
+		return 0;
+	}
+
+	size_t aligned = AlignUp(size, alignment);
+	return (aligned < BLOCK_SIZE_MAX) ? ((aligned < BLOCK_SIZE_MIN) ? BLOCK_SIZE_MIN : aligned) : 0;
+}
+
+#pragma endregion
+
+#pragma region Mapping
+
+static inline void MappingInsert(size_t size, uint32_t* fl, uint32_t* sl)
+{
+	if (size < TLSFAllocator::SMALL_BLOCK_SIZE)
+	{
+		// Small blocks are linearly spaced in the first list.
+		*fl = 0;
+		*sl = (uint32_t)(size / (TLSFAllocator::SMALL_BLOCK_SIZE / TLSFAllocator::SL_INDEX_COUNT));
+	}
+	else
+	{
+		uint32_t f = FindLastSet(size);
+		*sl = (uint32_t)(size >> (f - TLSFAllocator::SL_INDEX_COUNT_LOG2)) ^ (1 << TLSFAllocator::SL_INDEX_COUNT_LOG2);
+		*fl = f - (TLSFAllocator::FL_INDEX_SHIFT - 1);
+	}
+}
+
+// Rounds size up to the next class so any block found there is large enough.
+static inline void MappingSearch(size_t size, uint32_t* fl, uint32_t* sl)
+{
+	if (size >= TLSFAllocator::SMALL_BLOCK_SIZE)
+	{
+		size += ((size_t)1 << (FindLastSet(size) - TLSFAllocator::SL_INDEX_COUNT_LOG2)) - 1;
+	}
+
+	MappingInsert(size, fl, sl);
+}
+
+#pragma endregion
+
+TLSFAllocator::TLSFAllocator(size_t size) : mFLBitmap(0), mRegionCount(0)
+{
+	memset(mSLBitmap, 0, sizeof(mSLBitmap));
+	memset(mBlocks, 0, sizeof(mBlocks));
+
+	mOwnedRegion = (uint8_t*)malloc(size);
+	AddRegion(mOwnedRegion, mOwnedRegion + size);
+}
+
+TLSFAllocator::TLSFAllocator(void* start, void* end) : mFLBitmap(0), mRegionCount(0), mOwnedRegion(nullptr)
+{
+	memset(mSLBitmap, 0, sizeof(mSLBitmap));
+	memset(mBlocks, 0, sizeof(mBlocks));
+
+	AddRegion(start, end);
+}
+
+TLSFAllocator::TLSFAllocator() : mFLBitmap(0), mRegionCount(0), mOwnedRegion(nullptr)
+{
+	memset(mSLBitmap, 0, sizeof(mSLBitmap));
+	memset(mBlocks, 0, sizeof(mBlocks));
+}
+
+TLSFAllocator::~TLSFAllocator()
+{
+	mOwnedRegion	= nullptr;
+	mRegionCount	= 0;
+}
+
+bool TLSFAllocator::AddRegion(void* start, void* end)
+{
+	if (start == nullptr || mRegionCount == MAX_REGION_COUNT)
+	{
+		return false;
+	}
+
+	// The region holds one free block followed by a zero sized sentinel.
+	uint8_t* memory		= (uint8_t*)AlignForward(start, ALIGN_SIZE);
+	size_t regionOverhead	= 2 * BLOCK_OVERHEAD;
+	if ((uint8_t*)end <= memory || (size_t)((uint8_t*)end - memory) < regionOverhead + BLOCK_SIZE_MIN)
+	{
+		return false;
+	}
+
+	size_t size = AlignDown((uint8_t*)end - memory - regionOverhead, ALIGN_SIZE);
+	if (size >= BLOCK_SIZE_MAX)
+	{
+		size = AlignDown(BLOCK_SIZE_MAX - 1, ALIGN_SIZE);
+	}
+
+	// mPrevPhysical of the first block lies before the region and is never touched.
+	TLSFBlock* block = OffsetToBlock(memory, -(ptrdiff_t)BLOCK_OVERHEAD);
+	block->mSize = size;
+	SetFree(block, true);
+	SetPrevFree(block, false);
+	InsertFree(block);
+
+	TLSFBlock* sentinel = LinkNext(block);
+	sentinel->mSize = 0;
+	SetFree(sentinel, false);
+	SetPrevFree(sentinel, true);
+
+	mRegions[mRegionCount++] = memory;
+	return true;
+}
+
+void* TLSFAllocator::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+	assert(offset == 0);
+
+	size_t adjusted = AdjustRequestSize(size, ALIGN_SIZE);
+	if (adjusted == 0)
+	{
+		MEMORY_TRACK_FAILURE(this, "TLSFAllocator", size);
+		return nullptr;
+	}
+
+	// Over-allocate for larger alignments so the leading gap can be split off
+	// as a free block of its own.
+	size_t gapMinimum = sizeof(TLSFBlock);
+	size_t searchSize = (alignment <= ALIGN_SIZE) ? adjusted : AdjustRequestSize(adjusted + alignment + gapMinimum, alignment);
+	if (searchSize == 0)
+	{
+		MEMORY_TRACK_FAILURE(this, "TLSFAllocator", size);
+		return nullptr;
+	}
+
+	TLSFBlock* block = LocateFree(searchSize);
+	if (block == nullptr)
+	{
+		// out of memory
+		MEMORY_TRACK_FAILURE(this, "TLSFAllocator", size);
+		return nullptr;
+	}
+
+	if (alignment > ALIGN_SIZE)
+	{
+		uint8_t* pointer	= (uint8_t*)BlockToPointer(block);
+		uint8_t* aligned	= (uint8_t*)AlignForward(pointer, alignment);
+		size_t gap			= aligned - pointer;
+
+		if (gap != 0 && gap < gapMinimum)
+		{
+			size_t gapRemaining = gapMinimum - gap;
+			aligned	= (uint8_t*)AlignForward(aligned + ((gapRemaining > alignment) ? gapRemaining : alignment), alignment);
+			gap		= aligned - pointer;
+		}
+
+		if (gap != 0)
+		{
+			block = TrimFreeLeading(block, gap);
+		}
+	}
+
+	void* pointer = PrepareUsed(block, adjusted);
+	MEMORY_TRACK_ALLOCATE(this, "TLSFAllocator", size, BlockSize(block));
+
+	return pointer;
+}
+
+void* TLSFAllocator::Allocate(size_t size)
+{
+	return Allocate(size, ALIGN_SIZE, 0);
+}
+
+void TLSFAllocator::Free(void* pointer)
+{
+	if (pointer == nullptr)
+	{
+		return;
+	}
+
+	TLSFBlock* block = BlockFromPointer(pointer);
+	assert(!IsFree(block));	// Double free
+
+	MEMORY_TRACK_FREE(this, "TLSFAllocator", BlockSize(block));
+
+	MarkAsFree(block);
+	block = MergePrevious(block);
+	block = MergeNext(block);
+	InsertFree(block);
+}
+
+void TLSFAllocator::Free()
+{
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mOwnedRegion != nullptr)
+	{
+		std::free(mOwnedRegion);
+	}
+
+	memset(mSLBitmap, 0, sizeof(mSLBitmap));
+	memset(mBlocks, 0, sizeof(mBlocks));
+
+	mFLBitmap		= 0;
+	mRegionCount	= 0;
+	mOwnedRegion	= nullptr;
+}
+
+size_t TLSFAllocator::GetBlockSize(void* pointer) const
+{
+	return (pointer) ? BlockSize(BlockFromPointer(pointer)) : 0;
+}
+
+void TLSFAllocator::GetReport(TLSFReport* report) const
+{
+	memset(report, 0, sizeof(TLSFReport));
+
+	for (uint32_t i = 0; i < mRegionCount; i++)
+	{
+		for (TLSFBlock* block = OffsetToBlock(mRegions[i], -(ptrdiff_t)BLOCK_OVERHEAD); !IsLastBlock(block); block = NextBlock(block))
+		{
+			size_t size = BlockSize(block);
+			if (IsFree(block))
+			{
+				report->mFreeSize += size;
+				report->mFreeBlockCount++;
+				report->mLargestFreeBlock = (size > report->mLargestFreeBlock) ? size : report->mLargestFreeBlock;
+			}
+			else
+			{
+				report->mUsedSize += size;
+				report->mUsedBlockCount++;
+			}
+		}
+	}
+
+	report->mFragmentation = (report->mFreeSize > 0) ? 1.0f - (float)report->mLargestFreeBlock / (float)report->mFreeSize : 0.0f;
+}
+
+TLSFBlock* TLSFAllocator::LocateFree(size_t size)
+{
+	uint32_t fl, sl;
+	MappingSearch(size, &fl, &sl);
+
+	if (fl >= FL_INDEX_COUNT)
+	{
+		return nullptr;
+	}
+
+	TLSFBlock* block = SearchSuitable(&fl, &sl);
+	if (block != nullptr)
+	{
+		RemoveFree(block, fl, sl);
+	}
+
+	return block;
+}
+
+TLSFBlock* TLSFAllocator::SearchSuitable(uint32_t* fl, uint32_t* sl) const
+{
+	// First look in the requested first level list for a large enough class...
+	uint32_t slMap = mSLBitmap[*fl] & (~0u << *sl);
+	if (slMap == 0)
+	{
+		// ...then in the smallest non-empty first level list above it.
+		uint32_t flMap = (*fl + 1 < 32) ? mFLBitmap & (~0u << (*fl + 1)) : 0;
+		if (flMap == 0)
+		{
+			return nullptr;
+		}
+
+		*fl		= FindFirstSet(flMap);
+		slMap	= mSLBitmap[*fl];
+	}
+
+	*sl = FindFirstSet(slMap);
+	return mBlocks[*fl][*sl];
+}
+
+void TLSFAllocator::InsertFree(TLSFBlock* block)
+{
+	uint32_t fl, sl;
+	MappingInsert(BlockSize(block), &fl, &sl);
+	InsertFree(block, fl, sl);
+}
+
+void TLSFAllocator::RemoveFree(TLSFBlock* block)
+{
+	uint32_t fl, sl;
+	MappingInsert(BlockSize(block), &fl, &sl);
+	RemoveFree(block, fl, sl);
+}
+
+void TLSFAllocator::InsertFree(TLSFBlock* block, uint32_t fl, uint32_t sl)
+{
+	TLSFBlock* head = mBlocks[fl][sl];
+
+	block->mNextFree = head;
+	block->mPrevFree = nullptr;
+	if (head != nullptr)
+	{
+		head->mPrevFree = block;
+	}
+
+	mBlocks[fl][sl] = block;
+	mFLBitmap |= (1u << fl);
+	mSLBitmap[fl] |= (1u << sl);
+}
+
+void TLSFAllocator::RemoveFree(TLSFBlock* block, uint32_t fl, uint32_t sl)
+{
+	TLSFBlock* previous	= block->mPrevFree;
+	TLSFBlock* next		= block->mNextFree;
+
+	if (next != nullptr)
+	{
+		next->mPrevFree = previous;
+	}
+
+	if (previous != nullptr)
+	{
+		previous->mNextFree = next;
+		return;
+	}
+
+	mBlocks[fl][sl] = next;
+	if (next == nullptr)
+	{
+		mSLBitmap[fl] &= ~(1u << sl);
+		if (mSLBitmap[fl] == 0)
+		{
+			mFLBitmap &= ~(1u << fl);
+		}
+	}
+}
+
+TLSFBlock* TLSFAllocator::MergePrevious(TLSFBlock* block)
+{
+	if (IsPrevFree(block))
+	{
+		TLSFBlock* previous = block->mPrevPhysical;
+		RemoveFree(previous);
+		block = Absorb(previous, block);
+	}
+
+	return block;
+}
+
+TLSFBlock* TLSFAllocator::MergeNext(TLSFBlock* block)
+{
+	TLSFBlock* next = NextBlock(block);
+	if (IsFree(next))
+	{
+		RemoveFree(next);
+		block = Absorb(block, next);
+	}
+
+	return block;
+}
+
+void TLSFAllocator::TrimFree(TLSFBlock* block, size_t size)
+{
+	if (CanSplit(block, size))
+	{
+		TLSFBlock* remaining = Split(block, size);
+		LinkNext(block);
+		SetPrevFree(remaining, true);
+		InsertFree(remaining);
+	}
+}
+
+TLSFBlock* TLSFAllocator::TrimFreeLeading(TLSFBlock* block, size_t size)
+{
+	TLSFBlock* remaining = block;
+	if (CanSplit(block, size))
+	{
+		// The leading gap stays free; the remainder starts at the aligned pointer.
+		remaining = Split(block, size - BLOCK_OVERHEAD);
+		SetPrevFree(remaining, true);
+		LinkNext(block);
+		InsertFree(block);
+	}
+
+	return remaining;
+}
+
+void* TLSFAllocator::PrepareUsed(TLSFBlock* block, size_t size)
+{
+	TrimFree(block, size);
+	MarkAsUsed(block);
+	return BlockToPointer(block);
+}
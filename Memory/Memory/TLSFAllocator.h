@@ -0,0 +1,103 @@
+// TLSFAllocator
+//
+// Two-Level Segregated Fit general purpose allocator. Free blocks are kept in
+// size classes indexed by (first level = log2 of the size, second level = the
+// next SL_INDEX_COUNT_LOG2 bits). Two bitmaps find the smallest non-empty class
+// that fits with a couple of bit scans, so Allocate and Free are O(1) with a
+// small constant bound. Neighbouring free blocks are merged on Free.
+//
+// Runs over caller provided regions (for example a VirtualArena allocation);
+// more regions can be added with AddRegion.
+//
+// References:	http://www.gii.upv.es/tlsf/files/ecrts04_tlsf.pdf
+//				https://github.com/mattconte/tlsf
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		struct TLSFBlock;
+
+		struct TLSFReport
+		{
+			size_t		mUsedSize;
+			size_t		mFreeSize;
+			size_t		mLargestFreeBlock;
+			uint32_t	mUsedBlockCount;
+			uint32_t	mFreeBlockCount;
+			float		mFragmentation;		// 1 - largest free block / free size
+		};
+
+		class MEMORY_API TLSFAllocator
+		{
+		public:
+#if SIZE_MAX > 0xFFFFFFFF
+			static const uint32_t ALIGN_SIZE_LOG2	= 3;
+			static const uint32_t FL_INDEX_MAX		= 32;
+#else
+			static const uint32_t ALIGN_SIZE_LOG2	= 2;
+			static const uint32_t FL_INDEX_MAX		= 30;
+#endif
+			static const uint32_t SL_INDEX_COUNT_LOG2	= 5;
+			static const uint32_t ALIGN_SIZE			= 1 << ALIGN_SIZE_LOG2;
+			static const uint32_t SL_INDEX_COUNT		= 1 << SL_INDEX_COUNT_LOG2;
+			static const uint32_t FL_INDEX_SHIFT		= SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2;
+			static const uint32_t FL_INDEX_COUNT		= FL_INDEX_MAX - FL_INDEX_SHIFT + 1;
+			static const uint32_t SMALL_BLOCK_SIZE		= 1 << FL_INDEX_SHIFT;
+			static const uint32_t MAX_REGION_COUNT		= 16;
+
+			TLSFAllocator(size_t size);
+			TLSFAllocator(void* start, void* end);
+			~TLSFAllocator();
+
+			// Adds another region of memory to allocate from.
+			bool	AddRegion(void* start, void* end);
+
+			// offset must be 0. Matches RIG_NEW.
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+			void*	Allocate(size_t size);
+			void	Free(void* pointer);
+
+			// Releases the owned region.
+			void	Free();
+
+			size_t	GetBlockSize(void* pointer) const;
+			void	GetReport(TLSFReport* report) const;
+
+		private:
+			uint32_t	mFLBitmap;
+			uint32_t	mSLBitmap[FL_INDEX_COUNT];
+			TLSFBlock*	mBlocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+			uint8_t*	mRegions[MAX_REGION_COUNT];
+			uint32_t	mRegionCount;
+			uint8_t*	mOwnedRegion;
+
+			TLSFBlock*	LocateFree(size_t size);
+			TLSFBlock*	SearchSuitable(uint32_t* fl, uint32_t* sl) const;
+			void		InsertFree(TLSFBlock* block);
+			void		RemoveFree(TLSFBlock* block);
+			void		InsertFree(TLSFBlock* block, uint32_t fl, uint32_t sl);
+			void		RemoveFree(TLSFBlock* block, uint32_t fl, uint32_t sl);
+			TLSFBlock*	MergePrevious(TLSFBlock* block);
+			TLSFBlock*	MergeNext(TLSFBlock* block);
+			void		TrimFree(TLSFBlock* block, size_t size);
+			TLSFBlock*	TrimFreeLeading(TLSFBlock* block, size_t size);
+			void*		PrepareUsed(TLSFBlock* block, size_t size);
+
+			TLSFAllocator();
+			TLSFAllocator(TLSFAllocator const&) = delete;
+			void operator=(TLSFAllocator const&) = delete;
+		};
+	}
+}
@@ -0,0 +1,306 @@
+#include "VirtualArena.h"
+#include "AllocatorUtility.h"
+#include "MemoryStats.h"
+#include <assert.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace cliqCity::memory;
+
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static size_t RoundUp(size_t size, size_t granularity)
+{
+	return ((size + granularity - 1) / granularity) * granularity;
+}
+
+static size_t GetPageSize()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+VirtualArena::VirtualArena(size_t reserveSize, size_t commitSize, VirtualArenaPages pages, uint32_t node) : mPeak(0), mPages(pages), mNode(node)
+{
+	mCommitSize = RoundUp((commitSize > 0) ? commitSize : DEFAULT_COMMIT_SIZE, GetPageSize());
+	Reserve(reserveSize);
+}
+
+VirtualArena::VirtualArena(size_t reserveSize, size_t commitSize, VirtualArenaPages pages) : VirtualArena(reserveSize, commitSize, pages, NUMA_NODE_ANY)
+{
+
+}
+
+VirtualArena::VirtualArena(size_t reserveSize) : mPeak(0), mPages(VIRTUAL_ARENA_PAGES_DEFAULT), mNode(NUMA_NODE_ANY)
+{
+	mCommitSize = RoundUp(DEFAULT_COMMIT_SIZE, GetPageSize());
+	Reserve(reserveSize);
+}
+
+VirtualArena::VirtualArena()
+{
+	mCurrent	= nullptr;
+	mStart		= nullptr;
+	mCommitted	= nullptr;
+	mEnd		= nullptr;
+}
+
+VirtualArena::~VirtualArena()
+{
+	mCurrent	= nullptr;
+	mStart		= nullptr;
+	mCommitted	= nullptr;
+	mEnd		= nullptr;
+}
+
+void* VirtualArena::Allocate(size_t size, size_t alignment, size_t offset)
+{
+	assert((alignment & (alignment - 1)) == 0);	// Check for power of 2
+
+	// offset pointer first, align it, and offset it back
+	uint8_t* userPtr = (uint8_t*)AlignForward(mCurrent + offset, alignment) - offset;
+
+	if (userPtr > mEnd || size > (size_t)(mEnd - userPtr))
+	{
+		// out of reserved address space
+		MEMORY_TRACK_FAILURE(this, "VirtualArena", size);
+		return nullptr;
+	}
+
+	uint8_t* current = userPtr + size;
+	if (current > mCommitted && !Commit(current))
+	{
+		MEMORY_TRACK_FAILURE(this, "VirtualArena", size);
+		return nullptr;
+	}
+
+	MEMORY_TRACK_ALLOCATE(this, "VirtualArena", size, current - mCurrent);
+
+	mCurrent = current;
+	return userPtr;
+}
+
+void VirtualArena::Reset()
+{
+	// Decay the peak by a quarter per reset so one large frame is not held on to forever.
+	size_t used = mCurrent - mStart;
+	mPeak -= mPeak / 4;
+	mPeak = (used > mPeak) ? used : mPeak;
+
+	MEMORY_TRACK_RELEASE(this, "VirtualArena", used);
+
+	mCurrent = mStart;
+
+	if (mPages == VIRTUAL_ARENA_PAGES_HUGE)
+	{
+		return;
+	}
+
+	// Only decommit when at least two commit steps are above what we keep.
+	uint8_t* keep = mStart + RoundUp(mPeak, mCommitSize);
+	if (mCommitted > keep && (size_t)(mCommitted - keep) >= 2 * mCommitSize)
+	{
+		Decommit(keep);
+	}
+}
+
+void VirtualArena::Free()
+{
+	MEMORY_TRACK_RETIRE(this);
+
+	if (mStart != nullptr)
+	{
+#ifdef _WIN32
+		VirtualFree(mStart, 0, MEM_RELEASE);
+#else
+		munmap(mStart, mEnd - mStart);
+#endif
+	}
+
+	mCurrent	= nullptr;
+	mStart		= nullptr;
+	mCommitted	= nullptr;
+	mEnd		= nullptr;
+}
+
+void* VirtualArena::GetStart() const
+{
+	return mStart;
+}
+
+size_t VirtualArena::GetUsedSize() const
+{
+	return mCurrent - mStart;
+}
+
+size_t VirtualArena::GetCommittedSize() const
+{
+	return mCommitted - mStart;
+}
+
+size_t VirtualArena::GetReservedSize() const
+{
+	return mEnd - mStart;
+}
+
+VirtualArenaPages VirtualArena::GetPages() const
+{
+	return mPages;
+}
+
+uint32_t VirtualArena::GetNode() const
+{
+	return mNode;
+}
+
+void VirtualArena::Reserve(size_t reserveSize)
+{
+	mStart = nullptr;
+
+	if (mPages == VIRTUAL_ARENA_PAGES_HUGE)
+	{
+		// Huge pages cannot be committed piecemeal: map the whole range now. Without
+		// MAP_NORESERVE the mapping fails up front when the pool is too small instead
+		// of raising SIGBUS on first touch.
+#ifdef _WIN32
+		size_t largePageSize = GetLargePageMinimum();
+		if (largePageSize > 0)
+		{
+			reserveSize = RoundUp(reserveSize, largePageSize);
+			mStart = (mNode != NUMA_NODE_ANY)
+				? (uint8_t*)VirtualAllocExNuma(GetCurrentProcess(), nullptr, reserveSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, mNode)
+				: (uint8_t*)VirtualAlloc(nullptr, reserveSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		}
+#elif defined(MAP_HUGETLB)
+		reserveSize = RoundUp(reserveSize, HUGE_PAGE_SIZE);
+		void* address = mmap(nullptr, reserveSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		mStart = (address == MAP_FAILED) ? nullptr : (uint8_t*)address;
+
+		if (mStart != nullptr && mNode != NUMA_NODE_ANY)
+		{
+			// Nothing is touched yet, so every huge page faults in on the node.
+			Numa::BindMemory(mStart, reserveSize, mNode);
+		}
+#endif
+		if (mStart != nullptr)
+		{
+			mCurrent	= mStart;
+			mEnd		= mStart + reserveSize;
+			mCommitted	= mEnd;
+			return;
+		}
+
+		// No huge pages available (none reserved, or missing privilege).
+		mPages = VIRTUAL_ARENA_PAGES_DEFAULT;
+	}
+
+#ifndef MADV_HUGEPAGE
+	if (mPages == VIRTUAL_ARENA_PAGES_TRANSPARENT_HUGE)
+	{
+		mPages = VIRTUAL_ARENA_PAGES_DEFAULT;
+	}
+#endif
+
+	if (mPages == VIRTUAL_ARENA_PAGES_TRANSPARENT_HUGE && mCommitSize < HUGE_PAGE_SIZE)
+	{
+		// Commit whole huge pages so the kernel can back them with one.
+		mCommitSize = HUGE_PAGE_SIZE;
+	}
+
+	reserveSize = RoundUp(reserveSize, mCommitSize);
+
+#ifdef _WIN32
+	mStart = (mNode != NUMA_NODE_ANY)
+		? (uint8_t*)VirtualAllocExNuma(GetCurrentProcess(), nullptr, reserveSize, MEM_RESERVE, PAGE_NOACCESS, mNode)
+		: (uint8_t*)VirtualAlloc(nullptr, reserveSize, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	size_t mapSize = (mPages == VIRTUAL_ARENA_PAGES_TRANSPARENT_HUGE) ? reserveSize + HUGE_PAGE_SIZE : reserveSize;
+	void* address = mmap(nullptr, mapSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (address != MAP_FAILED)
+	{
+		mStart = (uint8_t*)address;
+
+#ifdef MADV_HUGEPAGE
+		if (mPages == VIRTUAL_ARENA_PAGES_TRANSPARENT_HUGE)
+		{
+			// Trim the over-reservation so the range starts on a huge page boundary.
+			uint8_t* aligned = (uint8_t*)AlignForward(mStart, HUGE_PAGE_SIZE);
+			if (aligned > mStart)
+			{
+				munmap(mStart, aligned - mStart);
+			}
+
+			uint8_t* mapEnd = mStart + mapSize;
+			if (mapEnd > aligned + reserveSize)
+			{
+				munmap(aligned + reserveSize, mapEnd - (aligned + reserveSize));
+			}
+
+			mStart = aligned;
+			madvise(mStart, reserveSize, MADV_HUGEPAGE);
+		}
+#endif
+
+		if (mNode != NUMA_NODE_ANY)
+		{
+			// The policy covers pages committed later.
+			Numa::BindMemory(mStart, reserveSize, mNode);
+		}
+	}
+#endif
+
+	if (mStart == nullptr)
+	{
+		reserveSize = 0;
+	}
+
+	mCurrent	= mStart;
+	mCommitted	= mStart;
+	mEnd		= mStart + reserveSize;
+}
+
+bool VirtualArena::Commit(uint8_t* end)
+{
+	uint8_t* committed = mStart + RoundUp(end - mStart, mCommitSize);
+	committed = (committed > mEnd) ? mEnd : committed;
+
+#ifdef _WIN32
+	void* address = (mNode != NUMA_NODE_ANY)
+		? VirtualAllocExNuma(GetCurrentProcess(), mCommitted, committed - mCommitted, MEM_COMMIT, PAGE_READWRITE, mNode)
+		: VirtualAlloc(mCommitted, committed - mCommitted, MEM_COMMIT, PAGE_READWRITE);
+	if (address == nullptr)
+	{
+		return false;
+	}
+#else
+	if (mprotect(mCommitted, committed - mCommitted, PROT_READ | PROT_WRITE) != 0)
+	{
+		return false;
+	}
+#endif
+
+	mCommitted = committed;
+	return true;
+}
+
+void VirtualArena::Decommit(uint8_t* start)
+{
+#ifdef _WIN32
+	VirtualFree(start, mCommitted - start, MEM_DECOMMIT);
+#else
+	madvise(start, mCommitted - start, MADV_DONTNEED);
+	mprotect(start, mCommitted - start, PROT_NONE);
+#endif
+
+	mCommitted = start;
+}
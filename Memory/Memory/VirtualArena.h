@@ -0,0 +1,83 @@
+// VirtualArena
+//
+// Linear allocator over a reserved range of virtual address space. Nothing is
+// backed by physical memory until an allocation reaches it, so the reservation
+// can be far larger than what is actually used and pointers never move.
+//
+// Reset decommits with hysteresis: pages are kept up to a slowly decaying peak
+// of recent usage, so a workload that oscillates between sizes does not keep
+// paying for page faults, while a one-off spike is given back eventually.
+//
+// With a node, the range is placed on that NUMA node: mbind on the reservation
+// on Linux, VirtualAllocExNuma for every commit on Windows.
+//
+// References:	https://msdn.microsoft.com/en-us/library/windows/desktop/aa366887(v=vs.85).aspx
+//				http://man7.org/linux/man-pages/man2/mmap.2.html
+//				https://www.kernel.org/doc/Documentation/vm/transhuge.txt
+
+#pragma once
+#include "Numa.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WINDLL
+#define MEMORY_API __declspec(dllexport)
+#else
+#define MEMORY_API __declspec(dllimport)
+#endif
+
+namespace cliqCity
+{
+	namespace memory
+	{
+		enum VirtualArenaPages
+		{
+			VIRTUAL_ARENA_PAGES_DEFAULT,
+			VIRTUAL_ARENA_PAGES_TRANSPARENT_HUGE,	// hint only (MADV_HUGEPAGE), ignored where unsupported
+			VIRTUAL_ARENA_PAGES_HUGE				// MAP_HUGETLB / MEM_LARGE_PAGES, committed up front, falls back to default
+		};
+
+		class MEMORY_API VirtualArena
+		{
+		public:
+			static const size_t DEFAULT_COMMIT_SIZE = 64 * 1024;
+
+			VirtualArena(size_t reserveSize, size_t commitSize, VirtualArenaPages pages, uint32_t node);
+			VirtualArena(size_t reserveSize, size_t commitSize, VirtualArenaPages pages);
+			VirtualArena(size_t reserveSize);
+			~VirtualArena();
+
+			// Returns nullptr only when the reservation is exhausted or the OS refuses to commit.
+			void*	Allocate(size_t size, size_t alignment, size_t offset);
+
+			// Rewinds to the start and decommits pages above the usage peak.
+			void	Reset();
+			void	Free();
+
+			void*	GetStart() const;
+			size_t	GetUsedSize() const;
+			size_t	GetCommittedSize() const;
+			size_t	GetReservedSize() const;
+			VirtualArenaPages GetPages() const;
+			uint32_t	GetNode() const;
+
+		private:
+			uint8_t*	mCurrent;
+			uint8_t*	mStart;
+			uint8_t*	mCommitted;
+			uint8_t*	mEnd;
+			size_t		mCommitSize;
+			size_t		mPeak;
+			VirtualArenaPages mPages;
+			uint32_t	mNode;
+
+			void	Reserve(size_t reserveSize);
+			bool	Commit(uint8_t* end);
+			void	Decommit(uint8_t* start);
+
+			VirtualArena();
+			VirtualArena(VirtualArena const&) = delete;
+			void operator=(VirtualArena const&) = delete;
+		};
+	}
+}
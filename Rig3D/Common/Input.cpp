@@ -13,9 +13,9 @@ Input& Input::SharedInstance()
 
 Input::Input()
 {
-	mKeysDown		= new std::unordered_set<KeyCode>();
-	mKeysUp			= new std::unordered_set<KeyCode>();
-	mKeysPressed	= new std::unordered_set<KeyCode>();
+	mKeysDown		= new KeySet();
+	mKeysUp			= new KeySet();
+	mKeysPressed	= new KeySet();
 
 	mPrevMouseState = 0;
 	mCurrMouseState = 0;
@@ -32,28 +32,30 @@ Input::~Input()
 
 int Input::Initialize()
 {
+	EVENT_TAG_OBSERVER(this, "Input");
+
 	// Mouse Down
-	mEventHandler->RegisterObserver(WM_LBUTTONDOWN, this);
-	mEventHandler->RegisterObserver(WM_MBUTTONDOWN, this);
-	mEventHandler->RegisterObserver(WM_RBUTTONDOWN, this);
-	mEventHandler->RegisterObserver(WM_XBUTTONDOWN, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseDownEvent<MOUSEBUTTON_LEFT>>(WM_LBUTTONDOWN, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseDownEvent<MOUSEBUTTON_MIDDLE>>(WM_MBUTTONDOWN, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseDownEvent<MOUSEBUTTON_RIGHT>>(WM_RBUTTONDOWN, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseDownEvent<MOUSEBUTTON_X>>(WM_XBUTTONDOWN, this);
 
 	// Mouse Up
-	mEventHandler->RegisterObserver(WM_LBUTTONUP, this);
-	mEventHandler->RegisterObserver(WM_MBUTTONUP, this);
-	mEventHandler->RegisterObserver(WM_RBUTTONUP, this);
-	mEventHandler->RegisterObserver(WM_XBUTTONUP, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseUpEvent<MOUSEBUTTON_LEFT>>(WM_LBUTTONUP, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseUpEvent<MOUSEBUTTON_MIDDLE>>(WM_MBUTTONUP, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseUpEvent<MOUSEBUTTON_RIGHT>>(WM_RBUTTONUP, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseUpEvent<MOUSEBUTTON_X>>(WM_XBUTTONUP, this);
 
 	// Mouse Move
-	mEventHandler->RegisterObserver(WM_MOUSEMOVE, this);
+	mEventHandler->Subscribe<Input, &Input::OnMouseMoveEvent>(WM_MOUSEMOVE, this);
 
-	// Key Down
-	mEventHandler->RegisterObserver(WM_KEYDOWN, this);
-	mEventHandler->RegisterObserver(WM_SYSKEYDOWN, this);
+	// Key Down (WM_SYSKEYDOWN if the alt key is pressed)
+	mEventHandler->Subscribe<Input, &Input::OnKeyDownEvent>(WM_KEYDOWN, this);
+	mEventHandler->Subscribe<Input, &Input::OnKeyDownEvent>(WM_SYSKEYDOWN, this);
 
-	// Key Up
-	mEventHandler->RegisterObserver(WM_KEYUP, this);
-	mEventHandler->RegisterObserver(WM_SYSKEYUP, this);
+	// Key Up (WM_SYSKEYUP if the alt key is pressed)
+	mEventHandler->Subscribe<Input, &Input::OnKeyUpEvent>(WM_KEYUP, this);
+	mEventHandler->Subscribe<Input, &Input::OnKeyUpEvent>(WM_SYSKEYUP, this);
 
 	return RIG_SUCCESS;
 }
@@ -100,55 +102,6 @@ bool Input::GetMouseButton(MouseButton button)
 
 #pragma endregion
 
-#pragma region Event Handler
-
-void Input::HandleEvent(const IEvent& iEvent)
-{
-	const WMEvent& wmEvent = (const WMEvent&)iEvent;
-	switch (wmEvent.msg)
-	{
-	case WM_LBUTTONDOWN:
-			OnMouseDown(MOUSEBUTTON_LEFT, wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_MBUTTONDOWN:
-			OnMouseDown(MOUSEBUTTON_MIDDLE, wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_RBUTTONDOWN:
-			OnMouseDown(MOUSEBUTTON_RIGHT, wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_XBUTTONDOWN:
-		OnMouseDown(MOUSEBUTTON_X, wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_LBUTTONUP:
-			OnMouseUp(MOUSEBUTTON_LEFT, wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_MBUTTONUP:
-			OnMouseUp(MOUSEBUTTON_MIDDLE, wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_RBUTTONUP:
-			OnMouseUp(MOUSEBUTTON_RIGHT, wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_XBUTTONUP:
-		OnMouseUp(MOUSEBUTTON_X, wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_MOUSEMOVE:
-		OnMouseMove(wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_KEYDOWN:
-	case WM_SYSKEYDOWN: // key down if alt key is presed
-		OnKeyDown(wmEvent.wparam, wmEvent.lparam);
-		break;
-	case WM_KEYUP:
-	case WM_SYSKEYUP: // key up if alt key is pressed
-		OnKeyUp(wmEvent.wparam, wmEvent.lparam);
-		break;
-	default:
-		break;
-	}
-}
-
-#pragma endregion
-
 #pragma region Input Processing
 
 void Input::Flush()
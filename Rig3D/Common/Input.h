@@ -3,6 +3,7 @@
 //#include <Windows.h>
 #include <unordered_set>
 #include "WMEventHandler.h"
+#include "Memory\Memory\SmallObjectAllocator.h"
 
 #ifdef _WINDLL
 #define RIG3D __declspec(dllexport)
@@ -29,18 +30,21 @@ namespace Rig3D
 		ScreenPoint& operator= (const ScreenPoint& Int2) { x = Int2.x; y = Int2.y; return *this; }
 	};
 
-	class RIG3D Input : public virtual IObserver
+	class RIG3D Input
 	{
 	friend class Engine;
 
 	private:
+		// Key sets churn nodes every frame, so they come from the small object allocator.
+		typedef std::unordered_set<KeyCode, std::hash<KeyCode>, std::equal_to<KeyCode>, cliqCity::memory::SmallObjectSTLAllocator<KeyCode>> KeySet;
+
 		short	mCurrMouseState;
 		short	mPrevMouseState;
 
-		std::unordered_set<KeyCode>*	mKeysDown;
-		std::unordered_set<KeyCode>*	mKeysUp;
-		std::unordered_set<KeyCode>*	mKeysPressed;
-		WMEventHandler*					mEventHandler;
+		KeySet*				mKeysDown;
+		KeySet*				mKeysUp;
+		KeySet*				mKeysPressed;
+		WMEventHandler*		mEventHandler;
 
 		Input();
 		~Input();
@@ -53,13 +57,22 @@ namespace Rig3D
 		void OnMouseUp(MouseButton button, WPARAM wParam, LPARAM lParam);
 		void OnMouseMove(WPARAM wParam, LPARAM lParam);
 
+		// Bound to window messages through WMEventHandler::Subscribe.
+		template<int button>
+		void OnMouseDownEvent(const WMEvent& wmEvent) { OnMouseDown((MouseButton)button, wmEvent.wparam, wmEvent.lparam); };
+
+		template<int button>
+		void OnMouseUpEvent(const WMEvent& wmEvent) { OnMouseUp((MouseButton)button, wmEvent.wparam, wmEvent.lparam); };
+
+		void OnMouseMoveEvent(const WMEvent& wmEvent)	{ OnMouseMove(wmEvent.wparam, wmEvent.lparam); };
+		void OnKeyDownEvent(const WMEvent& wmEvent)		{ OnKeyDown(wmEvent.wparam, wmEvent.lparam); };
+		void OnKeyUpEvent(const WMEvent& wmEvent)		{ OnKeyUp(wmEvent.wparam, wmEvent.lparam); };
+
 	protected:
 
 		int  Initialize();
 		void Flush();
 
-		void HandleEvent(const IEvent& iEvent) override;
-
 	public:
 		ScreenPoint mousePosition;
 
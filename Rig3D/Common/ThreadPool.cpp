@@ -0,0 +1,156 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace Rig3D;
+
+namespace
+{
+	thread_local bool gIsPoolWorker = false;
+}
+
+ThreadPool& ThreadPool::SharedInstance()
+{
+	// The main thread participates in every loop, so leave one core for it.
+	static ThreadPool sharedInstance(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+	return sharedInstance;
+}
+
+ThreadPool::ThreadPool(uint32_t workerCount) : mJobCounters(2), mGeneration(0), mShouldQuit(false)
+{
+	mJob.mFunction		= nullptr;
+	mJob.mContext		= nullptr;
+	mJob.mCount			= 0;
+	mJob.mGrainSize		= 1;
+	mJob.mNextChunk		= &mJobCounters[0];
+	mJob.mPendingChunks	= &mJobCounters[1];
+	mJob.mNextChunk->store(0);
+	mJob.mPendingChunks->store(0);
+	mActiveWorkers		= 0;
+
+	mWorkers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		mWorkers.push_back(std::thread(&ThreadPool::WorkerMain, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mShouldQuit = true;
+	}
+
+	mWorkAvailable.notify_all();
+
+	for (std::thread& worker : mWorkers)
+	{
+		worker.join();
+	}
+
+	mJobCounters.Free();
+}
+
+uint32_t ThreadPool::GetWorkerCount() const
+{
+	return static_cast<uint32_t>(mWorkers.size());
+}
+
+void ThreadPool::ParallelFor(uint32_t count, uint32_t grainSize, RangeFunction function, void* context)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	grainSize = std::max(grainSize, 1u);
+	uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+
+	// Nothing to share: run on the calling thread.
+	if (gIsPoolWorker || mWorkers.empty() || chunkCount == 1)
+	{
+		function(context, 0, count);
+		return;
+	}
+
+	// One loop in flight at a time.
+	std::lock_guard<std::mutex> submitLock(mSubmitMutex);
+
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		// Workers that woke late for the previous loop may still be reading it.
+		mWorkDone.wait(lock, [this] { return mActiveWorkers == 0; });
+
+		mJob.mFunction		= function;
+		mJob.mContext		= context;
+		mJob.mCount			= count;
+		mJob.mGrainSize		= grainSize;
+		mJob.mNextChunk->store(0);
+		mJob.mPendingChunks->store(chunkCount);
+		mGeneration++;
+	}
+
+	mWorkAvailable.notify_all();
+
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWorkDone.wait(lock, [this] { return *mJob.mPendingChunks == 0 && mActiveWorkers == 0; });
+}
+
+void ThreadPool::WorkerMain()
+{
+	gIsPoolWorker = true;
+
+	uint64_t seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkAvailable.wait(lock, [&] { return mShouldQuit || mGeneration != seenGeneration; });
+
+			if (mShouldQuit)
+			{
+				return;
+			}
+
+			seenGeneration = mGeneration;
+			mActiveWorkers++;
+		}
+
+		RunChunks();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mActiveWorkers--;
+		}
+
+		mWorkDone.notify_all();
+	}
+}
+
+void ThreadPool::RunChunks()
+{
+	uint32_t chunkCount = (mJob.mCount + mJob.mGrainSize - 1) / mJob.mGrainSize;
+
+	while (true)
+	{
+		uint32_t chunk = mJob.mNextChunk->fetch_add(1);
+		if (chunk >= chunkCount)
+		{
+			break;
+		}
+
+		uint32_t begin	= chunk * mJob.mGrainSize;
+		uint32_t end	= std::min(begin + mJob.mGrainSize, mJob.mCount);
+		mJob.mFunction(mJob.mContext, begin, end);
+
+		if (mJob.mPendingChunks->fetch_sub(1) == 1)
+		{
+			// Last chunk. Take the lock so the submitting thread cannot miss the wake up.
+			std::lock_guard<std::mutex> lock(mMutex);
+			mWorkDone.notify_all();
+		}
+	}
+}
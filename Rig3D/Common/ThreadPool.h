@@ -0,0 +1,87 @@
+#pragma once
+#include "Memory\Memory\CacheLine.h"
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#pragma warning (disable: 4251)
+
+#ifdef _WINDLL
+#define RIG3D __declspec(dllexport)
+#else
+#define RIG3D __declspec(dllimport)
+#endif
+
+namespace Rig3D
+{
+	// Fixed set of worker threads that execute data parallel loops.
+	// The calling thread always takes part in the loop, so a pool with zero
+	// workers simply runs the loop inline.
+	class RIG3D ThreadPool
+	{
+	public:
+		typedef void(*RangeFunction)(void* context, uint32_t begin, uint32_t end);
+
+		static ThreadPool& SharedInstance();
+
+		ThreadPool(uint32_t workerCount);
+		~ThreadPool();
+
+		uint32_t GetWorkerCount() const;
+
+		// Splits [0, count) into chunks of grainSize and runs function over them
+		// on the workers. Returns when every chunk has completed.
+		// Calls made from inside a worker run inline to avoid deadlocks.
+		void ParallelFor(uint32_t count, uint32_t grainSize, RangeFunction function, void* context);
+
+		// Convenience overload for lambdas. Callable must accept (uint32_t begin, uint32_t end).
+		template<class Callable>
+		void ParallelFor(uint32_t count, uint32_t grainSize, Callable& callable)
+		{
+			ParallelFor(count, grainSize, &ThreadPool::InvokeCallable<Callable>, &callable);
+		}
+
+	private:
+		struct Job
+		{
+			RangeFunction			mFunction;
+			void*					mContext;
+			uint32_t				mCount;
+			uint32_t				mGrainSize;
+
+			// Written by every worker for every chunk, so each lives on a line of
+			// its own in mJobCounters instead of invalidating the fields above.
+			std::atomic<uint32_t>*	mNextChunk;
+			std::atomic<uint32_t>*	mPendingChunks;
+		};
+
+		// Pools may live on the heap, where alignas(64) members are not honored
+		// before C++17; CacheLineArray aligns its own storage.
+		cliqCity::memory::CacheLineArray<std::atomic<uint32_t>>	mJobCounters;
+
+		std::vector<std::thread>	mWorkers;
+		std::mutex					mMutex;
+		std::mutex					mSubmitMutex;
+		std::condition_variable		mWorkAvailable;
+		std::condition_variable		mWorkDone;
+		Job							mJob;
+		uint64_t					mGeneration;
+		uint32_t					mActiveWorkers;
+		bool						mShouldQuit;
+
+		void WorkerMain();
+		void RunChunks();
+
+		template<class Callable>
+		static void InvokeCallable(void* context, uint32_t begin, uint32_t end)
+		{
+			(*static_cast<Callable*>(context))(begin, end);
+		}
+
+		ThreadPool(ThreadPool const&) = delete;
+		void operator=(ThreadPool const&) = delete;
+	};
+}
@@ -1,9 +1,24 @@
 #include "WMEventHandler.h"
 #include <Windows.h>
+#include <limits.h>
+#include <string.h>
 
 namespace
 {
 	WMEventHandler* gWMEventHandler = 0;
+
+	// Sums the wheel deltas of a frame; key state and cursor position are the latest.
+	void AccumulateWheelDelta(IEvent& accumulated, const IEvent& iEvent)
+	{
+		WMEvent& total			= (WMEvent&)accumulated;
+		const WMEvent& wmEvent	= (const WMEvent&)iEvent;
+
+		int delta = GET_WHEEL_DELTA_WPARAM(total.wparam) + GET_WHEEL_DELTA_WPARAM(wmEvent.wparam);
+		delta = (delta > SHRT_MAX) ? SHRT_MAX : (delta < SHRT_MIN) ? SHRT_MIN : delta;
+
+		total.wparam = MAKEWPARAM(GET_KEYSTATE_WPARAM(wmEvent.wparam), (short)delta);
+		total.lparam = wmEvent.lparam;
+	}
 }
 
 LRESULT CALLBACK WinProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
@@ -18,31 +33,72 @@ WMEventHandler& WMEventHandler::SharedInstance()
 	return sharedInstance;
 }
 
-WMEventHandler::WMEventHandler()
+WMEventHandler::WMEventHandler() : mThreadEvents(ConcurrentEventQueue::DEFAULT_CAPACITY)
 {
 	gWMEventHandler = this;
+
+	// In queued mode only the last cursor position of a frame matters, and wheel
+	// notches add up. Window state changes and shutdown are not deferred: the
+	// renderer resizes during the modal size loop, which blocks Update.
+	SetCoalescing(WM_MOUSEMOVE, EVENT_COALESCE_LATEST);
+	SetAccumulator(WM_MOUSEWHEEL, AccumulateWheelDelta);
+
+	SetPriority(WM_SIZE, EVENT_PRIORITY_IMMEDIATE);
+	SetPriority(WM_ENTERSIZEMOVE, EVENT_PRIORITY_IMMEDIATE);
+	SetPriority(WM_EXITSIZEMOVE, EVENT_PRIORITY_IMMEDIATE);
+	SetPriority(WM_CLOSE, EVENT_PRIORITY_IMMEDIATE);
+	SetPriority(WM_DESTROY, EVENT_PRIORITY_IMMEDIATE);
+	SetPriority(WM_QUIT, EVENT_PRIORITY_IMMEDIATE);
 }
 
 WMEventHandler::~WMEventHandler()
 {
+	mThreadEvents.Free();
 }
 
 void WMEventHandler::NotifyObservers(const IEvent& iEvent)
 {
 	const WMEvent& wmEvent = (const WMEvent&)iEvent;
-	ObserverMap::iterator mapEntry = mObservers.find(wmEvent.msg);
-	if (mapEntry != mObservers.end())
+	Post(wmEvent.msg, wmEvent);
+}
+
+void WMEventHandler::DispatchBatch(uint32_t eventID, const IEvent* const* events, uint32_t count)
+{
+	IEventHandler::DispatchBatch(eventID, events, count);
+	mTypedEvents.PublishBatch<WMEvent>(eventID, events, count);
+}
+
+uint32_t WMEventHandler::WriteEvent(uint32_t eventID, const IEvent& iEvent, uint8_t* buffer, uint32_t capacity)
+{
+	const WMEvent& wmEvent = (const WMEvent&)iEvent;
+
+	uint64_t params[2] = { (uint64_t)wmEvent.wparam, (uint64_t)(int64_t)wmEvent.lparam };
+	if (capacity < sizeof(params))
 	{
-		for (ObserverSet::const_iterator iter = mapEntry->second.begin(); iter != mapEntry->second.end(); iter++)
-		{
-			(*iter)->HandleEvent(wmEvent);
-		}
+		return 0;
 	}
+
+	memcpy(buffer, params, sizeof(params));
+	return sizeof(params);
+}
+
+void WMEventHandler::ReadEvent(IEventHandler& handler, uint32_t eventID, const uint8_t* data, uint32_t size)
+{
+	uint64_t params[2] = { 0, 0 };
+	memcpy(params, data, (size < sizeof(params)) ? size : sizeof(params));
+
+	handler.NotifyObservers(WMEvent(NULL, eventID, (WPARAM)params[0], (LPARAM)(int64_t)params[1]));
+}
+
+bool WMEventHandler::PostFromThread(const WMEvent& wmEvent)
+{
+	return mThreadEvents.Post(wmEvent);
 }
 
 void WMEventHandler::Update()
 {
-	if (PeekMessage(&mMSG, NULL, NULL, NULL, PM_REMOVE))
+	// Drain every pending message, not one per frame.
+	while (PeekMessage(&mMSG, NULL, NULL, NULL, PM_REMOVE))
 	{
 		TranslateMessage(&mMSG);
 		DispatchMessage(&mMSG);
@@ -53,4 +109,7 @@ void WMEventHandler::Update()
 			gWMEventHandler->NotifyObservers(WMEvent(0, mMSG.message, 0, 0));
 		}
 	}
+
+	// Events posted by other threads since the last Update.
+	mThreadEvents.Drain(*this);
 }
\ No newline at end of file
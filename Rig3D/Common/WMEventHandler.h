@@ -1,6 +1,8 @@
 #pragma once
 #include <Windows.h>
 #include "EventHandler\IEventHandler.h"
+#include "EventHandler\ConcurrentEventQueue.h"
+#include "EventHandler\TypedEvent.h"
 
 class WMEvent;
 class WMObserver;
@@ -17,8 +19,36 @@ public:
 	void	Update();
 	void	NotifyObservers(const IEvent& iEvent) override;
 
+	// From any thread (asset loaders, jobs). Observers receive the event on the
+	// main thread during the next Update. False when the queue is full.
+	bool	PostFromThread(const WMEvent& wmEvent);
+
+	// Portable window messages for EventRecorder and EventPlayer: wparam and lparam
+	// widened to 64 bits, no window handle, so logs also replay off Windows.
+	static uint32_t	WriteEvent(uint32_t eventID, const IEvent& iEvent, uint8_t* buffer, uint32_t capacity);
+	static void		ReadEvent(IEventHandler& handler, uint32_t eventID, const uint8_t* data, uint32_t size);
+
+	// Typed alternative to RegisterObserver: Method receives the WMEvent itself,
+	// called directly rather than through IObserver::HandleEvent.
+	template<class T, void (T::*Method)(const WMEvent&)>
+	void Subscribe(UINT msg, T* instance)
+	{
+		mTypedEvents.Subscribe(msg, EventDelegate<WMEvent>::FromMethod<T, Method>(instance));
+	}
+
+	template<class T, void (T::*Method)(const WMEvent&)>
+	void Unsubscribe(UINT msg, T* instance)
+	{
+		mTypedEvents.Unsubscribe(msg, EventDelegate<WMEvent>::FromMethod<T, Method>(instance));
+	}
+
+protected:
+	void	DispatchBatch(uint32_t eventID, const IEvent* const* events, uint32_t count) override;
+
 private:
-	MSG mMSG;
+	MSG						mMSG;
+	ConcurrentEventQueue	mThreadEvents;
+	TypedEventDispatcher	mTypedEvents;
 
 	WMEventHandler();
 	~WMEventHandler();
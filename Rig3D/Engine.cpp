@@ -2,6 +2,9 @@
 #include "rig_defines.h"
 #include "Rig3D\Graphics\DirectX11\DX3D11Renderer.h"
 #include "Rig3D\Graphics\Interface\IScene.h"
+#include "Memory\Memory\AllocationTracker.h"
+#include "Memory\Memory\MemoryStats.h"
+#include "EventHandler\EventLog.h"
 
 using namespace Rig3D;
 
@@ -19,6 +22,8 @@ Engine::~Engine()
 
 int Engine::Initialize(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, int showCmd, Options options)
 {
+	MEMORY_ALLOCATION_TRACKER_INSTALL();
+
 	// Event Handler needs to be initialized before creating window.
 	mEventHandler = &WMEventHandler::SharedInstance();
 	mEventHandler->RegisterObserver(WM_CLOSE, this);
@@ -146,21 +151,71 @@ void Engine::HandleEvent(const IEvent& iEvent)
 
 void Engine::RunScene(IScene* iScene)
 {
+	cliqCity::memory::FrameAllocator frameAllocator(iScene->mOptions.mFrameAllocatorSize, cliqCity::memory::FrameAllocator::DEFAULT_FRAME_COUNT);
+	iScene->mFrameAllocator = &frameAllocator;
+
+	MEMORY_TAG(&frameAllocator, "Frame", "Engine");
+	MEMORY_TAG(&cliqCity::memory::SmallObjectAllocator::SharedInstance(), "SmallObjects", "Engine");
+
 	iScene->VInitialize();
 
+	// Window messages are collected during Update and dispatched together once it returns,
+	// instead of re-entering observers from inside WinProc.
+	mEventHandler->SetQueued(true);
+
+	const Options& options	= iScene->mOptions;
+	EventRecorder* recorder	= (options.mEventRecordPath != nullptr) ? new EventRecorder(options.mEventRecordPath, &WMEventHandler::WriteEvent) : nullptr;
+	EventPlayer* player		= (options.mEventReplayPath != nullptr) ? new EventPlayer(options.mEventReplayPath, &WMEventHandler::ReadEvent) : nullptr;
+	mEventHandler->SetRecorder(recorder);
+
 	// The message loop
 	double deltaTime = 0.0;
 	mTimer->Reset();
 	while (!mShouldQuit)
 	{
+		frameAllocator.BeginFrame();
+		MEMORY_ALLOCATION_FRAME();
+
+		if (recorder != nullptr)
+		{
+			recorder->BeginFrame();
+		}
+
+		// Once warmed up, a frame must not touch the heap (per frame memory comes from mFrameAllocator).
+		MEMORY_NO_HEAP_ALLOCATIONS_SCOPE(cliqCity::memory::AllocationTracker::IsSteadyState());
+
 		mTimer->Update(&deltaTime);
 		mEventHandler->Update();
+		if (player != nullptr)
+		{
+			player->PlayFrame(*mEventHandler);
+		}
+
+		mEventHandler->DispatchQueuedEvents();
 		iScene->VUpdate(deltaTime);
 		iScene->VRender();
 
 		mInput->Flush();
 	}
 
+	mEventHandler->SetQueued(false);
+	mEventHandler->SetRecorder(nullptr);
+
+	if (recorder != nullptr)
+	{
+		recorder->Free();
+		delete recorder;
+	}
+
+	if (player != nullptr)
+	{
+		player->Free();
+		delete player;
+	}
+
 	iScene->VShutdown();
 	Shutdown();
+
+	iScene->mFrameAllocator = nullptr;
+	frameAllocator.Free();
 }
\ No newline at end of file
@@ -2,8 +2,13 @@
 
 using namespace Rig3D;
 
-IScene::IScene()
+static const size_t DEFAULT_FRAME_ALLOCATOR_SIZE = 1024 * 1024;
+
+IScene::IScene() : mFrameAllocator(nullptr)
 {
+	mOptions.mFrameAllocatorSize	= DEFAULT_FRAME_ALLOCATOR_SIZE;
+	mOptions.mEventRecordPath		= nullptr;
+	mOptions.mEventReplayPath		= nullptr;
 }
 
 
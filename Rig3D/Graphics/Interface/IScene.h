@@ -1,6 +1,7 @@
 #pragma once
 #include <Windows.h>
 #include "Rig3D\Options.h"
+#include "Memory\Memory\FrameAllocator.h"
 
 #ifdef _WINDLL
 #define RIG3D __declspec(dllexport)
@@ -15,6 +16,9 @@ namespace Rig3D
 	public:
 		Options		mOptions;
 
+		// Set by the engine. Memory allocated here is valid for FrameAllocator::DEFAULT_FRAME_COUNT frames.
+		cliqCity::memory::FrameAllocator* mFrameAllocator;
+
 		IScene();
 		~IScene();
 
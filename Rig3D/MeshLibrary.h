@@ -2,8 +2,10 @@
 #include "Rig3D\rig_defines.h"
 #include "Rig3D\Graphics\DirectX11\DX11Mesh.h"
 #include "GraphicsMath\cgm.h"
+#include "Memory\Memory\STLAllocator.h"
+#include "Memory\Memory\ScratchAllocator.h"
+#include "Memory\Memory\SmallObjectAllocator.h"
 #include <vector>
-#include <map>
 #include <fstream>
 
 namespace Rig3D
@@ -12,24 +14,32 @@ namespace Rig3D
 	class IMesh;
 	
 #pragma region OBJResource
-	template<class Vertex>
+	template<class Vertex, class Allocator = cliqCity::memory::SmallObjectAllocator>
 	class OBJResource
 	{
 	public:
-		std::vector<Vertex>		mVertices;
-		std::vector<uint16_t>	mIndices;
+		typedef Vertex VertexType;
+
+		cliqCity::memory::STLVector<Vertex, Allocator>		mVertices;
+		cliqCity::memory::STLVector<uint16_t, Allocator>	mIndices;
 
 		uint32_t mVertexCount;
 		uint32_t mIndexCount;
 
 		const char* mFilename;
 
-		OBJResource(const char* filename) : mFilename(filename)
+		OBJResource(const char* filename, Allocator* allocator) : mVertices(allocator), mIndices(allocator), mVertexCount(0), mIndexCount(0), mFilename(filename)
 		{
 
 		}
 
-		OBJResource()
+		// Only for allocators with a SharedInstance (e.g. the default SmallObjectAllocator).
+		OBJResource(const char* filename) : OBJResource(filename, &Allocator::SharedInstance())
+		{
+
+		}
+
+		OBJResource() : OBJResource(nullptr)
 		{
 
 		}
@@ -54,12 +64,87 @@ namespace Rig3D
 				return false;
 			}
 
+			// Count first so that every buffer is sized exactly once.
+			uint32_t positionCount	= 0;
+			uint32_t uvCount		= 0;
+			uint32_t normalCount	= 0;
+			uint32_t faceCount		= 0;
+			char chars[100];
+
+			while (obj.good())
+			{
+				obj.getline(chars, 100);
+
+				if (chars[0] == 'v' && chars[1] == 'n')
+				{
+					normalCount++;
+				}
+				else if (chars[0] == 'v' && chars[1] == 't')
+				{
+					uvCount++;
+				}
+				else if (chars[0] == 'v')
+				{
+					positionCount++;
+				}
+				else if (chars[0] == 'f')
+				{
+					faceCount++;
+				}
+			}
+
+			obj.clear();
+			obj.seekg(0);
+
+			mVertices.reserve(faceCount * 3);
+			mIndices.reserve(faceCount * 3);
+
+			// Temporaries go to thread scratch memory when they fit, otherwise to a
+			// stack of their own that is released as soon as parsing is done.
+			Allocator* allocator = mVertices.get_allocator().GetAllocator();
+			cliqCity::memory::ScratchScope scratch(cliqCity::memory::ScratchConflict(allocator));
+			cliqCity::memory::StackAllocator& arena = scratch.GetArena();
+
+			size_t scratchSize = (positionCount + normalCount) * sizeof(vec3f) + uvCount * sizeof(vec2f)
+				+ (faceCount * 3 + 1) * (2 * sizeof(vec3f) + sizeof(uint32_t)) + 6 * 16;
+
+			bool result;
+			if (arena.GetCapacity() - arena.GetUsedSize() >= scratchSize)
+			{
+				result = Parse(obj, &arena, positionCount, uvCount, normalCount, faceCount * 3);
+			}
+			else
+			{
+				cliqCity::memory::StackAllocator overflow(scratchSize);
+				result = Parse(obj, &overflow, positionCount, uvCount, normalCount, faceCount * 3);
+				overflow.Free();
+			}
+
+			// Close
+			obj.close();
+
+			mVertexCount	= (uint32_t)mVertices.size();
+			mIndexCount		= (uint32_t)mIndices.size();
+
+			return result;
+		}
+
+	private:
+		bool Parse(std::ifstream& obj, cliqCity::memory::StackAllocator* allocator, uint32_t positionCount, uint32_t uvCount, uint32_t normalCount, uint32_t vertexCount)
+		{
 			// Variables used while reading the file
-			std::vector<vec3f> positions;     // Positions from the file
-			std::vector<vec3f> normals;       // Normals from the file
-			std::vector<vec2f> uvs;           // UVs from the file
-			std::map<int, std::vector<vec3f>> sharedTangentMap;
-			std::map<int, std::vector<vec3f>> sharedBitangentMap;
+			cliqCity::memory::STLVector<vec3f, cliqCity::memory::StackAllocator> positions(allocator);		// Positions from the file
+			cliqCity::memory::STLVector<vec3f, cliqCity::memory::StackAllocator> normals(allocator);		// Normals from the file
+			cliqCity::memory::STLVector<vec2f, cliqCity::memory::StackAllocator> uvs(allocator);			// UVs from the file
+			positions.reserve(positionCount);
+			normals.reserve(normalCount);
+			uvs.reserve(uvCount);
+
+			// Per vertex sums of the tangents of the faces sharing it (one extra slot, see below).
+			cliqCity::memory::STLVector<vec3f, cliqCity::memory::StackAllocator>		tangentSums(vertexCount + 1, vec3f(0.0f), allocator);
+			cliqCity::memory::STLVector<vec3f, cliqCity::memory::StackAllocator>		bitangentSums(vertexCount + 1, vec3f(0.0f), allocator);
+			cliqCity::memory::STLVector<uint32_t, cliqCity::memory::StackAllocator>	faceCounts(vertexCount + 1, 0, allocator);
+
 			unsigned int triangleCounter = 0;    // Count of triangles/mIndices
 			char chars[100];                     // String for line reading
 
@@ -162,46 +247,30 @@ namespace Rig3D
 					vec3f tangent = { (((t2 * x1) - (t1 * x2)) * r), (((t2 * y1) - (t1 * y2)) * r), (((t2 * z1) - (t1 * z2)) * r) };
 					vec3f bitangent = { (((s2 * x1) - (s1 * x2)) * r), (((s2 * y1) - (s1 * y2)) * r), (((s2 * z1) - (s1 * z2)) * r) };
 
+					// Includes the first vertex of the next face, hence the extra slot.
 					for (int j = 3; j >= 0; j--) {
 						int index = triangleCounter - j;
-						if (sharedTangentMap.find(index) == sharedTangentMap.end()) {
-							std::vector<vec3f> tangents = { tangent };
-							std::vector<vec3f> bitangents = { bitangent };
-							sharedTangentMap.insert({ index, tangents });
-							sharedBitangentMap.insert({ index, bitangents });
-						}
-						else {
-							sharedTangentMap.at(index).push_back(tangent);
-							sharedBitangentMap.at(index).push_back(bitangent);
-						}
+						tangentSums[index] += tangent;
+						bitangentSums[index] += bitangent;
+						faceCounts[index]++;
 					}
 				}
 			}
 
 			for (unsigned int i = 0; i < mVertices.size(); i++)
 			{
-				std::vector<vec3f>& faceTangents = sharedTangentMap.at(i);
-				std::vector<vec3f>& faceBitangents = sharedBitangentMap.at(i);
-				vec3f vertexTangent = { 0.0f, 0.0f, 0.0f };
-				vec3f vertexBitangent = { 0.0f, 0.0f, 0.0f};
+				vec3f vertexTangent = tangentSums[i];
+				vec3f vertexBitangent = bitangentSums[i];
 				vec3f& vertexNormal = mVertices[i].Normal;
 
-				for (unsigned int j = 0; j < faceTangents.size(); j++) {
-					vertexTangent += vec4f(faceTangents[j]);
-					vertexBitangent += vec4f(faceBitangents[j]);
-				}
-
-				vertexBitangent /= (float)faceBitangents.size();
-				vertexTangent = cliqCity::graphicsMath::normalize(vertexTangent / (float)faceTangents.size());
+				vertexBitangent /= (float)faceCounts[i];
+				vertexTangent = cliqCity::graphicsMath::normalize(vertexTangent / (float)faceCounts[i]);
 				vertexTangent = cliqCity::graphicsMath::normalize((vertexTangent - vertexNormal * cliqCity::graphicsMath::dot(vertexNormal, vertexTangent)));
 				mVertices[i].Tangent = vec4f(vertexTangent, 0.0f);
 				mVertices[i].Tangent.w = cliqCity::graphicsMath::dot(cliqCity::graphicsMath::cross(vertexNormal, vertexTangent), vertexBitangent);
 				mVertices[i].Tangent.w = (mVertices[i].Tangent.w < 0.0f) ? -1.0f : 1.0f;
 			}
 
-			// Close
-			obj.close();
-			
 			return true;
 		}
 	};
@@ -220,8 +289,12 @@ namespace Rig3D
 		void SetAllocator(Allocator* allocator);
 		void NewMesh(IMesh** mesh, IRenderer* renderer);
 
-		template<template<typename> class Resource, class Vertex>
-		void LoadMesh(IMesh** mesh, IRenderer* renderer, Resource<Vertex>& resource);
+		// Requires an allocator that can free single blocks (e.g. PoolAllocator).
+		void DeleteMesh(IMesh** mesh);
+
+		// Resource must provide Load(), mVertices, mIndices and a VertexType typedef (see OBJResource).
+		template<class Resource>
+		void LoadMesh(IMesh** mesh, IRenderer* renderer, Resource& resource);
 	};
 
 	template<class Allocator>
@@ -255,9 +328,22 @@ namespace Rig3D
 	}
 
 	template<class Allocator>
-	template<template<typename> class Resource, class Vertex>
-	void MeshLibrary<Allocator>::LoadMesh(IMesh** mesh, IRenderer* renderer, Resource<Vertex>& resource)
+	void MeshLibrary<Allocator>::DeleteMesh(IMesh** mesh)
 	{
+		if (*mesh)
+		{
+			(*mesh)->~IMesh();
+			mAllocator->Free(*mesh);
+			*mesh = nullptr;
+		}
+	}
+
+	template<class Allocator>
+	template<class Resource>
+	void MeshLibrary<Allocator>::LoadMesh(IMesh** mesh, IRenderer* renderer, Resource& resource)
+	{
+		typedef typename Resource::VertexType Vertex;
+
 		resource.Load();
 
 		(renderer->GetGraphicsAPI() == GRAPHICS_API_DIRECTX11) ? RIG_NEW(DX11Mesh, mAllocator, *mesh)() : RIG_NEW(DX11Mesh, mAllocator, *mesh)();
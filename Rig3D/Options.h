@@ -1,5 +1,6 @@
 #pragma once
 #include "Rig3D\rig_defines.h"
+#include <stddef.h>
 
 #ifdef _WINDLL
 #define RIG3D __declspec(dllexport)
@@ -16,5 +17,8 @@ namespace Rig3D
 		int				mWindowHeight;
 		const char*		mWindowCaption;
 		bool			mFullScreen;
+		size_t			mFrameAllocatorSize;	// bytes per frame in flight
+		const char*		mEventRecordPath;		// window events of the run are logged here when set
+		const char*		mEventReplayPath;		// log replayed frame by frame on top of live input when set
 	};
 }
\ No newline at end of file